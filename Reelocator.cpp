@@ -1,12 +1,166 @@
 #include "ReelocatorCore.hpp"
+#include "ReelocatorDaemon.hpp"
+#include "ReelocatorMetrics.hpp"
+#include "ReelocatorTrace.hpp"
 
+#include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <pthread.h>
+#define REELOCATOR_HAVE_SIGWAIT 1
+#endif
 
 namespace fs = std::filesystem;
 
-int main() {
+namespace {
+
+struct CliOptions {
+    MetricsExporterOptions metrics;
+    fs::path traceOutputPath;
+    std::size_t threads = 0;
+    JobPriority priority = JobPriority::Interactive;
+    bool followSymlinks = false;
+    // 0 keeps plans on the heap.
+    std::size_t planBudgetMb = 0;
+    std::vector<RelocationJob> jobs;
+    fs::path daemonSocketPath;
+};
+
+std::string requireValue(int argc, char* argv[], int& i) {
+    const std::string flag = argv[i];
+    if (i + 1 >= argc) {
+        throw std::invalid_argument(flag + " requires a value");
+    }
+    return argv[++i];
+}
+
+CliOptions parseCliOptions(int argc, char* argv[]) {
+    CliOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--metrics-textfile") {
+            options.metrics.textfilePath = requireValue(argc, argv, i);
+            continue;
+        }
+        if (arg == "--metrics-interval-ms") {
+            const unsigned long interval = std::stoul(requireValue(argc, argv, i));
+            if (interval == 0) {
+                throw std::invalid_argument("--metrics-interval-ms must be greater than 0");
+            }
+            options.metrics.interval = std::chrono::milliseconds(interval);
+            continue;
+        }
+        if (arg == "--metrics-port") {
+            const unsigned long port = std::stoul(requireValue(argc, argv, i));
+            if (port > 65535) {
+                throw std::invalid_argument("--metrics-port must be between 0 and 65535");
+            }
+            options.metrics.httpEnabled = true;
+            options.metrics.httpPort = static_cast<std::uint16_t>(port);
+            continue;
+        }
+
+        if (arg == "--trace-out") {
+            options.traceOutputPath = requireValue(argc, argv, i);
+            continue;
+        }
+        if (arg == "--daemon") {
+            options.daemonSocketPath = requireValue(argc, argv, i);
+            continue;
+        }
+        if (arg == "--priority") {
+            if (!parseJobPriority(requireValue(argc, argv, i), options.priority)) {
+                throw std::invalid_argument("--priority must be interactive or bulk");
+            }
+            continue;
+        }
+        if (arg == "--follow-symlinks") {
+            options.followSymlinks = true;
+            continue;
+        }
+        if (arg == "--plan-budget-mb") {
+            options.planBudgetMb = std::stoul(requireValue(argc, argv, i));
+            continue;
+        }
+        if (arg == "--threads") {
+            options.threads = std::stoul(requireValue(argc, argv, i));
+            continue;
+        }
+        if (arg == "--job") {
+            if (i + 3 >= argc) {
+                throw std::invalid_argument("--job requires <type> <source> <destination>");
+            }
+            RelocationJob job{MediaType::Images, argv[i + 2], argv[i + 3]};
+            if (!parseMediaType(argv[i + 1], job.mediaType)) {
+                throw std::invalid_argument("Unknown media type: " + std::string(argv[i + 1]));
+            }
+            options.jobs.push_back(std::move(job));
+            i += 3;
+            continue;
+        }
+        if (arg == "--manifest") {
+            const fs::path manifestPath = requireValue(argc, argv, i);
+            std::ifstream manifest(manifestPath);
+            if (!manifest.is_open()) {
+                throw std::invalid_argument("Cannot open manifest: " + manifestPath.string());
+            }
+            for (RelocationJob& job : parseJobManifest(manifest)) {
+                options.jobs.push_back(std::move(job));
+            }
+            continue;
+        }
+
+        throw std::invalid_argument("Unknown argument: " + arg);
+    }
+
+    return options;
+}
+
+void printSyscallSummary(const SyscallCounters& counters, std::uintmax_t movedCount) {
+    const double perFile =
+        movedCount == 0 ? 0.0 : static_cast<double>(counters.total()) / static_cast<double>(movedCount);
+    std::cout << "Filesystem calls: " << counters.total() << " (" << std::fixed << std::setprecision(2) << perFile
+              << " per moved file)";
+
+    const char* separator = " [";
+    for (std::size_t i = 0; i < kFsOperationCount; ++i) {
+        const auto operation = static_cast<FsOperation>(i);
+        if (counters.count(operation) == 0) {
+            continue;
+        }
+        std::cout << separator << fsOperationName(operation) << "=" << counters.count(operation);
+        separator = ", ";
+    }
+    std::cout << (separator[0] == ',' ? "]\n" : "\n");
+}
+
+bool writeTrace(const TraceRecorder* tracer, const fs::path& outputPath) {
+    if (tracer == nullptr) {
+        return true;
+    }
+
+    try {
+        tracer->writeChromeTrace(outputPath);
+        std::cout << "Trace written to " << outputPath.string() << "\n";
+        return true;
+    } catch (const std::exception& ex) {
+        std::cerr << "Failed to write trace: " << ex.what() << "\n";
+        return false;
+    }
+}
+
+bool promptForJob(RelocationJob& job) {
     std::cout << "Choose media type to move:\n";
     std::cout << "1) Images\n";
     std::cout << "2) Videos\n";
@@ -15,18 +169,13 @@ int main() {
     std::string choiceInput;
     std::getline(std::cin, choiceInput);
 
-    MediaType selectedType;
-    std::string selectedLabel;
-
     if (choiceInput == "1") {
-        selectedType = MediaType::Images;
-        selectedLabel = "images";
+        job.mediaType = MediaType::Images;
     } else if (choiceInput == "2") {
-        selectedType = MediaType::Videos;
-        selectedLabel = "videos";
+        job.mediaType = MediaType::Videos;
     } else {
         std::cerr << "Error: Invalid choice. Please run again and choose 1 or 2.\n";
-        return 1;
+        return false;
     }
 
     std::cout << "Enter source folder path: ";
@@ -37,67 +186,158 @@ int main() {
     std::string destinationInput;
     std::getline(std::cin, destinationInput);
 
-    fs::path sourceDir(sourceInput);
-    fs::path destinationDir(destinationInput);
+    job.source = sourceInput;
+    job.destination = destinationInput;
+    return true;
+}
 
-    if (!fs::exists(sourceDir) || !fs::is_directory(sourceDir)) {
-        std::cerr << "Error: Source path does not exist or is not a directory.\n";
-        return 1;
-    }
+int runDaemon(const CliOptions& cliOptions) {
+#ifdef REELOCATOR_HAVE_SIGWAIT
+    // Block the shutdown signals before any thread starts so every thread
+    // inherits the mask and only sigwait below observes them.
+    sigset_t shutdownSignals;
+    sigemptyset(&shutdownSignals);
+    sigaddset(&shutdownSignals, SIGINT);
+    sigaddset(&shutdownSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &shutdownSignals, nullptr);
 
-    if (fs::exists(destinationDir) && fs::equivalent(sourceDir, destinationDir)) {
-        std::cerr << "Error: Source and destination cannot be the same folder.\n";
+    DaemonOptions options;
+    options.socketPath = cliOptions.daemonSocketPath;
+    options.workerThreads = cliOptions.threads;
+    RelocationDaemon daemon(options);
+    try {
+        daemon.start();
+    } catch (const std::exception& ex) {
+        std::cerr << "Error starting daemon: " << ex.what() << "\n";
         return 1;
     }
+    std::cout << "Listening on " << options.socketPath << "\n";
+
+    int signal = 0;
+    sigwait(&shutdownSignals, &signal);
+    std::cout << "Shutting down.\n";
+    daemon.stop();
+    return 0;
+#else
+    (void)cliOptions;
+    std::cerr << "Error: --daemon is not supported on this platform\n";
+    return 1;
+#endif
+}
+
+}  // namespace
 
+int main(int argc, char* argv[]) {
+    CliOptions cliOptions;
     try {
-        if (!fs::exists(destinationDir)) {
-            fs::create_directories(destinationDir);
+        cliOptions = parseCliOptions(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << "Argument error: " << ex.what() << "\n";
+        return 2;
+    }
+
+    if (!cliOptions.daemonSocketPath.empty()) {
+        return runDaemon(cliOptions);
+    }
+
+    if (cliOptions.jobs.empty()) {
+        RelocationJob job{MediaType::Images, {}, {}};
+        if (!promptForJob(job)) {
+            return 1;
         }
-    } catch (const fs::filesystem_error& ex) {
-        std::cerr << "Error creating destination directory: " << ex.what() << "\n";
-        return 1;
+        cliOptions.jobs.push_back(std::move(job));
+    }
+    for (RelocationJob& job : cliOptions.jobs) {
+        job.priority = cliOptions.priority;
+        job.followSymlinks = cliOptions.followSymlinks;
     }
 
-    std::uintmax_t movedCount = 0;
-    std::uintmax_t skippedCount = 0;
+    std::unique_ptr<TraceRecorder> tracer;
+    if (!cliOptions.traceOutputPath.empty()) {
+        tracer = std::make_unique<TraceRecorder>();
+    }
 
-    try {
-        fs::recursive_directory_iterator end;
-        for (fs::recursive_directory_iterator it(sourceDir, fs::directory_options::skip_permission_denied); it != end; ++it) {
-            const fs::path currentPath = it->path();
+    RelocationMetrics metrics;
+    std::unique_ptr<MetricsExporter> exporter;
+    if (!cliOptions.metrics.textfilePath.empty() || cliOptions.metrics.httpEnabled) {
+        try {
+            exporter = std::make_unique<MetricsExporter>(metrics, cliOptions.metrics);
+            exporter->start();
+        } catch (const std::exception& ex) {
+            std::cerr << "Error starting metrics exporter: " << ex.what() << "\n";
+            return 1;
+        }
+        if (cliOptions.metrics.httpEnabled) {
+            std::cout << "Serving metrics on http://127.0.0.1:" << exporter->httpPort() << "/metrics\n";
+        }
+    }
 
-            if (!it->is_regular_file()) {
-                continue;
-            }
+    std::mutex outputMutex;
+    RelocatorOptions relocatorOptions;
+    relocatorOptions.workerThreads = cliOptions.threads;
+    relocatorOptions.metrics = &metrics;
+    relocatorOptions.tracer = tracer.get();
+    if (cliOptions.planBudgetMb != 0) {
+        relocatorOptions.spillPlans = true;
+        relocatorOptions.planSpill.memoryBudget = cliOptions.planBudgetMb << 20;
+    }
+    relocatorOptions.onEvent = [&outputMutex](const RelocationEvent& event) {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        switch (event.outcome) {
+            case MoveOutcome::Renamed:
+                std::cout << "Moved: " << event.source << " -> " << event.destination << "\n";
+                break;
+            case MoveOutcome::Copied:
+                std::cout << "Moved (copy+delete): " << event.source << " -> " << event.destination << "\n";
+                break;
+            case MoveOutcome::Skipped:
+                std::cerr << "Skipped: " << event.source << " ("
+                          << fs::filesystem_error("cannot move file", event.source, event.destination, event.error)
+                                 .what()
+                          << ")\n";
+                break;
+        }
+    };
+    Relocator relocator(relocatorOptions);
 
-            if (!isTargetFile(currentPath, selectedType)) {
-                continue;
-            }
+    RelocationSummary total;
+    bool ok = true;
+    for (const RelocationJob& job : cliOptions.jobs) {
+        if (cliOptions.jobs.size() > 1) {
+            std::cout << "Job: " << mediaTypeLabel(job.mediaType) << " " << job.source << " -> " << job.destination
+                      << "\n";
+        }
 
-            fs::path finalDestination = getUniqueDestinationPath(destinationDir, currentPath.filename());
-
-            try {
-                fs::rename(currentPath, finalDestination);
-                ++movedCount;
-                std::cout << "Moved: " << currentPath << " -> " << finalDestination << "\n";
-            } catch (const fs::filesystem_error&) {
-                try {
-                    fs::copy_file(currentPath, finalDestination, fs::copy_options::none);
-                    fs::remove(currentPath);
-                    ++movedCount;
-                    std::cout << "Moved (copy+delete): " << currentPath << " -> " << finalDestination << "\n";
-                } catch (const fs::filesystem_error& ex) {
-                    ++skippedCount;
-                    std::cerr << "Skipped: " << currentPath << " (" << ex.what() << ")\n";
-                }
-            }
+        RelocationSummary summary;
+        try {
+            summary = relocator.run(job);
+        } catch (const RelocationError& ex) {
+            std::cerr << "Error: " << ex.what() << "\n";
+            ok = false;
+            continue;
+        } catch (const fs::filesystem_error& ex) {
+            std::cerr << "Traversal error: " << ex.what() << "\n";
+            ok = false;
+            continue;
         }
-    } catch (const fs::filesystem_error& ex) {
-        std::cerr << "Traversal error: " << ex.what() << "\n";
-        return 1;
+
+        total.moved += summary.moved;
+        total.skipped += summary.skipped;
+        std::cout << "\nDone. " << mediaTypeLabel(job.mediaType) << " moved: " << summary.moved
+                  << ", skipped: " << summary.skipped << "\n";
     }
 
-    std::cout << "\nDone. " << selectedLabel << " moved: " << movedCount << ", skipped: " << skippedCount << "\n";
-    return 0;
+    if (exporter) {
+        exporter->stop();
+    }
+
+    if (cliOptions.jobs.size() > 1) {
+        std::cout << "\nAll jobs done. moved: " << total.moved << ", skipped: " << total.skipped << "\n";
+    }
+    printSyscallSummary(relocator.fileSystem().counters(), total.moved);
+
+    if (!writeTrace(tracer.get(), cliOptions.traceOutputPath)) {
+        return 1;
+    }
+    return ok ? 0 : 1;
 }
@@ -0,0 +1,155 @@
+#include "ReelocatorAsync.hpp"
+
+#include <algorithm>
+
+AsyncExecutor::AsyncExecutor(std::size_t threadCount) {
+    if (threadCount == 0) {
+        const unsigned hardware = std::thread::hardware_concurrency();
+        threadCount = hardware == 0 ? 1 : hardware;
+    }
+    workers_.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+AsyncExecutor::~AsyncExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::size_t AsyncExecutor::size() const noexcept {
+    return workers_.size();
+}
+
+void AsyncExecutor::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(handle);
+    }
+    wake_.notify_one();
+}
+
+// Workers drain the queue before exiting so no posted coroutine is dropped.
+void AsyncExecutor::workerLoop() {
+    while (true) {
+        std::coroutine_handle<> handle;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+            if (ready_.empty()) {
+                return;
+            }
+            handle = ready_.front();
+            ready_.pop_front();
+        }
+        handle.resume();
+    }
+}
+
+AsyncRelocator::AsyncRelocator(Relocator& relocator, AsyncExecutor& executor)
+    : relocator_(relocator), executor_(executor) {}
+
+Task<std::vector<fs::path>> AsyncRelocator::scan(fs::path source) {
+    co_await executor_.schedule();
+
+    FileSystem& fileSystem = relocator_.fileSystem();
+    std::vector<fs::path> files;
+    fs::recursive_directory_iterator end;
+    auto it = fileSystem.openRecursive(source, fs::directory_options::skip_permission_denied);
+    while (it != end) {
+        if (it->is_regular_file()) {
+            files.push_back(it->path());
+        }
+        fileSystem.increment(it);
+    }
+    co_return files;
+}
+
+Task<bool> AsyncRelocator::classify(fs::path file, MediaType mediaType) {
+    co_return isTargetFile(file, mediaType);
+}
+
+std::shared_ptr<DestinationIndex> AsyncRelocator::pin(const fs::path& destination) {
+    const fs::path key = destination.lexically_normal();
+    {
+        std::lock_guard<std::mutex> lock(pinsMutex_);
+        const auto it = pins_.find(key);
+        if (it != pins_.end()) {
+            return it->second;
+        }
+    }
+
+    // Loaded outside the lock; a racing pin of the same destination gets
+    // the same index from the relocator anyway.
+    std::shared_ptr<DestinationIndex> index = relocator_.destinationIndexFor(destination);
+    std::lock_guard<std::mutex> lock(pinsMutex_);
+    return pins_.emplace(key, std::move(index)).first->second;
+}
+
+Task<fs::path> AsyncRelocator::place(fs::path destination, fs::path filename) {
+    co_await executor_.schedule();
+    co_return pin(destination)->reserveUniquePath(filename);
+}
+
+Task<AsyncMoveResult> AsyncRelocator::move(fs::path destination, PlannedMove plannedMove) {
+    co_await executor_.schedule();
+
+    AsyncMoveResult result{MoveOutcome::Skipped, {}, {}};
+    const std::shared_ptr<DestinationIndex> index = pin(destination);
+    result.outcome = relocator_.moveFile(*index, plannedMove, result.destination, result.error);
+    co_return result;
+}
+
+Task<void> AsyncRelocator::moveLoop(const RelocationPlan& plan, std::atomic<std::size_t>& next, MoveTally& tally,
+                                    const CancellationToken& token) {
+    const std::shared_ptr<DestinationIndex> pinned = relocator_.destinationIndexFor(plan);
+    DestinationIndex& index = *pinned;
+    for (std::size_t i = next.fetch_add(1); i < plan.moves.size(); i = next.fetch_add(1)) {
+        // Checked after the hop, so a cancel issued while earlier moves ran
+        // is seen before this one starts.
+        co_await executor_.schedule();
+        const PlannedMove& plannedMove = plan.moves[i];
+        if (tally.cancelled.load(std::memory_order_relaxed) || token.cancelled()) {
+            tally.cancelled.store(true, std::memory_order_relaxed);
+            index.release(plannedMove.destination.filename());
+            continue;
+        }
+
+        fs::path finalDestination;
+        std::error_code error;
+        const MoveOutcome outcome = relocator_.moveFile(index, plannedMove, finalDestination, error);
+        relocator_.reportMove(plan, plannedMove, outcome, finalDestination, error, tally);
+    }
+}
+
+Task<RelocationSummary> AsyncRelocator::run(RelocationJob job, CancellationToken token) {
+    co_await executor_.schedule();
+    const RelocationPlan plan = relocator_.plan(job, token);
+    if (plan.spilled) {
+        // Spilled moves are read a chunk at a time, not by index; let the
+        // relocator's own pool move them.
+        co_return relocator_.execute(plan, token);
+    }
+
+    relocator_.beginMoves();
+    MoveTally tally;
+    tally.cancelled.store(plan.cancelled);
+    // Each move blocks an executor thread, so more loops than threads would
+    // only hold frames without adding concurrency.
+    std::atomic<std::size_t> next{0};
+    std::vector<Task<void>> loops;
+    const std::size_t loopCount = std::min(plan.moves.size(), executor_.size());
+    loops.reserve(loopCount);
+    for (std::size_t i = 0; i < loopCount; ++i) {
+        loops.push_back(moveLoop(plan, next, tally, token));
+    }
+    co_await whenAll(std::move(loops));
+    co_return relocator_.endMoves(plan, tally);
+}
@@ -0,0 +1,350 @@
+#pragma once
+
+// C++20 coroutine front end for the relocation engine. Requires the
+// reelocator_async target, which is only built when the compiler supports
+// C++20; the rest of the library stays C++17.
+
+#include "ReelocatorCore.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            const std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    Task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U&& result) {
+        value.emplace(std::forward<U>(result));
+    }
+
+    T take() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+
+    std::optional<T> value;
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void take() const {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+// Fire-and-forget coroutine used to drive tasks from non-coroutine code. It
+// starts suspended and frees itself when its body finishes.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept {
+            return DetachedTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+}  // namespace detail
+
+// Lazily started coroutine producing a T. Awaiting it starts it; it resumes
+// its awaiter by symmetric transfer when it finishes.
+template <typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() noexcept = default;
+    explicit Task(Handle handle) noexcept : handle_(handle) {}
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    ~Task() { reset(); }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            Handle handle;
+
+            bool await_ready() const noexcept { return handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() { return handle.promise().take(); }
+        };
+        return Awaiter{handle_};
+    }
+
+private:
+    void reset() noexcept {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = {};
+        }
+    }
+
+    Handle handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+}  // namespace detail
+
+// Awaitable that runs every task concurrently and resumes once all of them
+// have finished, rethrowing the first exception any of them raised.
+class WhenAll {
+public:
+    explicit WhenAll(std::vector<Task<void>> tasks) : tasks_(std::move(tasks)) {}
+
+    bool await_ready() const noexcept { return tasks_.empty(); }
+
+    bool await_suspend(std::coroutine_handle<> awaiting) {
+        awaiting_ = awaiting;
+        // The extra count keeps a task that finishes inline from resuming the
+        // awaiter before every task has been started.
+        remaining_.store(tasks_.size() + 1);
+        for (Task<void>& task : tasks_) {
+            drive(*this, task).handle.resume();
+        }
+        return remaining_.fetch_sub(1) != 1;
+    }
+
+    void await_resume() const {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    static detail::DetachedTask drive(WhenAll& self, Task<void>& task) {
+        try {
+            co_await task;
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(self.errorMutex_);
+            if (!self.error_) {
+                self.error_ = std::current_exception();
+            }
+        }
+        if (self.remaining_.fetch_sub(1) == 1) {
+            self.awaiting_.resume();
+        }
+    }
+
+    std::vector<Task<void>> tasks_;
+    std::coroutine_handle<> awaiting_;
+    std::atomic<std::size_t> remaining_{0};
+    std::mutex errorMutex_;
+    std::exception_ptr error_;
+};
+
+inline WhenAll whenAll(std::vector<Task<void>> tasks) {
+    return WhenAll(std::move(tasks));
+}
+
+namespace detail {
+
+template <typename T>
+struct SyncWaitState {
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+    std::optional<T> value;
+    std::exception_ptr error;
+};
+
+template <>
+struct SyncWaitState<void> {
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+    std::exception_ptr error;
+};
+
+template <typename T>
+DetachedTask syncWaitDriver(Task<T>& task, SyncWaitState<T>& state) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+        } else {
+            state.value.emplace(co_await task);
+        }
+    } catch (...) {
+        state.error = std::current_exception();
+    }
+    // Notify under the lock: the waiter owns the state and returns as soon
+    // as it can observe done.
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.done = true;
+    state.finished.notify_all();
+}
+
+}  // namespace detail
+
+// Blocks the calling thread until the task finishes and returns its result.
+template <typename T>
+T syncWait(Task<T> task) {
+    detail::SyncWaitState<T> state;
+    detail::syncWaitDriver(task, state).handle.resume();
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.finished.wait(lock, [&state] { return state.done; });
+    }
+    if (state.error) {
+        std::rethrow_exception(state.error);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*state.value);
+    }
+}
+
+// Small fixed set of threads that resume coroutines. Filesystem calls are
+// synchronous and block the thread running them, so at most size() of them
+// make progress at a time.
+class AsyncExecutor {
+public:
+    // threadCount == 0 uses one thread per CPU.
+    explicit AsyncExecutor(std::size_t threadCount = 0);
+    ~AsyncExecutor();
+
+    AsyncExecutor(const AsyncExecutor&) = delete;
+    AsyncExecutor& operator=(const AsyncExecutor&) = delete;
+
+    std::size_t size() const noexcept;
+
+    void post(std::coroutine_handle<> handle);
+
+    // co_await executor.schedule() continues the coroutine on an executor thread.
+    auto schedule() noexcept {
+        struct Awaiter {
+            AsyncExecutor& executor;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { executor.post(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::coroutine_handle<>> ready_;
+    bool stopping_ = false;
+};
+
+struct AsyncMoveResult {
+    MoveOutcome outcome;
+    fs::path destination;
+    std::error_code error;
+};
+
+// Awaitable versions of the engine's steps. Each coroutine that touches the
+// filesystem hops onto the executor first, so callers never block on I/O.
+class AsyncRelocator {
+public:
+    AsyncRelocator(Relocator& relocator, AsyncExecutor& executor);
+
+    // Regular files below source, in traversal order.
+    Task<std::vector<fs::path>> scan(fs::path source);
+    // Pure CPU work; completes without leaving the awaiting thread.
+    Task<bool> classify(fs::path file, MediaType mediaType);
+    // Reserves a free name for filename in destination. The destination's
+    // index stays pinned for the life of this AsyncRelocator, so the name is
+    // still reserved when move() runs.
+    Task<fs::path> place(fs::path destination, fs::path filename);
+    // Renames (or copies and deletes) one file to a name reserved by place().
+    Task<AsyncMoveResult> move(fs::path destination, PlannedMove plannedMove);
+    // plan() followed by the moves, one coroutine per executor thread each
+    // taking the next planned file, so memory does not grow with the plan.
+    // Moves are reported to the relocator's metrics and callbacks as in
+    // Relocator::execute(). The token is checked on the executor right
+    // before each move.
+    Task<RelocationSummary> run(RelocationJob job, CancellationToken token = CancellationToken());
+
+private:
+    Task<void> moveLoop(const RelocationPlan& plan, std::atomic<std::size_t>& next, MoveTally& tally,
+                        const CancellationToken& token);
+
+    std::shared_ptr<DestinationIndex> pin(const fs::path& destination);
+
+    Relocator& relocator_;
+    AsyncExecutor& executor_;
+    std::mutex pinsMutex_;
+    std::map<fs::path, std::shared_ptr<DestinationIndex>> pins_;
+};
@@ -0,0 +1,289 @@
+#include "ReelocatorCApi.h"
+
+#include "ReelocatorCore.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+struct CJob {
+    explicit CJob(std::uint64_t jobId) : id(jobId) {}
+
+    const std::uint64_t id;
+    CancellationToken token;
+    std::atomic<std::int32_t> state{REELOCATOR_JOB_PLANNING};
+    std::atomic<std::uint64_t> planned{0};
+    std::atomic<std::uint64_t> completed{0};
+    std::atomic<std::uint64_t> moved{0};
+    std::atomic<std::uint64_t> skipped{0};
+    std::atomic<std::uint64_t> bytesMoved{0};
+    std::string errorMessage;
+    bool finished = false;
+    std::thread thread;
+};
+
+bool isTerminal(std::int32_t state) {
+    return state == REELOCATOR_JOB_DONE || state == REELOCATOR_JOB_FAILED || state == REELOCATOR_JOB_CANCELLED;
+}
+
+}  // namespace
+
+struct reelocator_engine {
+    reelocator_event_callback callback = nullptr;
+    void* userData = nullptr;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<std::uint64_t, std::shared_ptr<CJob>> jobs;
+    std::uint64_t nextJobId = 1;
+
+    std::unique_ptr<Relocator> relocator;
+
+    std::shared_ptr<CJob> find(std::uint64_t jobId) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = jobs.find(jobId);
+        return it == jobs.end() ? nullptr : it->second;
+    }
+};
+
+namespace {
+
+void deliverEvent(reelocator_engine* engine, const RelocationEvent& event) {
+    if (engine->callback == nullptr) {
+        return;
+    }
+
+#ifdef _WIN32
+    const std::string source = event.source.string();
+    const std::string destination = event.destination.string();
+#else
+    const std::string& source = event.source.native();
+    const std::string& destination = event.destination.native();
+#endif
+
+    reelocator_event out;
+    out.job_id = event.jobId;
+    out.outcome = static_cast<std::int32_t>(event.outcome);
+    out.error_code = event.error.value();
+    out.source = source.c_str();
+    out.source_length = source.size();
+    out.destination = destination.c_str();
+    out.destination_length = destination.size();
+    engine->callback(&out, engine->userData);
+}
+
+// Runs on every move, so it writes straight into the job it was bound to in
+// runJob() rather than looking the job up under the engine mutex.
+void recordProgress(CJob* job, const RelocationProgress& progress) {
+    job->completed.store(progress.completed, std::memory_order_relaxed);
+    job->moved.store(progress.moved, std::memory_order_relaxed);
+    job->skipped.store(progress.skipped, std::memory_order_relaxed);
+    job->bytesMoved.store(progress.bytesMoved, std::memory_order_relaxed);
+}
+
+void finishJob(reelocator_engine* engine, CJob& job, std::int32_t state, std::string errorMessage) {
+    {
+        std::lock_guard<std::mutex> lock(engine->mutex);
+        job.errorMessage = std::move(errorMessage);
+        job.state.store(state);
+        job.finished = true;
+    }
+    engine->changed.notify_all();
+}
+
+void runJob(reelocator_engine* engine, const std::shared_ptr<CJob>& job, RelocationJob relocationJob) {
+    // `job` outlives plan() and execute(), so the raw pointer stays valid for
+    // every callback.
+    relocationJob.onProgress = [raw = job.get()](const RelocationProgress& progress) { recordProgress(raw, progress); };
+    try {
+        const RelocationPlan plan = engine->relocator->plan(relocationJob, job->token);
+        job->planned.store(plan.moveCount(), std::memory_order_relaxed);
+        job->state.store(REELOCATOR_JOB_MOVING);
+
+        const RelocationSummary summary = engine->relocator->execute(plan, job->token);
+        job->moved.store(summary.moved, std::memory_order_relaxed);
+        job->skipped.store(summary.skipped, std::memory_order_relaxed);
+        job->bytesMoved.store(summary.bytesMoved, std::memory_order_relaxed);
+        finishJob(engine, *job, summary.cancelled ? REELOCATOR_JOB_CANCELLED : REELOCATOR_JOB_DONE, {});
+    } catch (const std::exception& ex) {
+        finishJob(engine, *job, REELOCATOR_JOB_FAILED, ex.what());
+    } catch (...) {
+        finishJob(engine, *job, REELOCATOR_JOB_FAILED, "unknown error");
+    }
+}
+
+}  // namespace
+
+extern "C" {
+
+uint32_t reelocator_abi_version(void) {
+    return REELOCATOR_ABI_VERSION;
+}
+
+const char* reelocator_status_string(int32_t status) {
+    switch (status) {
+        case REELOCATOR_OK:
+            return "ok";
+        case REELOCATOR_E_INVALID_ARGUMENT:
+            return "invalid argument";
+        case REELOCATOR_E_NOT_FOUND:
+            return "job not found";
+        case REELOCATOR_E_TIMEOUT:
+            return "timed out";
+        case REELOCATOR_E_INTERNAL:
+            return "internal error";
+        default:
+            return "unknown status";
+    }
+}
+
+reelocator_engine* reelocator_engine_create(uint32_t worker_threads, reelocator_event_callback callback,
+                                            void* user_data) {
+    try {
+        auto engine = std::make_unique<reelocator_engine>();
+        engine->callback = callback;
+        engine->userData = user_data;
+
+        reelocator_engine* raw = engine.get();
+        RelocatorOptions options;
+        options.workerThreads = worker_threads;
+        options.onEvent = [raw](const RelocationEvent& event) { deliverEvent(raw, event); };
+        engine->relocator = std::make_unique<Relocator>(std::move(options));
+        return engine.release();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void reelocator_engine_destroy(reelocator_engine* engine) {
+    if (engine == nullptr) {
+        return;
+    }
+
+    std::map<std::uint64_t, std::shared_ptr<CJob>> jobs;
+    {
+        std::lock_guard<std::mutex> lock(engine->mutex);
+        jobs = engine->jobs;
+    }
+    for (auto& entry : jobs) {
+        entry.second->token.cancel();
+    }
+    for (auto& entry : jobs) {
+        if (entry.second->thread.joinable()) {
+            entry.second->thread.join();
+        }
+    }
+    delete engine;
+}
+
+int32_t reelocator_submit(reelocator_engine* engine, int32_t media_type, const char* source, const char* destination,
+                          uint64_t* job_id) {
+    if (engine == nullptr || source == nullptr || destination == nullptr || job_id == nullptr ||
+        (media_type != REELOCATOR_MEDIA_IMAGES && media_type != REELOCATOR_MEDIA_VIDEOS)) {
+        return REELOCATOR_E_INVALID_ARGUMENT;
+    }
+
+    try {
+        std::lock_guard<std::mutex> lock(engine->mutex);
+        const std::uint64_t id = engine->nextJobId++;
+        auto job = std::make_shared<CJob>(id);
+        RelocationJob relocationJob{media_type == REELOCATOR_MEDIA_IMAGES ? MediaType::Images : MediaType::Videos,
+                                    source, destination, id};
+        engine->jobs.emplace(id, job);
+        job->thread = std::thread(runJob, engine, job, std::move(relocationJob));
+        *job_id = id;
+        return REELOCATOR_OK;
+    } catch (...) {
+        return REELOCATOR_E_INTERNAL;
+    }
+}
+
+int32_t reelocator_poll(reelocator_engine* engine, uint64_t job_id, reelocator_progress* progress) {
+    if (engine == nullptr || progress == nullptr) {
+        return REELOCATOR_E_INVALID_ARGUMENT;
+    }
+    const std::shared_ptr<CJob> job = engine->find(job_id);
+    if (!job) {
+        return REELOCATOR_E_NOT_FOUND;
+    }
+
+    progress->job_id = job->id;
+    progress->state = job->state.load();
+    progress->planned = job->planned.load(std::memory_order_relaxed);
+    progress->completed = job->completed.load(std::memory_order_relaxed);
+    progress->moved = job->moved.load(std::memory_order_relaxed);
+    progress->skipped = job->skipped.load(std::memory_order_relaxed);
+    progress->bytes_moved = job->bytesMoved.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(engine->mutex);
+    std::strncpy(progress->error_message, job->errorMessage.c_str(), sizeof(progress->error_message) - 1);
+    progress->error_message[sizeof(progress->error_message) - 1] = '\0';
+    return REELOCATOR_OK;
+}
+
+int32_t reelocator_wait(reelocator_engine* engine, uint64_t job_id, int32_t timeout_ms) {
+    if (engine == nullptr) {
+        return REELOCATOR_E_INVALID_ARGUMENT;
+    }
+
+    std::unique_lock<std::mutex> lock(engine->mutex);
+    const auto it = engine->jobs.find(job_id);
+    if (it == engine->jobs.end()) {
+        return REELOCATOR_E_NOT_FOUND;
+    }
+    const std::shared_ptr<CJob> job = it->second;
+
+    if (timeout_ms < 0) {
+        engine->changed.wait(lock, [&job] { return job->finished; });
+        return REELOCATOR_OK;
+    }
+    const bool finished =
+        engine->changed.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&job] { return job->finished; });
+    return finished ? REELOCATOR_OK : REELOCATOR_E_TIMEOUT;
+}
+
+int32_t reelocator_cancel(reelocator_engine* engine, uint64_t job_id) {
+    if (engine == nullptr) {
+        return REELOCATOR_E_INVALID_ARGUMENT;
+    }
+    const std::shared_ptr<CJob> job = engine->find(job_id);
+    if (!job) {
+        return REELOCATOR_E_NOT_FOUND;
+    }
+    if (!isTerminal(job->state.load())) {
+        job->token.cancel();
+    }
+    return REELOCATOR_OK;
+}
+
+int32_t reelocator_release(reelocator_engine* engine, uint64_t job_id) {
+    const int32_t status = reelocator_wait(engine, job_id, -1);
+    if (status != REELOCATOR_OK) {
+        return status;
+    }
+
+    std::shared_ptr<CJob> job;
+    {
+        std::lock_guard<std::mutex> lock(engine->mutex);
+        const auto it = engine->jobs.find(job_id);
+        if (it == engine->jobs.end()) {
+            return REELOCATOR_E_NOT_FOUND;
+        }
+        job = it->second;
+        engine->jobs.erase(it);
+    }
+    if (job->thread.joinable()) {
+        job->thread.join();
+    }
+    return REELOCATOR_OK;
+}
+
+}  // extern "C"
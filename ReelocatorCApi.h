@@ -0,0 +1,109 @@
+#ifndef REELOCATOR_C_API_H
+#define REELOCATOR_C_API_H
+
+/*
+ * Stable C ABI over the Relocator engine, built as the `reelocator` shared
+ * library. All handles are opaque; all functions are thread-safe.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(REELOCATOR_BUILDING_SHARED)
+#define REELOCATOR_API __declspec(dllexport)
+#else
+#define REELOCATOR_API __declspec(dllimport)
+#endif
+#else
+#define REELOCATOR_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REELOCATOR_ABI_VERSION 1
+
+typedef struct reelocator_engine reelocator_engine;
+
+typedef enum reelocator_status {
+    REELOCATOR_OK = 0,
+    REELOCATOR_E_INVALID_ARGUMENT = -1,
+    REELOCATOR_E_NOT_FOUND = -2,
+    REELOCATOR_E_TIMEOUT = -3,
+    REELOCATOR_E_INTERNAL = -4
+} reelocator_status;
+
+typedef enum reelocator_media_type {
+    REELOCATOR_MEDIA_IMAGES = 0,
+    REELOCATOR_MEDIA_VIDEOS = 1
+} reelocator_media_type;
+
+typedef enum reelocator_outcome {
+    REELOCATOR_OUTCOME_RENAMED = 0,
+    REELOCATOR_OUTCOME_COPIED = 1,
+    REELOCATOR_OUTCOME_SKIPPED = 2
+} reelocator_outcome;
+
+typedef enum reelocator_job_state {
+    REELOCATOR_JOB_PLANNING = 0,
+    REELOCATOR_JOB_MOVING = 1,
+    REELOCATOR_JOB_DONE = 2,
+    REELOCATOR_JOB_FAILED = 3,
+    REELOCATOR_JOB_CANCELLED = 4
+} reelocator_job_state;
+
+/*
+ * Delivered once per processed file. The event and the strings it points at
+ * are borrowed from the engine and are valid only until the callback returns;
+ * strings are not NUL-terminated copies but views of the engine's own paths.
+ * Callbacks run on worker threads, possibly concurrently.
+ */
+typedef struct reelocator_event {
+    uint64_t job_id;
+    int32_t outcome;    /* reelocator_outcome */
+    int32_t error_code; /* errno-style value, 0 on success */
+    const char* source;
+    size_t source_length;
+    const char* destination;
+    size_t destination_length;
+} reelocator_event;
+
+typedef void (*reelocator_event_callback)(const reelocator_event* event, void* user_data);
+
+typedef struct reelocator_progress {
+    uint64_t job_id;
+    int32_t state; /* reelocator_job_state */
+    uint64_t planned;
+    uint64_t completed;
+    uint64_t moved;
+    uint64_t skipped;
+    uint64_t bytes_moved;
+    char error_message[256];
+} reelocator_progress;
+
+REELOCATOR_API uint32_t reelocator_abi_version(void);
+REELOCATOR_API const char* reelocator_status_string(int32_t status);
+
+/* worker_threads == 0 uses one thread per CPU. callback may be NULL. */
+REELOCATOR_API reelocator_engine* reelocator_engine_create(uint32_t worker_threads, reelocator_event_callback callback,
+                                                           void* user_data);
+/* Cancels outstanding jobs, waits for them and frees the engine. */
+REELOCATOR_API void reelocator_engine_destroy(reelocator_engine* engine);
+
+/* Starts a job in the background and returns its id. */
+REELOCATOR_API int32_t reelocator_submit(reelocator_engine* engine, int32_t media_type, const char* source,
+                                         const char* destination, uint64_t* job_id);
+REELOCATOR_API int32_t reelocator_poll(reelocator_engine* engine, uint64_t job_id, reelocator_progress* progress);
+/* timeout_ms < 0 waits forever. */
+REELOCATOR_API int32_t reelocator_wait(reelocator_engine* engine, uint64_t job_id, int32_t timeout_ms);
+REELOCATOR_API int32_t reelocator_cancel(reelocator_engine* engine, uint64_t job_id);
+/* Waits for the job and forgets it; its id is no longer valid afterwards. */
+REELOCATOR_API int32_t reelocator_release(reelocator_engine* engine, uint64_t job_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REELOCATOR_C_API_H */
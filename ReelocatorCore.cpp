@@ -1,8 +1,278 @@
 #include "ReelocatorCore.hpp"
+#include "ReelocatorIdentitySet.hpp"
+#include "ReelocatorPlanStore.hpp"
+#include "ReelocatorProbes.hpp"
 
 #include <algorithm>
 #include <cctype>
-#include <set>
+#include <charconv>
+#include <istream>
+#include <iterator>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+fs::path numberedFilename(const fs::path& filename, int counter) {
+    return filename.stem().string() + "_" + std::to_string(counter) + filename.extension().string();
+}
+
+constexpr std::string_view kImageExtensions[] = {"jpg",  "jpeg", "png",  "gif",  "bmp",
+                                                 "tiff", "tif",  "webp", "heic", "ico"};
+constexpr std::string_view kVideoExtensions[] = {"mp4", "mov", "avi",  "mkv",  "wmv",
+                                                 "flv", "webm", "mpeg", "mpg", "m4v"};
+constexpr std::size_t kMaxExtensionLength = 8;
+
+bool isSeparator(fs::path::value_type ch) {
+    return ch == '/' || ch == fs::path::preferred_separator;
+}
+
+// Offset of the dot that starts the extension of the path's last component,
+// or the path's length when there is none. Matches fs::path::extension(): a
+// leading dot (".profile") and ".." do not start an extension.
+std::size_t extensionOffset(const fs::path::string_type& path) {
+    std::size_t end = path.size();
+    while (end > 0 && path[end - 1] != '.' && !isSeparator(path[end - 1])) {
+        --end;
+    }
+    if (end == 0 || path[end - 1] != '.') {
+        return path.size();
+    }
+
+    const std::size_t dot = end - 1;
+    const bool leadingDot = dot == 0 || isSeparator(path[dot - 1]);
+    const bool dotDot = dot + 1 == path.size() && path[dot - 1] == '.' && (dot == 1 || isSeparator(path[dot - 2]));
+    return leadingDot || dotDot ? path.size() : dot;
+}
+
+// Works on the native string with a stack buffer, so classifying a file never
+// allocates.
+bool hasExtension(const fs::path& filePath, const std::string_view (&extensions)[10]) {
+    const fs::path::string_type& native = filePath.native();
+    const std::size_t dot = extensionOffset(native);
+    const std::size_t length = native.size() - std::min(dot + 1, native.size());
+    if (length == 0 || length > kMaxExtensionLength) {
+        return false;
+    }
+
+    char lowered[kMaxExtensionLength];
+    for (std::size_t i = 0; i < length; ++i) {
+        const auto code = static_cast<std::make_unsigned_t<fs::path::value_type>>(native[dot + 1 + i]);
+        if (code > 0x7F) {
+            return false;
+        }
+        lowered[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(code)));
+    }
+    const std::string_view extension(lowered, length);
+    return std::find(std::begin(extensions), std::end(extensions), extension) != std::end(extensions);
+}
+
+// directory / filename for a plain filename, built in one string instead of
+// the several reallocations operator/ makes.
+fs::path joinFilename(const fs::path& directory, const fs::path::string_type& filename) {
+    const fs::path::string_type& prefix = directory.native();
+    fs::path::string_type joined;
+    joined.reserve(prefix.size() + 1 + filename.size());
+    joined.append(prefix);
+    if (!prefix.empty() && !isSeparator(prefix.back())) {
+        joined.push_back(fs::path::preferred_separator);
+    }
+    joined.append(filename);
+    return fs::path(std::move(joined));
+}
+
+void appendNumber(fs::path::string_type& text, int number) {
+    char digits[16];
+    const std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), number);
+    text.append(digits, result.ptr);
+}
+
+const char* spanName(MetricOperation operation) {
+    switch (operation) {
+        case MetricOperation::Classify:
+            return "classify";
+        case MetricOperation::Name:
+            return "name";
+        case MetricOperation::Rename:
+            return "rename";
+        case MetricOperation::Copy:
+            return "copy";
+    }
+    return "unknown";
+}
+
+// Feeds one clock reading pair to the metrics histogram and the trace
+// recorder; reads no clock at all when neither is attached.
+class TimedOperation {
+public:
+    TimedOperation(RelocationMetrics* metrics, MetricOperation operation, TraceRecorder* tracer)
+        : metrics_(metrics), operation_(operation), tracer_(tracer) {
+        if (metrics_ != nullptr || tracer_ != nullptr) {
+            start_ = TraceRecorder::Clock::now();
+        }
+    }
+
+    ~TimedOperation() {
+        if (metrics_ == nullptr && tracer_ == nullptr) {
+            return;
+        }
+        const auto end = TraceRecorder::Clock::now();
+        if (metrics_ != nullptr) {
+            metrics_->observe(operation_, end - start_);
+        }
+        if (tracer_ != nullptr) {
+            tracer_->record(spanName(operation_), start_, end);
+        }
+    }
+
+    TimedOperation(const TimedOperation&) = delete;
+    TimedOperation& operator=(const TimedOperation&) = delete;
+
+private:
+    RelocationMetrics* metrics_;
+    MetricOperation operation_;
+    TraceRecorder* tracer_;
+    TraceRecorder::Clock::time_point start_{};
+};
+
+void setStages(RelocationMetrics* metrics, RelocationStageId stage, RelocationStageState state) {
+    if (metrics != nullptr) {
+        metrics->setStageState(stage, state);
+    }
+}
+
+// The destination's directory as the traversal of `source` would reach it,
+// when the destination lies inside the source. Found by comparing the
+// source's (device, inode) with the resolved destination and each of its
+// ancestors, so symlinked and differently spelled paths are caught too. A
+// depth of -1 means nothing to prune, including when a lookup fails.
+struct PrunedSubtree {
+    fs::path path;
+    int depth = -1;
+};
+
+PrunedSubtree destinationInsideSource(FileSystem& fileSystem, const fs::path& source, const fs::path& destination) {
+    std::error_code error;
+    const FileIdentity sourceIdentity = fileSystem.identity(source, error);
+    if (error) {
+        return {};
+    }
+    const fs::path resolved = fileSystem.canonical(destination, error);
+    if (error) {
+        return {};
+    }
+
+    for (fs::path ancestor = resolved.parent_path(); !ancestor.empty(); ancestor = ancestor.parent_path()) {
+        const FileIdentity identity = fileSystem.identity(ancestor, error);
+        if (!error && identity == sourceIdentity) {
+            const fs::path relative = resolved.lexically_relative(ancestor);
+            PrunedSubtree pruned{source, -1};
+            for (const fs::path& component : relative) {
+                pruned.path /= component;
+                ++pruned.depth;
+            }
+            return pruned;
+        }
+        if (ancestor == ancestor.root_path()) {
+            break;
+        }
+    }
+    return {};
+}
+
+struct DirectoryListing {
+    std::vector<fs::directory_entry> files;
+    std::vector<std::pair<fs::path, FileIdentity>> directories;
+};
+
+// Regular files of `directory` and its subdirectories, symlinked or not, that
+// earlier levels have not entered, both sorted by path so that neither
+// readdir order nor thread timing shows in the plan. Costs one stat per
+// subdirectory and per symlink on top of the plain walk.
+DirectoryListing listDirectory(FileSystem& fileSystem, const fs::path& directory, const IdentitySet& visited) {
+    DirectoryListing listing;
+    fs::directory_iterator end;
+    fs::directory_iterator it;
+    try {
+        it = fileSystem.openDirectory(directory);
+    } catch (const fs::filesystem_error& ex) {
+        // Matches skip_permission_denied in the plain walk.
+        if (ex.code() == std::errc::permission_denied) {
+            return listing;
+        }
+        throw;
+    }
+
+    for (; it != end; fileSystem.increment(it)) {
+        const fs::directory_entry& entry = *it;
+        std::error_code error;
+        if (entry.is_directory(error)) {
+            const FileIdentity identity = fileSystem.identity(entry.path(), error);
+            if (!error && !visited.contains(identity)) {
+                listing.directories.emplace_back(entry.path(), identity);
+            }
+        } else if (entry.is_regular_file(error)) {
+            listing.files.push_back(entry);
+        }
+    }
+
+    std::sort(listing.files.begin(), listing.files.end(),
+              [](const fs::directory_entry& a, const fs::directory_entry& b) { return a.path() < b.path(); });
+    std::sort(listing.directories.begin(), listing.directories.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    return listing;
+}
+
+// Breadth-first walk that follows directory symlinks. Each level is listed in
+// parallel. Then, on the calling thread and in level order, files are handed
+// to `visit` and subdirectories claim their identity in `visited`; a
+// directory reached through two links in one level always goes to the first
+// in that order. Names are therefore chosen the same way on every run.
+// Returns false when cancelled.
+template <typename Cancelled, typename Visit>
+bool walkFollowingSymlinks(FileSystem& fileSystem, ThreadPool& pool, JobPriority priority, const fs::path& source,
+                           IdentitySet& visited, TraceRecorder* tracer, Cancelled&& isCancelled, Visit&& visit) {
+    std::vector<fs::path> level{source};
+    while (!level.empty()) {
+        if (isCancelled()) {
+            return false;
+        }
+
+        std::vector<DirectoryListing> listings(level.size());
+        pool.parallelFor(level.size(), [&](std::size_t i) {
+            TraceSpan span(tracer, "scan");
+            listings[i] = listDirectory(fileSystem, level[i], visited);
+            span.setCount(listings[i].files.size() + listings[i].directories.size());
+        }, priority);
+
+        std::vector<fs::path> next;
+        for (DirectoryListing& listing : listings) {
+            for (const fs::directory_entry& file : listing.files) {
+                if (isCancelled()) {
+                    return false;
+                }
+                visit(file);
+            }
+            for (auto& directory : listing.directories) {
+                if (visited.insert(directory.second)) {
+                    next.push_back(std::move(directory.first));
+                }
+            }
+        }
+        level = std::move(next);
+    }
+    return true;
+}
+
+void recordError(RelocationMetrics* metrics, const std::error_code& error) {
+    if (metrics != nullptr) {
+        metrics->recordError(classifyError(error));
+    }
+}
+
+}  // namespace
 
 std::string toLower(std::string value) {
     std::transform(value.begin(), value.end(), value.begin(),
@@ -11,39 +281,589 @@ std::string toLower(std::string value) {
 }
 
 bool isTargetFile(const fs::path& filePath, MediaType mediaType) {
-    static const std::set<std::string> imageExtensions = {
-        ".jpg", ".jpeg", ".png", ".gif", ".bmp", ".tiff", ".tif", ".webp", ".heic", ".ico"
-    };
+    const bool matched = hasExtension(filePath, mediaType == MediaType::Images ? kImageExtensions : kVideoExtensions);
+    REELOCATOR_PROBE3(classified, filePath.c_str(), static_cast<int>(mediaType), static_cast<int>(matched));
+    return matched;
+}
 
-    static const std::set<std::string> videoExtensions = {
-        ".mp4", ".mov", ".avi", ".mkv", ".wmv", ".flv", ".webm", ".mpeg", ".mpg", ".m4v"
-    };
+fs::path getUniqueDestinationPath(const fs::path& destinationDir, const fs::path& filename) {
+    return getUniqueDestinationPath(destinationDir, filename, defaultFileSystem());
+}
+
+fs::path getUniqueDestinationPath(const fs::path& destinationDir, const fs::path& filename, FileSystem& fileSystem) {
+    fs::path candidate = destinationDir / filename;
+    if (!fileSystem.exists(candidate)) {
+        REELOCATOR_PROBE2(name_chosen, candidate.c_str(), 0);
+        return candidate;
+    }
 
-    const std::string ext = toLower(filePath.extension().string());
+    int counter = 1;
+    while (true) {
+        candidate = destinationDir / numberedFilename(filename, counter);
+        if (!fileSystem.exists(candidate)) {
+            REELOCATOR_PROBE2(name_chosen, candidate.c_str(), counter);
+            return candidate;
+        }
+        ++counter;
+    }
+}
 
-    if (mediaType == MediaType::Images) {
-        return imageExtensions.find(ext) != imageExtensions.end();
+bool parseMediaType(const std::string& text, MediaType& mediaType) {
+    const std::string normalized = toLower(text);
+    if (normalized == "1" || normalized == "images" || normalized == "image") {
+        mediaType = MediaType::Images;
+        return true;
     }
+    if (normalized == "2" || normalized == "videos" || normalized == "video") {
+        mediaType = MediaType::Videos;
+        return true;
+    }
+    return false;
+}
 
-    return videoExtensions.find(ext) != videoExtensions.end();
+const char* mediaTypeLabel(MediaType mediaType) {
+    return mediaType == MediaType::Images ? "images" : "videos";
 }
 
-fs::path getUniqueDestinationPath(const fs::path& destinationDir, const fs::path& filename) {
-    fs::path candidate = destinationDir / filename;
-    if (!fs::exists(candidate)) {
+std::vector<RelocationJob> parseJobManifest(std::istream& in) {
+    std::vector<RelocationJob> jobs;
+    std::string line;
+    std::size_t lineNumber = 0;
+
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        const std::size_t firstTab = line.find('\t');
+        const std::size_t secondTab = firstTab == std::string::npos ? std::string::npos : line.find('\t', firstTab + 1);
+        if (secondTab == std::string::npos || line.find('\t', secondTab + 1) != std::string::npos) {
+            throw std::invalid_argument("manifest line " + std::to_string(lineNumber) +
+                                        ": expected <type>\\t<source>\\t<destination>");
+        }
+
+        RelocationJob job{MediaType::Images, line.substr(firstTab + 1, secondTab - firstTab - 1),
+                          line.substr(secondTab + 1)};
+        if (!parseMediaType(line.substr(0, firstTab), job.mediaType)) {
+            throw std::invalid_argument("manifest line " + std::to_string(lineNumber) +
+                                        ": unknown media type '" + line.substr(0, firstTab) + "'");
+        }
+        if (job.source.empty() || job.destination.empty()) {
+            throw std::invalid_argument("manifest line " + std::to_string(lineNumber) +
+                                        ": source and destination must not be empty");
+        }
+        jobs.push_back(std::move(job));
+    }
+
+    return jobs;
+}
+
+DestinationIndex::DestinationIndex(fs::path directory) : directory_(std::move(directory)) {}
+
+void DestinationIndex::load(FileSystem& fileSystem) {
+    // Read before listing, so a name added during the scan shows up as a
+    // later write.
+    std::error_code timeError;
+    const fs::file_time_type writeTime = fileSystem.lastWriteTime(directory_, timeError);
+
+    std::unordered_set<fs::path::string_type> names;
+    fs::directory_iterator end;
+    for (auto it = fileSystem.openDirectory(directory_); it != end; fileSystem.increment(it)) {
+        names.insert(it->path().filename().native());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    names_ = std::move(names);
+    loaded_ = true;
+    writeTime_ = writeTime;
+    hasWriteTime_ = !timeError;
+}
+
+void DestinationIndex::settle(FileSystem& fileSystem) {
+    std::error_code error;
+    const fs::file_time_type writeTime = fileSystem.lastWriteTime(directory_, error);
+    std::lock_guard<std::mutex> lock(mutex_);
+    writeTime_ = writeTime;
+    hasWriteTime_ = !error;
+}
+
+bool DestinationIndex::current(FileSystem& fileSystem) const {
+    std::error_code error;
+    const fs::file_time_type writeTime = fileSystem.lastWriteTime(directory_, error);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !error && hasWriteTime_ && writeTime == writeTime_;
+}
+
+bool DestinationIndex::loaded() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return loaded_;
+}
+
+const fs::path& DestinationIndex::directory() const {
+    return directory_;
+}
+
+std::size_t DestinationIndex::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return names_.size();
+}
+
+// Builds every numbered candidate in one buffer and copies only the chosen
+// name into the set, so a long collision chain costs no extra allocations.
+fs::path DestinationIndex::reserveUniquePath(const fs::path& filename) {
+    const fs::path::string_type& name = filename.native();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (names_.find(name) == names_.end()) {
+        names_.insert(name);
+        fs::path candidate = joinFilename(directory_, name);
+        REELOCATOR_PROBE2(name_chosen, candidate.c_str(), 0);
         return candidate;
     }
 
-    fs::path stem = filename.stem();
-    fs::path extension = filename.extension();
+    const std::size_t dot = extensionOffset(name);
+    fs::path::string_type numberedName;
+    numberedName.reserve(name.size() + 12);
+    numberedName.append(name, 0, dot).push_back('_');
+    const std::size_t prefixLength = numberedName.size();
 
     int counter = 1;
     while (true) {
-        fs::path numberedName = stem.string() + "_" + std::to_string(counter) + extension.string();
-        candidate = destinationDir / numberedName;
-        if (!fs::exists(candidate)) {
+        numberedName.resize(prefixLength);
+        appendNumber(numberedName, counter);
+        numberedName.append(name, dot, fs::path::string_type::npos);
+        if (names_.find(numberedName) == names_.end()) {
+            names_.insert(numberedName);
+            fs::path candidate = joinFilename(directory_, numberedName);
+            REELOCATOR_PROBE2(name_chosen, candidate.c_str(), counter);
             return candidate;
         }
         ++counter;
     }
 }
+
+void DestinationIndex::markTaken(const fs::path& filename) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    names_.insert(filename.native());
+}
+
+void DestinationIndex::release(const fs::path& filename) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    names_.erase(filename.native());
+}
+
+CancellationToken::CancellationToken() : flag_(std::make_shared<std::atomic<bool>>(false)) {}
+
+void CancellationToken::cancel() noexcept {
+    flag_->store(true, std::memory_order_relaxed);
+}
+
+bool CancellationToken::cancelled() const noexcept {
+    return flag_->load(std::memory_order_relaxed);
+}
+
+namespace {
+
+std::size_t resolveWorkerThreads(std::size_t requested) {
+    if (requested != 0) {
+        return requested;
+    }
+    const unsigned hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : hardware;
+}
+
+}  // namespace
+
+Relocator::Relocator(RelocatorOptions options)
+    : options_(std::move(options)),
+      fileSystem_(options_.fileSystem != nullptr ? *options_.fileSystem : defaultFileSystem()),
+      pool_(resolveWorkerThreads(options_.workerThreads) - 1) {}
+
+std::size_t Relocator::workerThreads() const noexcept {
+    return pool_.size() + 1;
+}
+
+FileSystem& Relocator::fileSystem() noexcept {
+    return fileSystem_;
+}
+
+void Relocator::cancel() noexcept {
+    cancelEpoch_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::shared_ptr<DestinationIndex> Relocator::destinationIndexFor(const fs::path& destination) {
+    const fs::path key = destination.lexically_normal();
+    std::shared_ptr<DestinationIndex> index;
+    bool idle = false;
+    {
+        std::lock_guard<std::mutex> lock(indexesMutex_);
+        CachedIndex& cached = indexes_[key];
+        cached.lastUsed = ++indexUseClock_;
+        const bool created = !cached.index;
+        if (created) {
+            cached.index = std::make_shared<DestinationIndex>(destination);
+        }
+        index = cached.index;
+        // Held only by the map and by `index`.
+        idle = index.use_count() == 2;
+        if (created) {
+            evictIdleIndexes();
+        }
+    }
+
+    // A warm index that no job is using may have missed writes by other
+    // programs. One stat decides whether to keep it or scan again. An index
+    // in use is kept either way, because moveFile() already retries names
+    // that turn out to be taken.
+    if (idle && index->loaded() && !index->current(fileSystem_)) {
+        auto fresh = std::make_shared<DestinationIndex>(destination);
+        std::lock_guard<std::mutex> lock(indexesMutex_);
+        CachedIndex& cached = indexes_[key];
+        if (cached.index == index) {
+            cached.index = std::move(fresh);
+        }
+        index = cached.index;
+    }
+
+    if (!index->loaded()) {
+        index->load(fileSystem_);
+    }
+    return index;
+}
+
+std::shared_ptr<DestinationIndex> Relocator::destinationIndexFor(const RelocationPlan& plan) {
+    return plan.index ? plan.index : destinationIndexFor(plan.job.destination);
+}
+
+// Requires indexesMutex_.
+void Relocator::evictIdleIndexes() {
+    while (indexes_.size() > options_.maxDestinationIndexes) {
+        auto oldest = indexes_.end();
+        for (auto it = indexes_.begin(); it != indexes_.end(); ++it) {
+            const bool idle = it->second.index.use_count() == 1;
+            if (idle && (oldest == indexes_.end() || it->second.lastUsed < oldest->second.lastUsed)) {
+                oldest = it;
+            }
+        }
+        if (oldest == indexes_.end()) {
+            return;
+        }
+        indexes_.erase(oldest);
+    }
+}
+
+std::size_t Relocator::releaseIdleDestinationIndexes() {
+    std::lock_guard<std::mutex> lock(indexesMutex_);
+    std::size_t released = 0;
+    for (auto it = indexes_.begin(); it != indexes_.end();) {
+        if (it->second.index.use_count() == 1) {
+            it = indexes_.erase(it);
+            ++released;
+        } else {
+            ++it;
+        }
+    }
+    return released;
+}
+
+RelocationPlan Relocator::plan(const RelocationJob& job, const CancellationToken& token) {
+    const std::uint64_t epoch = cancelEpoch_.load(std::memory_order_relaxed);
+    auto isCancelled = [&] { return token.cancelled() || cancelEpoch_.load(std::memory_order_relaxed) != epoch; };
+
+    // The traversal runs on the caller's thread, which keeps its own I/O
+    // priority once plan() returns.
+    ScopedIoPriority ioPriority;
+    ioPriority.set(job.priority);
+
+    RelocationPlan plan;
+    plan.jobId = job.id != 0 ? job.id : nextJobId_.fetch_add(1);
+    plan.job = job;
+
+    if (!fileSystem_.exists(job.source) || !fileSystem_.isDirectory(job.source)) {
+        throw RelocationError("Source path does not exist or is not a directory.");
+    }
+    if (fileSystem_.exists(job.destination) && fileSystem_.equivalent(job.source, job.destination)) {
+        throw RelocationError("Source and destination cannot be the same folder.");
+    }
+    try {
+        if (!fileSystem_.exists(job.destination)) {
+            fileSystem_.createDirectories(job.destination);
+        }
+    } catch (const fs::filesystem_error& ex) {
+        throw RelocationError(std::string("Cannot create destination directory: ") + ex.what());
+    }
+
+    RelocationMetrics* metrics = options_.metrics;
+    TraceRecorder* tracer = options_.tracer;
+    setStages(metrics, RelocationStageId::Scan, RelocationStageState::Running);
+
+    // Without this, files already moved into a destination under the source
+    // would be found again and renamed with new suffixes. The symlink walk
+    // excludes the destination by identity instead.
+    const PrunedSubtree pruned =
+        job.followSymlinks ? PrunedSubtree() : destinationInsideSource(fileSystem_, job.source, job.destination);
+
+    plan.index = destinationIndexFor(job.destination);
+    DestinationIndex& index = *plan.index;
+    if (options_.spillPlans) {
+        plan.spilled = std::make_shared<SpilledMoves>(options_.planSpill);
+    }
+    auto consider = [&](const fs::directory_entry& entry) {
+        REELOCATOR_PROBE1(file_discovered, entry.path().c_str());
+        ++plan.scanned;
+        if (metrics != nullptr) {
+            metrics->recordScanned();
+        }
+
+        bool isTarget = false;
+        {
+            TimedOperation timed(metrics, MetricOperation::Classify, tracer);
+            isTarget = isTargetFile(entry.path(), job.mediaType);
+        }
+        if (!isTarget) {
+            return;
+        }
+        if (metrics != nullptr) {
+            metrics->recordMatched();
+        }
+
+        std::error_code sizeError;
+        const std::uintmax_t size = fileSystem_.fileSize(entry, sizeError);
+
+        TimedOperation timed(metrics, MetricOperation::Name, tracer);
+        fs::path destination = index.reserveUniquePath(entry.path().filename());
+        if (plan.spilled) {
+            plan.spilled->add(entry.path(), destination, sizeError ? 0 : size);
+        } else {
+            plan.moves.push_back(PlannedMove{entry.path(), std::move(destination), sizeError ? 0 : size});
+        }
+    };
+
+    try {
+        if (job.followSymlinks) {
+            // The destination is seeded as visited, which also keeps the walk
+            // out of it when it is inside the source or linked from there.
+            IdentitySet visited;
+            visited.insert(fileSystem_.identity(job.source));
+            std::error_code destinationError;
+            const FileIdentity destination = fileSystem_.identity(job.destination, destinationError);
+            if (!destinationError) {
+                visited.insert(destination);
+            }
+            plan.cancelled = !walkFollowingSymlinks(fileSystem_, pool_, job.priority, job.source, visited, tracer,
+                                                    isCancelled, consider);
+        } else {
+            // One span for the whole walk: a span per entry would cost more
+            // than reading most entries does.
+            TraceSpan span(tracer, "scan");
+            std::uint64_t entries = 0;
+            fs::recursive_directory_iterator end;
+            auto it = fileSystem_.openRecursive(job.source, fs::directory_options::skip_permission_denied);
+            while (it != end) {
+                if (isCancelled()) {
+                    plan.cancelled = true;
+                    break;
+                }
+
+                const fs::directory_entry& entry = *it;
+                if (entry.is_regular_file()) {
+                    consider(entry);
+                }
+
+                // Checked by depth first, so other entries cost one compare.
+                if (it.depth() == pruned.depth && entry.path() == pruned.path) {
+                    it.disable_recursion_pending();
+                }
+
+                ++entries;
+                fileSystem_.increment(it);
+            }
+            span.setCount(entries);
+        }
+    } catch (const fs::filesystem_error& ex) {
+        recordError(metrics, ex.code());
+        setStages(metrics, RelocationStageId::Scan, RelocationStageState::Failed);
+        discard(plan);
+        throw;
+    }
+
+    setStages(metrics, RelocationStageId::Scan, RelocationStageState::Done);
+    return plan;
+}
+
+// Retries with the next free name whenever the index turns out to be stale
+// because another writer created the chosen name.
+MoveOutcome Relocator::moveFile(DestinationIndex& index, const PlannedMove& move, fs::path& finalDestination,
+                                std::error_code& error) {
+    const fs::path filename = move.source.filename();
+    RelocationMetrics* metrics = options_.metrics;
+    TraceRecorder* tracer = options_.tracer;
+    finalDestination = move.destination;
+
+    {
+        TimedOperation timed(metrics, MetricOperation::Rename, tracer);
+        fileSystem_.renameNoReplace(move.source, finalDestination, error);
+        while (error == std::errc::file_exists) {
+            finalDestination = index.reserveUniquePath(filename);
+            fileSystem_.renameNoReplace(move.source, finalDestination, error);
+        }
+    }
+    if (!error) {
+        return MoveOutcome::Renamed;
+    }
+    recordError(metrics, error);
+
+    {
+        TimedOperation timed(metrics, MetricOperation::Copy, tracer);
+        fileSystem_.copyFile(move.source, finalDestination, fs::copy_options::none, error);
+        while (error == std::errc::file_exists) {
+            finalDestination = index.reserveUniquePath(filename);
+            fileSystem_.copyFile(move.source, finalDestination, fs::copy_options::none, error);
+        }
+        if (!error) {
+            fileSystem_.remove(move.source, error);
+        }
+        // A skipped file stays only at its source: drop a partial target, or
+        // the full copy when the source could not be removed.
+        if (error) {
+            std::error_code ignored;
+            fileSystem_.remove(finalDestination, ignored);
+        }
+    }
+    if (!error) {
+        return MoveOutcome::Copied;
+    }
+
+    index.release(finalDestination.filename());
+    recordError(metrics, error);
+    return MoveOutcome::Skipped;
+}
+
+std::uintmax_t RelocationPlan::moveCount() const noexcept {
+    return spilled ? static_cast<std::uintmax_t>(spilled->size()) : moves.size();
+}
+
+RelocationSummary MoveTally::summary() const noexcept {
+    RelocationSummary summary;
+    summary.moved = moved.load();
+    summary.skipped = skipped.load();
+    summary.bytesMoved = bytesMoved.load();
+    summary.cancelled = cancelled.load();
+    return summary;
+}
+
+void Relocator::beginMoves() {
+    setStages(options_.metrics, RelocationStageId::Move, RelocationStageState::Running);
+}
+
+void Relocator::reportMove(const RelocationPlan& plan, const PlannedMove& move, MoveOutcome outcome,
+                           const fs::path& finalDestination, const std::error_code& error, MoveTally& tally) {
+    RelocationMetrics* metrics = options_.metrics;
+    if (outcome == MoveOutcome::Skipped) {
+        tally.skipped.fetch_add(1, std::memory_order_relaxed);
+        if (metrics != nullptr) {
+            metrics->recordSkipped();
+        }
+    } else {
+        tally.moved.fetch_add(1, std::memory_order_relaxed);
+        tally.bytesMoved.fetch_add(move.size, std::memory_order_relaxed);
+        if (metrics != nullptr) {
+            metrics->recordMoved(outcome == MoveOutcome::Renamed ? MoveMethod::Rename : MoveMethod::Copy, move.size);
+        }
+    }
+    const std::uintmax_t done = tally.completed.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    if (options_.onEvent) {
+        options_.onEvent(RelocationEvent{plan.jobId, outcome, move.source, finalDestination, error});
+    }
+    if (plan.job.onProgress || options_.onProgress) {
+        const RelocationProgress progress{plan.jobId, plan.moveCount(), done,
+                                          tally.moved.load(std::memory_order_relaxed),
+                                          tally.skipped.load(std::memory_order_relaxed),
+                                          tally.bytesMoved.load(std::memory_order_relaxed)};
+        if (plan.job.onProgress) {
+            plan.job.onProgress(progress);
+        }
+        if (options_.onProgress) {
+            options_.onProgress(progress);
+        }
+    }
+}
+
+RelocationSummary Relocator::endMoves(const RelocationPlan& plan, const MoveTally& tally) {
+    // The moves changed the directory's write time; they went through the
+    // index, so it still matches the directory.
+    if (tally.moved.load() != 0) {
+        destinationIndexFor(plan)->settle(fileSystem_);
+    }
+    setStages(options_.metrics, RelocationStageId::Move, RelocationStageState::Done);
+    return tally.summary();
+}
+
+RelocationSummary Relocator::execute(const RelocationPlan& plan, const CancellationToken& token) {
+    const std::uint64_t epoch = cancelEpoch_.load(std::memory_order_relaxed);
+    auto isCancelled = [&] { return token.cancelled() || cancelEpoch_.load(std::memory_order_relaxed) != epoch; };
+
+    beginMoves();
+    const std::shared_ptr<DestinationIndex> pinned = destinationIndexFor(plan);
+    DestinationIndex& index = *pinned;
+    MoveTally tally;
+    tally.cancelled.store(plan.cancelled);
+
+    auto moveOne = [&](const PlannedMove& move) {
+        if (tally.cancelled.load(std::memory_order_relaxed) || isCancelled()) {
+            tally.cancelled.store(true, std::memory_order_relaxed);
+            index.release(move.destination.filename());
+            return;
+        }
+
+        fs::path finalDestination;
+        std::error_code error;
+        const MoveOutcome outcome = moveFile(index, move, finalDestination, error);
+        reportMove(plan, move, outcome, finalDestination, error, tally);
+    };
+
+    if (plan.spilled) {
+        // One mapped chunk at a time; each record becomes a PlannedMove only
+        // while it is being moved.
+        for (std::size_t c = 0; c < plan.spilled->chunkCount(); ++c) {
+            const RecordSpill::Chunk chunk = plan.spilled->chunk(c);
+            const SpilledMoves::Record* records = SpilledMoves::records(chunk);
+            pool_.parallelFor(chunk.count(), [&](std::size_t i) {
+                moveOne(plan.spilled->move(records[i]));
+            }, plan.job.priority);
+        }
+    } else {
+        pool_.parallelFor(plan.moves.size(), [&](std::size_t i) { moveOne(plan.moves[i]); }, plan.job.priority);
+    }
+
+    return endMoves(plan, tally);
+}
+
+RelocationSummary Relocator::run(const RelocationJob& job, const CancellationToken& token) {
+    const RelocationPlan plan = this->plan(job, token);
+    return execute(plan, token);
+}
+
+void Relocator::discard(const RelocationPlan& plan) {
+    if (plan.moveCount() == 0) {
+        return;
+    }
+    const std::shared_ptr<DestinationIndex> pinned = destinationIndexFor(plan);
+    DestinationIndex& index = *pinned;
+    for (const PlannedMove& move : plan.moves) {
+        index.release(move.destination.filename());
+    }
+    if (plan.spilled) {
+        for (std::size_t c = 0; c < plan.spilled->chunkCount(); ++c) {
+            const RecordSpill::Chunk chunk = plan.spilled->chunk(c);
+            const SpilledMoves::Record* records = SpilledMoves::records(chunk);
+            for (std::size_t i = 0; i < chunk.count(); ++i) {
+                index.release(plan.spilled->destinationName(records[i]));
+            }
+        }
+    }
+}
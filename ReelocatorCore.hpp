@@ -1,7 +1,25 @@
 #pragma once
 
+#include "ReelocatorFileSystem.hpp"
+#include "ReelocatorMetrics.hpp"
+#include "ReelocatorSpill.hpp"
+#include "ReelocatorThreadPool.hpp"
+#include "ReelocatorTrace.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <system_error>
+#include <unordered_set>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -10,7 +28,249 @@ enum class MediaType {
     Videos
 };
 
+struct RelocationProgress;
+
+struct RelocationJob {
+    MediaType mediaType;
+    fs::path source;
+    fs::path destination;
+    // Reported as RelocationPlan::jobId; 0 lets Relocator::plan() assign one.
+    std::uint64_t id = 0;
+    // The CLI, the C API and the daemon all keep this default.
+    JobPriority priority = JobPriority::Interactive;
+    // Also descends into symlinked directories. Every directory is entered
+    // once by (device, inode), so link loops end and shared trees are not
+    // scanned twice. Directories are listed a level at a time on the pool.
+    bool followSymlinks = false;
+    // Called on worker threads after each of this job's moves, before
+    // RelocatorOptions::onProgress. Lets a caller update its own record of
+    // the job without looking it up by id.
+    std::function<void(const RelocationProgress&)> onProgress = nullptr;
+};
+
+// Lowercases in place in its by-value argument; pass an rvalue to avoid a copy.
 std::string toLower(std::string value);
+// Case-insensitive extension match; never allocates.
 bool isTargetFile(const fs::path& filePath, MediaType mediaType);
 fs::path getUniqueDestinationPath(const fs::path& destinationDir, const fs::path& filename);
+fs::path getUniqueDestinationPath(const fs::path& destinationDir, const fs::path& filename, FileSystem& fileSystem);
+
+bool parseMediaType(const std::string& text, MediaType& mediaType);
+const char* mediaTypeLabel(MediaType mediaType);
+
+// Reads one job per line as "<images|videos>\t<source>\t<destination>".
+// Blank lines and lines starting with '#' are ignored.
+std::vector<RelocationJob> parseJobManifest(std::istream& in);
+
+// In-memory view of the names present in a destination directory. It is loaded
+// with one directory scan and then answers getUniqueDestinationPath-style
+// queries without touching the filesystem, so it can be reused across jobs
+// that share a destination. All members are safe to call concurrently.
+class DestinationIndex {
+public:
+    explicit DestinationIndex(fs::path directory);
+
+    DestinationIndex(const DestinationIndex&) = delete;
+    DestinationIndex& operator=(const DestinationIndex&) = delete;
+
+    void load(FileSystem& fileSystem);
+    bool loaded() const;
+
+    // The index remembers the directory's write time from load(). settle()
+    // records it again once moves made through the index have changed the
+    // directory. current() is false when the directory was written since,
+    // by something that did not go through the index, or when its time
+    // cannot be read.
+    void settle(FileSystem& fileSystem);
+    bool current(FileSystem& fileSystem) const;
+
+    const fs::path& directory() const;
+    std::size_t size() const;
+
+    fs::path reserveUniquePath(const fs::path& filename);
+    void markTaken(const fs::path& filename);
+    void release(const fs::path& filename);
+
+private:
+    const fs::path directory_;
+    mutable std::mutex mutex_;
+    std::unordered_set<fs::path::string_type> names_;
+    bool loaded_ = false;
+    fs::file_time_type writeTime_{};
+    bool hasWriteTime_ = false;
+};
+
+class RelocationError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Shared cancellation flag. Copies observe the same flag, so a caller can keep
+// one copy and hand another to plan()/execute() running on a different thread.
+class CancellationToken {
+public:
+    CancellationToken();
+
+    void cancel() noexcept;
+    bool cancelled() const noexcept;
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+enum class MoveOutcome {
+    Renamed,
+    Copied,
+    Skipped,
+};
+
+struct PlannedMove {
+    fs::path source;
+    fs::path destination;
+    std::uintmax_t size;
+};
+
+class SpilledMoves;
 
+struct RelocationPlan {
+    std::uint64_t jobId = 0;
+    RelocationJob job{MediaType::Images, {}, {}};
+    // Empty when the moves are in `spilled` instead.
+    std::vector<PlannedMove> moves;
+    // Set by plan() when RelocatorOptions::spillPlans is on.
+    std::shared_ptr<SpilledMoves> spilled;
+    // The index the plan reserved its names in, kept alive for execute().
+    std::shared_ptr<DestinationIndex> index;
+    std::uintmax_t scanned = 0;
+    bool cancelled = false;
+
+    std::uintmax_t moveCount() const noexcept;
+};
+
+// Passed by reference to RelocatorOptions::onEvent; the paths are only valid
+// for the duration of the callback.
+struct RelocationEvent {
+    std::uint64_t jobId;
+    MoveOutcome outcome;
+    const fs::path& source;
+    const fs::path& destination;
+    std::error_code error;
+};
+
+struct RelocationProgress {
+    std::uint64_t jobId;
+    std::uintmax_t planned;
+    std::uintmax_t completed;
+    std::uintmax_t moved;
+    std::uintmax_t skipped;
+    std::uintmax_t bytesMoved;
+};
+
+struct RelocationSummary {
+    std::uintmax_t moved = 0;
+    std::uintmax_t skipped = 0;
+    std::uintmax_t bytesMoved = 0;
+    bool cancelled = false;
+};
+
+// Running totals of one plan's moves, updated from any thread.
+struct MoveTally {
+    std::atomic<std::uintmax_t> completed{0};
+    std::atomic<std::uintmax_t> moved{0};
+    std::atomic<std::uintmax_t> skipped{0};
+    std::atomic<std::uintmax_t> bytesMoved{0};
+    std::atomic<bool> cancelled{false};
+
+    RelocationSummary summary() const noexcept;
+};
+
+struct RelocatorOptions {
+    // Total threads moving files, including the caller of execute(); 0 uses
+    // std::thread::hardware_concurrency().
+    std::size_t workerThreads = 0;
+    FileSystem* fileSystem = nullptr;
+    RelocationMetrics* metrics = nullptr;
+    TraceRecorder* tracer = nullptr;
+    // Both callbacks run on worker threads and must be thread-safe.
+    std::function<void(const RelocationEvent&)> onEvent;
+    std::function<void(const RelocationProgress&)> onProgress;
+    // Keeps each plan's moves in SpilledMoves rather than RelocationPlan::moves,
+    // so plans past planSpill.memoryBudget go to spill files instead of the
+    // heap. The destination name index stays in memory.
+    bool spillPlans = false;
+    SpillOptions planSpill;
+    // Destination indexes kept loaded for later jobs. Past this many, the
+    // least recently used ones that no plan holds are dropped.
+    std::size_t maxDestinationIndexes = 64;
+};
+
+// Embeddable relocation engine. plan() validates a job, walks the source and
+// chooses every destination name; execute() performs the moves on the worker
+// pool. The pool and per-destination indexes live as long as the Relocator,
+// so later jobs against the same destination skip the rescan. An index is
+// rescanned anyway when its directory was written by something else since
+// its last job, and RelocatorOptions::maxDestinationIndexes bounds how many
+// are kept.
+class Relocator {
+public:
+    explicit Relocator(RelocatorOptions options = {});
+
+    Relocator(const Relocator&) = delete;
+    Relocator& operator=(const Relocator&) = delete;
+
+    // Throws RelocationError for invalid jobs and fs::filesystem_error when
+    // traversal fails.
+    RelocationPlan plan(const RelocationJob& job, const CancellationToken& token = CancellationToken());
+    RelocationSummary execute(const RelocationPlan& plan, const CancellationToken& token = CancellationToken());
+    RelocationSummary run(const RelocationJob& job, const CancellationToken& token = CancellationToken());
+
+    // Releases the names a plan reserved when it will not be executed.
+    void discard(const RelocationPlan& plan);
+
+    // Cancels every plan() and execute() call currently in flight.
+    void cancel() noexcept;
+
+    std::size_t workerThreads() const noexcept;
+    FileSystem& fileSystem() noexcept;
+
+    // Single-file steps behind plan() and execute(), for callers that schedule
+    // the work themselves. The index is loaded on first use and shared by
+    // every job with the same destination. Holding the returned pointer pins
+    // it: a pinned index is never evicted or swapped for a rescan, so names
+    // reserved through it stay reserved until the caller lets go. The plan
+    // overload returns the index the plan reserved its names in.
+    std::shared_ptr<DestinationIndex> destinationIndexFor(const fs::path& destination);
+    std::shared_ptr<DestinationIndex> destinationIndexFor(const RelocationPlan& plan);
+    MoveOutcome moveFile(DestinationIndex& index, const PlannedMove& move, fs::path& finalDestination,
+                         std::error_code& error);
+    // The bookkeeping execute() does around those steps: beginMoves() marks
+    // the move stage running, reportMove() adds one finished move to `tally`
+    // and passes it to the metrics and callbacks, and endMoves() settles the
+    // plan's index, marks the stage done and returns the summary.
+    void beginMoves();
+    void reportMove(const RelocationPlan& plan, const PlannedMove& move, MoveOutcome outcome,
+                    const fs::path& finalDestination, const std::error_code& error, MoveTally& tally);
+    RelocationSummary endMoves(const RelocationPlan& plan, const MoveTally& tally);
+
+    // Drops every index no live plan holds, for callers that want the memory
+    // back now rather than at the maxDestinationIndexes bound. Returns
+    // how many were dropped.
+    std::size_t releaseIdleDestinationIndexes();
+
+private:
+    struct CachedIndex {
+        std::shared_ptr<DestinationIndex> index;
+        std::uint64_t lastUsed = 0;
+    };
+
+    void evictIdleIndexes();
+
+    RelocatorOptions options_;
+    FileSystem& fileSystem_;
+    ThreadPool pool_;
+    std::atomic<std::uint64_t> cancelEpoch_{0};
+    std::atomic<std::uint64_t> nextJobId_{1};
+    std::mutex indexesMutex_;
+    std::map<fs::path, CachedIndex> indexes_;
+    std::uint64_t indexUseClock_ = 0;
+};
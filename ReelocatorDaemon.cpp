@@ -0,0 +1,784 @@
+#include "ReelocatorDaemon.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define REELOCATOR_HAVE_UNIX_SOCKETS 1
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+namespace {
+
+constexpr std::size_t kMaxRequestBytes = 64 * 1024;
+constexpr std::size_t kMaxRetainedJobs = 1024;
+
+enum class JobState {
+    Planning,
+    Moving,
+    Done,
+    Failed,
+    Cancelled,
+};
+
+const char* jobStateName(JobState state) {
+    switch (state) {
+        case JobState::Planning:
+            return "planning";
+        case JobState::Moving:
+            return "moving";
+        case JobState::Done:
+            return "done";
+        case JobState::Failed:
+            return "failed";
+        case JobState::Cancelled:
+            return "cancelled";
+    }
+    return "unknown";
+}
+
+bool isFinished(JobState state) {
+    return state == JobState::Done || state == JobState::Failed || state == JobState::Cancelled;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size() + 2);
+    for (const char ch : text) {
+        switch (ch) {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\r':
+                escaped += "\\r";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(ch));
+                    escaped += buffer;
+                } else {
+                    escaped += ch;
+                }
+                break;
+        }
+    }
+    return escaped;
+}
+
+void appendUtf8(std::string& out, unsigned codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+bool isHighSurrogate(unsigned codeUnit) {
+    return codeUnit >= 0xD800 && codeUnit <= 0xDBFF;
+}
+
+bool isLowSurrogate(unsigned codeUnit) {
+    return codeUnit >= 0xDC00 && codeUnit <= 0xDFFF;
+}
+
+// Parses one flat JSON object whose values are strings, numbers, booleans or
+// null. String values are unescaped; other values keep their literal text.
+bool parseFlatJsonObject(const std::string& text, std::map<std::string, std::string>& fields) {
+    std::size_t pos = 0;
+    auto skipSpace = [&] {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r')) {
+            ++pos;
+        }
+    };
+    // Reads the four hex digits of a \u escape.
+    auto parseCodeUnit = [&](unsigned& codeUnit) {
+        if (pos + 4 > text.size()) {
+            return false;
+        }
+        codeUnit = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char hex = text[pos++];
+            codeUnit <<= 4;
+            if (hex >= '0' && hex <= '9') {
+                codeUnit |= static_cast<unsigned>(hex - '0');
+            } else if (hex >= 'a' && hex <= 'f') {
+                codeUnit |= static_cast<unsigned>(hex - 'a' + 10);
+            } else if (hex >= 'A' && hex <= 'F') {
+                codeUnit |= static_cast<unsigned>(hex - 'A' + 10);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto parseString = [&](std::string& out) {
+        if (pos >= text.size() || text[pos] != '"') {
+            return false;
+        }
+        ++pos;
+        while (pos < text.size() && text[pos] != '"') {
+            char ch = text[pos++];
+            if (ch != '\\') {
+                out += ch;
+                continue;
+            }
+            if (pos >= text.size()) {
+                return false;
+            }
+            ch = text[pos++];
+            switch (ch) {
+                case '"':
+                case '\\':
+                case '/':
+                    out += ch;
+                    break;
+                case 'b':
+                    out += '\b';
+                    break;
+                case 'f':
+                    out += '\f';
+                    break;
+                case 'n':
+                    out += '\n';
+                    break;
+                case 'r':
+                    out += '\r';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                case 'u': {
+                    unsigned codePoint = 0;
+                    if (!parseCodeUnit(codePoint) || isLowSurrogate(codePoint)) {
+                        return false;
+                    }
+                    // Characters outside the BMP arrive as an escaped
+                    // surrogate pair and become one 4-byte sequence.
+                    if (isHighSurrogate(codePoint)) {
+                        unsigned low = 0;
+                        if (text.compare(pos, 2, "\\u") != 0) {
+                            return false;
+                        }
+                        pos += 2;
+                        if (!parseCodeUnit(low) || !isLowSurrogate(low)) {
+                            return false;
+                        }
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    // A NUL would cut the path short at the syscall.
+                    if (codePoint == 0) {
+                        return false;
+                    }
+                    appendUtf8(out, codePoint);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        if (pos >= text.size()) {
+            return false;
+        }
+        ++pos;
+        return true;
+    };
+
+    skipSpace();
+    if (pos >= text.size() || text[pos++] != '{') {
+        return false;
+    }
+    skipSpace();
+    if (pos < text.size() && text[pos] == '}') {
+        ++pos;
+        skipSpace();
+        return pos == text.size();
+    }
+
+    while (true) {
+        skipSpace();
+        std::string key;
+        if (!parseString(key)) {
+            return false;
+        }
+        skipSpace();
+        if (pos >= text.size() || text[pos++] != ':') {
+            return false;
+        }
+        skipSpace();
+
+        std::string value;
+        if (pos < text.size() && text[pos] == '"') {
+            if (!parseString(value)) {
+                return false;
+            }
+        } else {
+            const std::size_t start = pos;
+            while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ' ') {
+                ++pos;
+            }
+            value = text.substr(start, pos - start);
+            if (value.empty() || value[0] == '{' || value[0] == '[') {
+                return false;
+            }
+        }
+        fields[key] = value;
+
+        skipSpace();
+        if (pos >= text.size()) {
+            return false;
+        }
+        if (text[pos] == ',') {
+            ++pos;
+            continue;
+        }
+        if (text[pos] == '}') {
+            ++pos;
+            skipSpace();
+            return pos == text.size();
+        }
+        return false;
+    }
+}
+
+std::string errorReply(const std::string& message) {
+    return "{\"ok\":false,\"error\":\"" + jsonEscape(message) + "\"}";
+}
+
+bool parseJobId(const std::map<std::string, std::string>& request, std::uint64_t& jobId) {
+    const auto it = request.find("job");
+    if (it == request.end() || it->second.empty()) {
+        return false;
+    }
+    try {
+        std::size_t consumed = 0;
+        jobId = std::stoull(it->second, &consumed);
+        return consumed == it->second.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+}  // namespace
+
+// Only the connection's own thread writes to the socket, so a client that
+// stops reading stalls that thread and never a relocation worker. Jobs hand
+// their events over through post() and postProgress() and wake the thread
+// through a non-blocking pipe.
+struct RelocationDaemon::Connection {
+    Connection(int socketFd, int wakeReadFd, int wakeWriteFd)
+        : fd(socketFd), wakeRead(wakeReadFd), wakeWrite(wakeWriteFd) {}
+
+    // The descriptors are only closed once no job can still post to them, so
+    // a reused fd number can never receive another client's events.
+    ~Connection() {
+#ifdef REELOCATOR_HAVE_UNIX_SOCKETS
+        ::close(fd);
+        ::close(wakeRead);
+        ::close(wakeWrite);
+#endif
+    }
+
+    // Connection thread only.
+    bool sendLine(const std::string& line) {
+#ifdef REELOCATOR_HAVE_UNIX_SOCKETS
+        const std::string framed = line + "\n";
+        std::size_t sent = 0;
+        while (sent < framed.size()) {
+            const ssize_t n = ::send(fd, framed.data() + sent, framed.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<std::size_t>(n);
+        }
+        return true;
+#else
+        (void)line;
+        return false;
+#endif
+    }
+
+    void post(std::string line) {
+        {
+            std::lock_guard<std::mutex> lock(outboxMutex);
+            if (closed) {
+                return;
+            }
+            outbox.push_back(std::move(line));
+        }
+        wake();
+    }
+
+    // A job already waiting for its progress line is not queued twice; the
+    // line is rendered when it is sent, so it carries the latest counts.
+    void postProgress(const std::shared_ptr<Job>& job);
+
+    // Called by the connection thread as it exits: drops whatever is still
+    // queued, including the queued jobs, and turns later posts into no-ops.
+    void close() {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        closed = true;
+        outbox.clear();
+        progressDue.clear();
+    }
+
+    void wake() {
+#ifdef REELOCATOR_HAVE_UNIX_SOCKETS
+        // A full pipe already holds a pending wake-up, so EAGAIN is fine.
+        const char byte = 0;
+        [[maybe_unused]] const ssize_t n = ::write(wakeWrite, &byte, 1);
+#endif
+    }
+
+    const int fd;
+    const int wakeRead;
+    const int wakeWrite;
+    std::mutex outboxMutex;
+    std::deque<std::string> outbox;
+    std::vector<std::shared_ptr<Job>> progressDue;
+    bool closed = false;
+};
+
+struct RelocationDaemon::Job : std::enable_shared_from_this<RelocationDaemon::Job> {
+    std::uint64_t id = 0;
+    RelocationJob job{MediaType::Images, {}, {}};
+    CancellationToken token;
+    // Weak, so a retained job never keeps a closed client's socket open.
+    std::weak_ptr<Connection> connection;
+    std::atomic<bool> progressQueued{false};
+    std::atomic<JobState> state{JobState::Planning};
+    std::atomic<std::uint64_t> planned{0};
+    std::atomic<std::uint64_t> completed{0};
+    std::atomic<std::uint64_t> moved{0};
+    std::atomic<std::uint64_t> skipped{0};
+    std::atomic<std::uint64_t> bytesMoved{0};
+    std::atomic<std::int64_t> lastProgressNanoseconds{0};
+    std::string error;
+
+    std::string describe(const char* event) const {
+        std::ostringstream out;
+        out << "{\"event\":\"" << event << "\",\"job\":" << id << ",\"state\":\"" << jobStateName(state.load())
+            << "\",\"planned\":" << planned.load() << ",\"completed\":" << completed.load()
+            << ",\"moved\":" << moved.load() << ",\"skipped\":" << skipped.load()
+            << ",\"bytes\":" << bytesMoved.load();
+        if (!error.empty()) {
+            out << ",\"error\":\"" << jsonEscape(error) << "\"";
+        }
+        out << "}";
+        return out.str();
+    }
+};
+
+void RelocationDaemon::Connection::postProgress(const std::shared_ptr<Job>& job) {
+    if (job->progressQueued.exchange(true)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        if (closed) {
+            return;
+        }
+        progressDue.push_back(job);
+    }
+    wake();
+}
+
+RelocationDaemon::RelocationDaemon(DaemonOptions options) : options_(std::move(options)) {
+    RelocatorOptions relocatorOptions;
+    relocatorOptions.workerThreads = options_.workerThreads;
+    relocator_ = std::make_unique<Relocator>(std::move(relocatorOptions));
+}
+
+RelocationDaemon::~RelocationDaemon() {
+    stop();
+}
+
+Relocator& RelocationDaemon::relocator() noexcept {
+    return *relocator_;
+}
+
+void RelocationDaemon::start() {
+#ifdef REELOCATOR_HAVE_UNIX_SOCKETS
+    if (running_) {
+        return;
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const std::string path = options_.socketPath.string();
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::system_error(std::make_error_code(std::errc::filename_too_long), "daemon socket path");
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    listenSocket_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "daemon socket");
+    }
+
+    ::unlink(path.c_str());
+    if (::bind(listenSocket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listenSocket_, 16) != 0) {
+        const int error = errno;
+        ::close(listenSocket_);
+        listenSocket_ = -1;
+        throw std::system_error(error, std::generic_category(), "daemon socket bind");
+    }
+
+    stopping_ = false;
+    running_ = true;
+    acceptThread_ = std::thread([this] { acceptLoop(); });
+#else
+    throw std::runtime_error("the relocation daemon requires Unix domain sockets");
+#endif
+}
+
+void RelocationDaemon::stop() {
+#ifdef REELOCATOR_HAVE_UNIX_SOCKETS
+    if (!running_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        for (auto& entry : jobs_) {
+            entry.second->token.cancel();
+        }
+        for (auto& entry : connections_) {
+            ::shutdown(entry.second->fd, SHUT_RDWR);
+        }
+    }
+
+    if (acceptThread_.joinable()) {
+        acceptThread_.join();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        threadsDone_.wait(lock, [this] { return activeThreads_ == 0; });
+        connections_.clear();
+    }
+
+    ::close(listenSocket_);
+    listenSocket_ = -1;
+    ::unlink(options_.socketPath.string().c_str());
+    running_ = false;
+#endif
+}
+
+void RelocationDaemon::launch(std::function<void()> body) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++activeThreads_;
+    }
+
+    std::thread([this, body = std::move(body)] {
+        body();
+        std::lock_guard<std::mutex> lock(mutex_);
+        --activeThreads_;
+        threadsDone_.notify_all();
+    }).detach();
+}
+
+void RelocationDaemon::acceptLoop() {
+#ifdef REELOCATOR_HAVE_UNIX_SOCKETS
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+        }
+
+        pollfd listener{listenSocket_, POLLIN, 0};
+        if (::poll(&listener, 1, 100) <= 0) {
+            continue;
+        }
+
+        const int client = ::accept(listenSocket_, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+
+        int wake[2];
+        if (::pipe(wake) != 0) {
+            ::close(client);
+            continue;
+        }
+        for (const int end : wake) {
+            ::fcntl(end, F_SETFL, ::fcntl(end, F_GETFL) | O_NONBLOCK);
+            ::fcntl(end, F_SETFD, FD_CLOEXEC);
+        }
+
+        auto connection = std::make_shared<Connection>(client, wake[0], wake[1]);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+            connections_[client] = connection;
+        }
+        launch([this, connection] { serveConnection(connection); });
+    }
+#endif
+}
+
+void RelocationDaemon::serveConnection(const std::shared_ptr<Connection>& connection) {
+#ifdef REELOCATOR_HAVE_UNIX_SOCKETS
+    std::string pending;
+    char buffer[4096];
+
+    while (true) {
+        pollfd fds[2] = {{connection->fd, POLLIN, 0}, {connection->wakeRead, POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            while (::read(connection->wakeRead, buffer, sizeof(buffer)) > 0) {
+            }
+            sendQueuedEvents(*connection);
+        }
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            continue;
+        }
+
+        const ssize_t n = ::recv(connection->fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        pending.append(buffer, static_cast<std::size_t>(n));
+
+        std::size_t newline = 0;
+        while ((newline = pending.find('\n')) != std::string::npos) {
+            const std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (line.empty() || line == "\r") {
+                continue;
+            }
+            const std::string reply = handleRequest(line, connection);
+            if (!reply.empty()) {
+                connection->sendLine(reply);
+            }
+        }
+
+        if (pending.size() > kMaxRequestBytes) {
+            connection->sendLine(errorReply("request too large"));
+            break;
+        }
+    }
+
+    connection->close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections_.erase(connection->fd);
+#else
+    (void)connection;
+#endif
+}
+
+void RelocationDaemon::sendQueuedEvents(Connection& connection) {
+    std::deque<std::string> lines;
+    std::vector<std::shared_ptr<Job>> progressDue;
+    {
+        std::lock_guard<std::mutex> lock(connection.outboxMutex);
+        lines.swap(connection.outbox);
+        progressDue.swap(connection.progressDue);
+    }
+
+    for (const std::string& line : lines) {
+        connection.sendLine(line);
+    }
+    for (const std::shared_ptr<Job>& job : progressDue) {
+        job->progressQueued.store(false);
+        std::string line;
+        {
+            // A finished job's done line has already been sent, and progress
+            // must not follow it.
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (isFinished(job->state.load())) {
+                continue;
+            }
+            line = job->describe("progress");
+        }
+        connection.sendLine(line);
+    }
+}
+
+std::string RelocationDaemon::handleRequest(const std::string& line, const std::shared_ptr<Connection>& connection) {
+    std::map<std::string, std::string> request;
+    if (!parseFlatJsonObject(line, request)) {
+        return errorReply("malformed request");
+    }
+
+    const std::string op = request["op"];
+    if (op == "ping") {
+        return "{\"ok\":true}";
+    }
+    if (op == "submit") {
+        return submitJob(request, connection);
+    }
+
+    if (op == "status" || op == "cancel") {
+        std::uint64_t jobId = 0;
+        if (!parseJobId(request, jobId)) {
+            return errorReply("missing or invalid job id");
+        }
+        const std::shared_ptr<Job> job = findJob(jobId);
+        if (!job) {
+            return errorReply("unknown job");
+        }
+        if (op == "cancel") {
+            job->token.cancel();
+            return "{\"ok\":true,\"job\":" + std::to_string(jobId) + "}";
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string status = job->describe("status");
+        status.insert(1, "\"ok\":true,");
+        return status;
+    }
+
+    return errorReply("unknown op");
+}
+
+std::string RelocationDaemon::submitJob(const std::map<std::string, std::string>& request,
+                                        const std::shared_ptr<Connection>& connection) {
+    auto job = std::make_shared<Job>();
+    const auto type = request.find("type");
+    const auto source = request.find("source");
+    const auto destination = request.find("destination");
+    if (type == request.end() || !parseMediaType(type->second, job->job.mediaType)) {
+        return errorReply("type must be images or videos");
+    }
+    if (source == request.end() || source->second.empty() || destination == request.end() ||
+        destination->second.empty()) {
+        return errorReply("source and destination are required");
+    }
+    const auto priority = request.find("priority");
+    if (priority != request.end() && !parseJobPriority(priority->second, job->job.priority)) {
+        return errorReply("priority must be interactive or bulk");
+    }
+    job->job.source = source->second;
+    job->job.destination = destination->second;
+    job->job.onProgress = [this, raw = job.get()](const RelocationProgress& progress) { onProgress(*raw, progress); };
+    job->connection = connection;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return errorReply("daemon is stopping");
+        }
+        job->id = nextJobId_++;
+        job->job.id = job->id;
+        jobs_[job->id] = job;
+
+        // Forget the oldest finished jobs so a long-lived daemon stays bounded.
+        for (auto it = jobs_.begin(); jobs_.size() > kMaxRetainedJobs && it != jobs_.end();) {
+            it = isFinished(it->second->state.load()) ? jobs_.erase(it) : std::next(it);
+        }
+    }
+
+    // The reply is sent before the job thread starts so it always precedes
+    // the job's events on this connection.
+    connection->sendLine("{\"ok\":true,\"job\":" + std::to_string(job->id) + "}");
+    launch([this, job] { runJob(job); });
+    return {};
+}
+
+void RelocationDaemon::runJob(const std::shared_ptr<Job>& job) {
+    JobState finalState = JobState::Done;
+    std::string error;
+
+    try {
+        const RelocationPlan plan = relocator_->plan(job->job, job->token);
+        job->planned.store(plan.moveCount());
+        job->state.store(JobState::Moving);
+        if (const auto connection = job->connection.lock()) {
+            connection->post(job->describe("planned"));
+        }
+
+        const RelocationSummary summary = relocator_->execute(plan, job->token);
+        job->moved.store(summary.moved);
+        job->skipped.store(summary.skipped);
+        job->bytesMoved.store(summary.bytesMoved);
+        job->completed.store(summary.moved + summary.skipped);
+        if (summary.cancelled) {
+            finalState = JobState::Cancelled;
+        }
+    } catch (const std::exception& ex) {
+        finalState = JobState::Failed;
+        error = ex.what();
+    }
+
+    std::string done;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job->error = std::move(error);
+        job->state.store(finalState);
+        done = job->describe("done");
+    }
+    if (const auto connection = job->connection.lock()) {
+        connection->post(std::move(done));
+    }
+}
+
+void RelocationDaemon::onProgress(Job& job, const RelocationProgress& progress) {
+    job.completed.store(progress.completed, std::memory_order_relaxed);
+    job.moved.store(progress.moved, std::memory_order_relaxed);
+    job.skipped.store(progress.skipped, std::memory_order_relaxed);
+    job.bytesMoved.store(progress.bytesMoved, std::memory_order_relaxed);
+
+    const std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now().time_since_epoch())
+                                 .count();
+    std::int64_t last = job.lastProgressNanoseconds.load(std::memory_order_relaxed);
+    const std::int64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(options_.progressInterval).count();
+    if (now - last < interval || !job.lastProgressNanoseconds.compare_exchange_strong(last, now)) {
+        return;
+    }
+    if (const auto connection = job.connection.lock()) {
+        connection->postProgress(job.shared_from_this());
+    }
+}
+
+std::shared_ptr<RelocationDaemon::Job> RelocationDaemon::findJob(std::uint64_t jobId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = jobs_.find(jobId);
+    return it == jobs_.end() ? nullptr : it->second;
+}
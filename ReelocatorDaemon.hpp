@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ReelocatorCore.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+struct DaemonOptions {
+    fs::path socketPath;
+    std::size_t workerThreads = 0;
+    std::chrono::milliseconds progressInterval{200};
+};
+
+// Long-running relocation service. One Relocator (and therefore one worker
+// pool and one warm index per destination) serves every job submitted over a
+// Unix stream socket. The protocol is JSON lines; see README.md for the
+// requests and the events streamed back on the submitting connection.
+class RelocationDaemon {
+public:
+    explicit RelocationDaemon(DaemonOptions options);
+    ~RelocationDaemon();
+
+    RelocationDaemon(const RelocationDaemon&) = delete;
+    RelocationDaemon& operator=(const RelocationDaemon&) = delete;
+
+    // Binds the socket and starts accepting; throws std::system_error.
+    void start();
+    // Cancels running jobs, closes every connection and removes the socket.
+    void stop();
+
+    Relocator& relocator() noexcept;
+
+private:
+    struct Connection;
+    struct Job;
+
+    void launch(std::function<void()> body);
+    void acceptLoop();
+    void serveConnection(const std::shared_ptr<Connection>& connection);
+    std::string handleRequest(const std::string& line, const std::shared_ptr<Connection>& connection);
+    std::string submitJob(const std::map<std::string, std::string>& request,
+                          const std::shared_ptr<Connection>& connection);
+    void runJob(const std::shared_ptr<Job>& job);
+    void sendQueuedEvents(Connection& connection);
+    void onProgress(Job& job, const RelocationProgress& progress);
+    std::shared_ptr<Job> findJob(std::uint64_t jobId);
+
+    DaemonOptions options_;
+    std::unique_ptr<Relocator> relocator_;
+    int listenSocket_ = -1;
+    bool running_ = false;
+    bool stopping_ = false;
+
+    std::mutex mutex_;
+    std::condition_variable threadsDone_;
+    std::size_t activeThreads_ = 0;
+    std::thread acceptThread_;
+    std::map<int, std::shared_ptr<Connection>> connections_;
+    std::map<std::uint64_t, std::shared_ptr<Job>> jobs_;
+    std::uint64_t nextJobId_ = 1;
+};
@@ -0,0 +1,149 @@
+#include "ReelocatorFaultInjection.hpp"
+
+#include <string>
+#include <thread>
+
+namespace {
+
+std::uint64_t splitmix64(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// FNV-1a rather than std::hash so a seed selects the same paths with every
+// standard library.
+std::uint64_t hashPath(const fs::path& path) {
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const auto ch : path.native()) {
+        hash = (hash ^ static_cast<std::uint64_t>(ch)) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+}  // namespace
+
+FaultInjectingFileSystem::FaultInjectingFileSystem(std::uint64_t seed) : seed_(seed) {}
+
+void FaultInjectingFileSystem::setRule(FsOperation operation, FaultRule rule) {
+    rules_[static_cast<std::size_t>(operation)] = rule;
+}
+
+void FaultInjectingFileSystem::clearRules() {
+    rules_.fill(FaultRule{});
+}
+
+std::uint64_t FaultInjectingFileSystem::injected(FsOperation operation) const noexcept {
+    return injected_[static_cast<std::size_t>(operation)].load(std::memory_order_relaxed);
+}
+
+std::uint64_t FaultInjectingFileSystem::injectedTotal() const noexcept {
+    std::uint64_t sum = 0;
+    for (const auto& count : injected_) {
+        sum += count.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+bool FaultInjectingFileSystem::inject(FsOperation operation, const fs::path& path, std::error_code& error) {
+    const FaultRule& rule = rules_[static_cast<std::size_t>(operation)];
+    if (rule.latency.count() > 0) {
+        std::this_thread::sleep_for(rule.latency);
+    }
+    if (rule.rate <= 0.0) {
+        return false;
+    }
+
+    const std::uint64_t hash = splitmix64(seed_ ^ splitmix64(hashPath(path) + static_cast<std::uint64_t>(operation)));
+    if (static_cast<double>(hash >> 11) * (1.0 / 9007199254740992.0) >= rule.rate) {
+        return false;
+    }
+
+    counters().increment(operation);
+    injected_[static_cast<std::size_t>(operation)].fetch_add(1, std::memory_order_relaxed);
+    error = std::make_error_code(rule.error);
+    return true;
+}
+
+void FaultInjectingFileSystem::injectOrThrow(FsOperation operation, const char* what, const fs::path& path) {
+    std::error_code error;
+    if (inject(operation, path, error)) {
+        throw fs::filesystem_error(what, path, error);
+    }
+}
+
+bool FaultInjectingFileSystem::exists(const fs::path& path, std::error_code& error) {
+    return inject(FsOperation::Exists, path, error) ? false : FileSystem::exists(path, error);
+}
+
+bool FaultInjectingFileSystem::isDirectory(const fs::path& path, std::error_code& error) {
+    return inject(FsOperation::IsDirectory, path, error) ? false : FileSystem::isDirectory(path, error);
+}
+
+bool FaultInjectingFileSystem::equivalent(const fs::path& first, const fs::path& second, std::error_code& error) {
+    return inject(FsOperation::Equivalent, first, error) ? false : FileSystem::equivalent(first, second, error);
+}
+
+FileIdentity FaultInjectingFileSystem::identity(const fs::path& path, std::error_code& error) {
+    return inject(FsOperation::Identity, path, error) ? FileIdentity{} : FileSystem::identity(path, error);
+}
+
+fs::path FaultInjectingFileSystem::canonical(const fs::path& path, std::error_code& error) {
+    return inject(FsOperation::Canonical, path, error) ? fs::path() : FileSystem::canonical(path, error);
+}
+
+fs::file_time_type FaultInjectingFileSystem::lastWriteTime(const fs::path& path, std::error_code& error) {
+    return inject(FsOperation::LastWriteTime, path, error) ? fs::file_time_type() : FileSystem::lastWriteTime(path, error);
+}
+
+std::uintmax_t FaultInjectingFileSystem::fileSize(const fs::directory_entry& entry, std::error_code& error) {
+    return inject(FsOperation::FileSize, entry.path(), error) ? static_cast<std::uintmax_t>(-1)
+                                                             : FileSystem::fileSize(entry, error);
+}
+
+bool FaultInjectingFileSystem::createDirectories(const fs::path& path, std::error_code& error) {
+    return inject(FsOperation::CreateDirectories, path, error) ? false : FileSystem::createDirectories(path, error);
+}
+
+void FaultInjectingFileSystem::rename(const fs::path& from, const fs::path& to, std::error_code& error) {
+    if (!inject(FsOperation::Rename, from, error)) {
+        FileSystem::rename(from, to, error);
+    }
+}
+
+void FaultInjectingFileSystem::renameNoReplace(const fs::path& from, const fs::path& to, std::error_code& error) {
+    if (!inject(FsOperation::Rename, from, error)) {
+        FileSystem::renameNoReplace(from, to, error);
+    }
+}
+
+bool FaultInjectingFileSystem::copyFile(const fs::path& from, const fs::path& to, fs::copy_options options,
+                                        std::error_code& error) {
+    return inject(FsOperation::CopyFile, from, error) ? false : FileSystem::copyFile(from, to, options, error);
+}
+
+bool FaultInjectingFileSystem::remove(const fs::path& path, std::error_code& error) {
+    return inject(FsOperation::Remove, path, error) ? false : FileSystem::remove(path, error);
+}
+
+fs::directory_iterator FaultInjectingFileSystem::openDirectory(const fs::path& path) {
+    injectOrThrow(FsOperation::DirectoryOpen, "directory_iterator::directory_iterator", path);
+    return FileSystem::openDirectory(path);
+}
+
+void FaultInjectingFileSystem::increment(fs::directory_iterator& it) {
+    injectOrThrow(FsOperation::DirectoryStep, "directory_iterator::operator++", it->path());
+    FileSystem::increment(it);
+}
+
+fs::recursive_directory_iterator FaultInjectingFileSystem::openRecursive(const fs::path& path,
+                                                                         fs::directory_options options) {
+    injectOrThrow(FsOperation::DirectoryOpen, "recursive_directory_iterator::recursive_directory_iterator", path);
+    return FileSystem::openRecursive(path, options);
+}
+
+void FaultInjectingFileSystem::increment(fs::recursive_directory_iterator& it) {
+    injectOrThrow(FsOperation::DirectoryStep, "recursive_directory_iterator::operator++", it->path());
+    FileSystem::increment(it);
+}
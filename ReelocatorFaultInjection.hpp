@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ReelocatorFileSystem.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <system_error>
+
+// What happens to one kind of FileSystem call. Whether a call fails depends
+// only on the seed, the operation and the call's first path, so a run
+// fails the same files whatever the thread count or scheduling.
+struct FaultRule {
+    // Fraction of distinct paths whose calls fail, from 0.0 to 1.0.
+    double rate = 0.0;
+    std::errc error = std::errc::io_error;
+    // Added to every call of the operation, failed or not.
+    std::chrono::microseconds latency{0};
+};
+
+// FileSystem that fails or slows down selected operations before they reach
+// the disk. Failed calls are counted in counters() like real ones. Set the
+// rules before sharing the instance with worker threads.
+class FaultInjectingFileSystem : public FileSystem {
+public:
+    explicit FaultInjectingFileSystem(std::uint64_t seed = 1);
+
+    void setRule(FsOperation operation, FaultRule rule);
+    void clearRules();
+
+    // Calls failed on purpose since construction.
+    std::uint64_t injected(FsOperation operation) const noexcept;
+    std::uint64_t injectedTotal() const noexcept;
+
+    using FileSystem::copyFile;
+    using FileSystem::createDirectories;
+    using FileSystem::equivalent;
+    using FileSystem::exists;
+    using FileSystem::identity;
+    using FileSystem::isDirectory;
+    using FileSystem::remove;
+    using FileSystem::rename;
+
+    bool exists(const fs::path& path, std::error_code& error) override;
+    bool isDirectory(const fs::path& path, std::error_code& error) override;
+    bool equivalent(const fs::path& first, const fs::path& second, std::error_code& error) override;
+    FileIdentity identity(const fs::path& path, std::error_code& error) override;
+    fs::path canonical(const fs::path& path, std::error_code& error) override;
+    fs::file_time_type lastWriteTime(const fs::path& path, std::error_code& error) override;
+    std::uintmax_t fileSize(const fs::directory_entry& entry, std::error_code& error) override;
+    bool createDirectories(const fs::path& path, std::error_code& error) override;
+    void rename(const fs::path& from, const fs::path& to, std::error_code& error) override;
+    void renameNoReplace(const fs::path& from, const fs::path& to, std::error_code& error) override;
+    bool copyFile(const fs::path& from, const fs::path& to, fs::copy_options options,
+                  std::error_code& error) override;
+    bool remove(const fs::path& path, std::error_code& error) override;
+
+    // Directory faults surface as fs::filesystem_error, like a failing
+    // std::filesystem iterator.
+    fs::directory_iterator openDirectory(const fs::path& path) override;
+    void increment(fs::directory_iterator& it) override;
+    fs::recursive_directory_iterator openRecursive(const fs::path& path, fs::directory_options options) override;
+    void increment(fs::recursive_directory_iterator& it) override;
+
+private:
+    // Applies the latency and decides whether the call fails; a failed call
+    // is counted and `error` set.
+    bool inject(FsOperation operation, const fs::path& path, std::error_code& error);
+    void injectOrThrow(FsOperation operation, const char* what, const fs::path& path);
+
+    std::uint64_t seed_;
+    std::array<FaultRule, kFsOperationCount> rules_{};
+    std::array<std::atomic<std::uint64_t>, kFsOperationCount> injected_{};
+};
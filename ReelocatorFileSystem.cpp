@@ -0,0 +1,305 @@
+#include "ReelocatorFileSystem.hpp"
+#include "ReelocatorProbes.hpp"
+
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#define REELOCATOR_HAVE_STAT 1
+#endif
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE (1 << 0)
+#endif
+#endif
+
+namespace {
+
+void probeError(FsOperation operation, const fs::path& path, const std::error_code& error) {
+    if (error) {
+        REELOCATOR_PROBE3(error, fsOperationName(operation), path.c_str(), error.value());
+    }
+}
+
+void throwIfError(const char* what, const fs::path& path, const std::error_code& error) {
+    if (error) {
+        throw fs::filesystem_error(what, path, error);
+    }
+}
+
+void throwIfError(const char* what, const fs::path& first, const fs::path& second, const std::error_code& error) {
+    if (error) {
+        throw fs::filesystem_error(what, first, second, error);
+    }
+}
+
+}  // namespace
+
+const char* fsOperationName(FsOperation operation) {
+    switch (operation) {
+        case FsOperation::Exists:
+            return "exists";
+        case FsOperation::IsDirectory:
+            return "is_directory";
+        case FsOperation::Equivalent:
+            return "equivalent";
+        case FsOperation::FileSize:
+            return "file_size";
+        case FsOperation::CreateDirectories:
+            return "create_directories";
+        case FsOperation::Rename:
+            return "rename";
+        case FsOperation::CopyFile:
+            return "copy_file";
+        case FsOperation::Remove:
+            return "remove";
+        case FsOperation::DirectoryOpen:
+            return "directory_open";
+        case FsOperation::DirectoryStep:
+            return "directory_step";
+        case FsOperation::Identity:
+            return "identity";
+        case FsOperation::Canonical:
+            return "canonical";
+        case FsOperation::LastWriteTime:
+            return "last_write_time";
+    }
+
+    return "unknown";
+}
+
+void SyscallCounters::increment(FsOperation operation) noexcept {
+    counts_[static_cast<std::size_t>(operation)].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t SyscallCounters::count(FsOperation operation) const noexcept {
+    return counts_[static_cast<std::size_t>(operation)].load(std::memory_order_relaxed);
+}
+
+std::uint64_t SyscallCounters::total() const noexcept {
+    std::uint64_t sum = 0;
+    for (const auto& count : counts_) {
+        sum += count.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void SyscallCounters::reset() noexcept {
+    for (auto& count : counts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool FileSystem::exists(const fs::path& path, std::error_code& error) {
+    counters_.increment(FsOperation::Exists);
+    const bool result = fs::exists(path, error);
+    probeError(FsOperation::Exists, path, error);
+    return result;
+}
+
+bool FileSystem::exists(const fs::path& path) {
+    std::error_code error;
+    const bool result = exists(path, error);
+    throwIfError("exists", path, error);
+    return result;
+}
+
+bool FileSystem::isDirectory(const fs::path& path, std::error_code& error) {
+    counters_.increment(FsOperation::IsDirectory);
+    const bool result = fs::is_directory(path, error);
+    probeError(FsOperation::IsDirectory, path, error);
+    return result;
+}
+
+bool FileSystem::isDirectory(const fs::path& path) {
+    std::error_code error;
+    const bool result = isDirectory(path, error);
+    throwIfError("is_directory", path, error);
+    return result;
+}
+
+bool FileSystem::equivalent(const fs::path& first, const fs::path& second, std::error_code& error) {
+    counters_.increment(FsOperation::Equivalent);
+    const bool result = fs::equivalent(first, second, error);
+    probeError(FsOperation::Equivalent, first, error);
+    return result;
+}
+
+bool FileSystem::equivalent(const fs::path& first, const fs::path& second) {
+    std::error_code error;
+    const bool result = equivalent(first, second, error);
+    throwIfError("equivalent", first, second, error);
+    return result;
+}
+
+FileIdentity FileSystem::identity(const fs::path& path, std::error_code& error) {
+    counters_.increment(FsOperation::Identity);
+    FileIdentity result;
+    error.clear();
+#ifdef REELOCATOR_HAVE_STAT
+    struct stat status {};
+    if (::stat(path.c_str(), &status) == 0) {
+        result.device = static_cast<std::uint64_t>(status.st_dev);
+        result.inode = static_cast<std::uint64_t>(status.st_ino);
+    } else {
+        error.assign(errno, std::generic_category());
+    }
+#else
+    error = std::make_error_code(std::errc::function_not_supported);
+#endif
+    probeError(FsOperation::Identity, path, error);
+    return result;
+}
+
+FileIdentity FileSystem::identity(const fs::path& path) {
+    std::error_code error;
+    const FileIdentity result = identity(path, error);
+    throwIfError("identity", path, error);
+    return result;
+}
+
+fs::path FileSystem::canonical(const fs::path& path, std::error_code& error) {
+    counters_.increment(FsOperation::Canonical);
+    fs::path result = fs::canonical(path, error);
+    probeError(FsOperation::Canonical, path, error);
+    return result;
+}
+
+fs::file_time_type FileSystem::lastWriteTime(const fs::path& path, std::error_code& error) {
+    counters_.increment(FsOperation::LastWriteTime);
+    const fs::file_time_type result = fs::last_write_time(path, error);
+    probeError(FsOperation::LastWriteTime, path, error);
+    return result;
+}
+
+std::uintmax_t FileSystem::fileSize(const fs::directory_entry& entry, std::error_code& error) {
+    counters_.increment(FsOperation::FileSize);
+    const std::uintmax_t result = entry.file_size(error);
+    probeError(FsOperation::FileSize, entry.path(), error);
+    return result;
+}
+
+bool FileSystem::createDirectories(const fs::path& path, std::error_code& error) {
+    counters_.increment(FsOperation::CreateDirectories);
+    const bool result = fs::create_directories(path, error);
+    probeError(FsOperation::CreateDirectories, path, error);
+    return result;
+}
+
+bool FileSystem::createDirectories(const fs::path& path) {
+    std::error_code error;
+    const bool result = createDirectories(path, error);
+    throwIfError("create_directories", path, error);
+    return result;
+}
+
+void FileSystem::rename(const fs::path& from, const fs::path& to, std::error_code& error) {
+    counters_.increment(FsOperation::Rename);
+    REELOCATOR_PROBE2(rename_start, from.c_str(), to.c_str());
+    fs::rename(from, to, error);
+    REELOCATOR_PROBE3(rename_end, from.c_str(), to.c_str(), error.value());
+    probeError(FsOperation::Rename, from, error);
+}
+
+void FileSystem::rename(const fs::path& from, const fs::path& to) {
+    std::error_code error;
+    rename(from, to, error);
+    throwIfError("rename", from, to, error);
+}
+
+void FileSystem::renameNoReplace(const fs::path& from, const fs::path& to, std::error_code& error) {
+    counters_.increment(FsOperation::Rename);
+    REELOCATOR_PROBE2(rename_start, from.c_str(), to.c_str());
+    error.clear();
+
+    bool renamed = false;
+#if defined(__linux__) && defined(SYS_renameat2)
+    if (::syscall(SYS_renameat2, AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(), RENAME_NOREPLACE) == 0) {
+        renamed = true;
+    } else if (errno != EINVAL && errno != ENOSYS) {
+        error.assign(errno, std::generic_category());
+        renamed = true;
+    }
+#endif
+
+    // Filesystems without RENAME_NOREPLACE support fall back to check-then-rename.
+    if (!renamed) {
+        counters_.increment(FsOperation::Exists);
+        if (fs::exists(to, error)) {
+            error = std::make_error_code(std::errc::file_exists);
+        } else if (!error) {
+            fs::rename(from, to, error);
+        }
+    }
+
+    REELOCATOR_PROBE3(rename_end, from.c_str(), to.c_str(), error.value());
+    probeError(FsOperation::Rename, from, error);
+}
+
+bool FileSystem::copyFile(const fs::path& from, const fs::path& to, fs::copy_options options,
+                          std::error_code& error) {
+    counters_.increment(FsOperation::CopyFile);
+    REELOCATOR_PROBE2(copy_start, from.c_str(), to.c_str());
+    const bool result = fs::copy_file(from, to, options, error);
+    REELOCATOR_PROBE3(copy_end, from.c_str(), to.c_str(), error.value());
+    probeError(FsOperation::CopyFile, from, error);
+    return result;
+}
+
+bool FileSystem::copyFile(const fs::path& from, const fs::path& to, fs::copy_options options) {
+    std::error_code error;
+    const bool result = copyFile(from, to, options, error);
+    throwIfError("copy_file", from, to, error);
+    return result;
+}
+
+bool FileSystem::remove(const fs::path& path, std::error_code& error) {
+    counters_.increment(FsOperation::Remove);
+    const bool result = fs::remove(path, error);
+    probeError(FsOperation::Remove, path, error);
+    return result;
+}
+
+bool FileSystem::remove(const fs::path& path) {
+    std::error_code error;
+    const bool result = remove(path, error);
+    throwIfError("remove", path, error);
+    return result;
+}
+
+fs::directory_iterator FileSystem::openDirectory(const fs::path& path) {
+    counters_.increment(FsOperation::DirectoryOpen);
+    return fs::directory_iterator(path);
+}
+
+void FileSystem::increment(fs::directory_iterator& it) {
+    counters_.increment(FsOperation::DirectoryStep);
+    ++it;
+}
+
+fs::recursive_directory_iterator FileSystem::openRecursive(const fs::path& path, fs::directory_options options) {
+    counters_.increment(FsOperation::DirectoryOpen);
+    return fs::recursive_directory_iterator(path, options);
+}
+
+void FileSystem::increment(fs::recursive_directory_iterator& it) {
+    counters_.increment(FsOperation::DirectoryStep);
+    ++it;
+}
+
+SyscallCounters& FileSystem::counters() noexcept {
+    return counters_;
+}
+
+const SyscallCounters& FileSystem::counters() const noexcept {
+    return counters_;
+}
+
+FileSystem& defaultFileSystem() {
+    static FileSystem instance;
+    return instance;
+}
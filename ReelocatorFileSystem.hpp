@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+enum class FsOperation {
+    Exists,
+    IsDirectory,
+    Equivalent,
+    FileSize,
+    CreateDirectories,
+    Rename,
+    CopyFile,
+    Remove,
+    DirectoryOpen,
+    DirectoryStep,
+    Identity,
+    Canonical,
+    LastWriteTime,
+};
+
+constexpr std::size_t kFsOperationCount = 13;
+
+const char* fsOperationName(FsOperation operation);
+
+// What stat() identifies a file by. Two paths name the same file or
+// directory exactly when their identities are equal.
+struct FileIdentity {
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+
+    bool operator==(const FileIdentity& other) const noexcept {
+        return device == other.device && inode == other.inode;
+    }
+    bool operator!=(const FileIdentity& other) const noexcept { return !(*this == other); }
+};
+
+// One count per facade call. Most calls are a single syscall; equivalent() is
+// two stats and copyFile() is an open/stat/copy/close sequence.
+class SyscallCounters {
+public:
+    void increment(FsOperation operation) noexcept;
+    std::uint64_t count(FsOperation operation) const noexcept;
+    std::uint64_t total() const noexcept;
+    void reset() noexcept;
+
+private:
+    std::array<std::atomic<std::uint64_t>, kFsOperationCount> counts_{};
+};
+
+// Thin facade over std::filesystem that every filesystem operation in the core
+// goes through, so callers can account for (and budget) the calls made per file.
+// Overloads mirror std::filesystem: error_code variants never throw, the others
+// throw fs::filesystem_error. The error_code variants and the directory calls
+// are virtual so tests can substitute failures (see FaultInjectingFileSystem);
+// the throwing variants are built on them.
+class FileSystem {
+public:
+    FileSystem() = default;
+    FileSystem(const FileSystem&) = delete;
+    FileSystem& operator=(const FileSystem&) = delete;
+    virtual ~FileSystem() = default;
+
+    virtual bool exists(const fs::path& path, std::error_code& error);
+    bool exists(const fs::path& path);
+
+    virtual bool isDirectory(const fs::path& path, std::error_code& error);
+    bool isDirectory(const fs::path& path);
+
+    virtual bool equivalent(const fs::path& first, const fs::path& second, std::error_code& error);
+    bool equivalent(const fs::path& first, const fs::path& second);
+
+    // (device, inode) of the file `path` resolves to. Fails with
+    // errc::function_not_supported where stat() is not available.
+    virtual FileIdentity identity(const fs::path& path, std::error_code& error);
+    FileIdentity identity(const fs::path& path);
+
+    virtual fs::path canonical(const fs::path& path, std::error_code& error);
+
+    virtual fs::file_time_type lastWriteTime(const fs::path& path, std::error_code& error);
+
+    virtual std::uintmax_t fileSize(const fs::directory_entry& entry, std::error_code& error);
+
+    virtual bool createDirectories(const fs::path& path, std::error_code& error);
+    bool createDirectories(const fs::path& path);
+
+    virtual void rename(const fs::path& from, const fs::path& to, std::error_code& error);
+    void rename(const fs::path& from, const fs::path& to);
+
+    // Fails with errc::file_exists instead of replacing an existing target.
+    // Atomic where the platform offers renameat2(RENAME_NOREPLACE).
+    virtual void renameNoReplace(const fs::path& from, const fs::path& to, std::error_code& error);
+
+    virtual bool copyFile(const fs::path& from, const fs::path& to, fs::copy_options options,
+                          std::error_code& error);
+    bool copyFile(const fs::path& from, const fs::path& to, fs::copy_options options);
+
+    virtual bool remove(const fs::path& path, std::error_code& error);
+    bool remove(const fs::path& path);
+
+    virtual fs::directory_iterator openDirectory(const fs::path& path);
+    virtual void increment(fs::directory_iterator& it);
+
+    virtual fs::recursive_directory_iterator openRecursive(const fs::path& path, fs::directory_options options);
+    virtual void increment(fs::recursive_directory_iterator& it);
+
+    SyscallCounters& counters() noexcept;
+    const SyscallCounters& counters() const noexcept;
+
+private:
+    SyscallCounters counters_;
+};
+
+FileSystem& defaultFileSystem();
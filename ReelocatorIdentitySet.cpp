@@ -0,0 +1,90 @@
+#include "ReelocatorIdentitySet.hpp"
+
+namespace {
+
+constexpr std::size_t kInitialSlots = 16;
+
+bool isEmpty(const FileIdentity& identity) noexcept {
+    return identity.device == 0 && identity.inode == 0;
+}
+
+// Inode numbers are often sequential, so mix well before taking the low bits
+// for the slot and the high bits for the shard.
+std::uint64_t hashIdentity(const FileIdentity& identity) noexcept {
+    std::uint64_t hash = identity.inode ^ (identity.device * 0x9E3779B97F4A7C15ULL);
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+}  // namespace
+
+IdentitySet::IdentitySet() {
+    for (Shard& shard : shards_) {
+        shard.slots.assign(kInitialSlots, FileIdentity{});
+    }
+}
+
+std::size_t IdentitySet::Shard::find(const FileIdentity& identity, std::uint64_t hash) const noexcept {
+    const std::size_t mask = slots.size() - 1;
+    std::size_t slot = static_cast<std::size_t>(hash) & mask;
+    while (!isEmpty(slots[slot]) && slots[slot] != identity) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void IdentitySet::Shard::grow() {
+    std::vector<FileIdentity> old(slots.size() * 2, FileIdentity{});
+    old.swap(slots);
+    for (const FileIdentity& identity : old) {
+        if (!isEmpty(identity)) {
+            slots[find(identity, hashIdentity(identity))] = identity;
+        }
+    }
+}
+
+bool IdentitySet::insert(const FileIdentity& identity) {
+    const std::uint64_t hash = hashIdentity(identity);
+    Shard& shard = shards_[hash >> (64 - kShardBits)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (isEmpty(identity)) {
+        const bool inserted = !shard.hasZero;
+        shard.hasZero = true;
+        return inserted;
+    }
+
+    // Grow at 70% load, before probing, so the slot found stays valid.
+    if ((shard.size + 1) * 10 > shard.slots.size() * 7) {
+        shard.grow();
+    }
+    FileIdentity& slot = shard.slots[shard.find(identity, hash)];
+    if (!isEmpty(slot)) {
+        return false;
+    }
+    slot = identity;
+    ++shard.size;
+    return true;
+}
+
+bool IdentitySet::contains(const FileIdentity& identity) const {
+    const std::uint64_t hash = hashIdentity(identity);
+    const Shard& shard = shards_[hash >> (64 - kShardBits)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (isEmpty(identity)) {
+        return shard.hasZero;
+    }
+    return !isEmpty(shard.slots[shard.find(identity, hash)]);
+}
+
+std::size_t IdentitySet::size() const {
+    std::size_t total = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.size + (shard.hasZero ? 1 : 0);
+    }
+    return total;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ReelocatorFileSystem.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Set of (device, inode) pairs that many threads insert into at once, such as
+// the directories a traversal has already entered. Identities are spread over
+// shards by hash, each with its own lock and an open-addressing table of
+// 16-byte slots, so threads rarely wait on one another and no node is
+// allocated per entry. Identities cannot be removed.
+class IdentitySet {
+public:
+    IdentitySet();
+
+    IdentitySet(const IdentitySet&) = delete;
+    IdentitySet& operator=(const IdentitySet&) = delete;
+
+    // True when `identity` was not in the set yet. Thread-safe; of several
+    // threads inserting the same identity, exactly one gets true.
+    bool insert(const FileIdentity& identity);
+    bool contains(const FileIdentity& identity) const;
+
+    std::size_t size() const;
+
+private:
+    static constexpr std::size_t kShardBits = 6;
+    static constexpr std::size_t kShardCount = std::size_t{1} << kShardBits;
+
+    // Aligned so that shards locked by different threads do not share a
+    // cache line.
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        // {0, 0} marks an empty slot; the real {0, 0} is kept in hasZero.
+        std::vector<FileIdentity> slots;
+        std::size_t size = 0;
+        bool hasZero = false;
+
+        std::size_t find(const FileIdentity& identity, std::uint64_t hash) const noexcept;
+        void grow();
+    };
+
+    std::array<Shard, kShardCount> shards_;
+};
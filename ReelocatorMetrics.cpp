@@ -0,0 +1,464 @@
+#include "ReelocatorMetrics.hpp"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define REELOCATOR_HAVE_SOCKETS 1
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+namespace {
+
+constexpr const char* kOperationNames[] = {"classify", "name", "rename", "copy"};
+constexpr const char* kMethodNames[] = {"rename", "copy"};
+constexpr const char* kErrorClassNames[] = {"cross_device", "permission_denied", "no_space", "not_found",
+                                            "already_exists", "io", "other"};
+constexpr const char* kStageNames[] = {"scan", "move"};
+constexpr const char* kStateNames[] = {"pending", "running", "done", "failed"};
+
+std::size_t indexOf(MetricOperation operation) {
+    return static_cast<std::size_t>(operation);
+}
+
+std::size_t indexOf(MoveMethod method) {
+    return static_cast<std::size_t>(method);
+}
+
+std::size_t indexOf(ErrorClass errorClass) {
+    return static_cast<std::size_t>(errorClass);
+}
+
+std::size_t indexOf(RelocationStageId stage) {
+    return static_cast<std::size_t>(stage);
+}
+
+// OpenMetrics names a counter family without the _total its samples carry;
+// Prometheus text 0.0.4 names it after the samples.
+void writeCounterHeader(std::ostream& out, const char* name, const char* help, bool openMetrics) {
+    const char* suffix = openMetrics ? "" : "_total";
+    out << "# TYPE " << name << suffix << " counter\n";
+    out << "# HELP " << name << suffix << " " << help << "\n";
+}
+
+void writeCounter(std::ostream& out, const char* name, const char* help, std::uint64_t value, bool openMetrics) {
+    writeCounterHeader(out, name, help, openMetrics);
+    out << name << "_total " << value << "\n";
+}
+
+// True when the request's Accept header lists OpenMetrics. Header names are
+// case-insensitive; q-values are not weighed, as Prometheus only lists
+// OpenMetrics when it can parse it.
+bool acceptsOpenMetrics(const std::string& requestHead) {
+    std::string lowered(requestHead);
+    for (char& ch : lowered) {
+        ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    }
+    const std::size_t header = lowered.find("\r\naccept:");
+    if (header == std::string::npos) {
+        return false;
+    }
+    const std::size_t end = lowered.find("\r\n", header + 2);
+    return lowered.substr(header, end - header).find("application/openmetrics-text") != std::string::npos;
+}
+
+}  // namespace
+
+ErrorClass classifyError(const std::error_code& error) {
+    if (error == std::errc::cross_device_link) {
+        return ErrorClass::CrossDevice;
+    }
+    if (error == std::errc::permission_denied || error == std::errc::operation_not_permitted) {
+        return ErrorClass::PermissionDenied;
+    }
+    if (error == std::errc::no_space_on_device) {
+        return ErrorClass::NoSpace;
+    }
+    if (error == std::errc::no_such_file_or_directory) {
+        return ErrorClass::NotFound;
+    }
+    if (error == std::errc::file_exists) {
+        return ErrorClass::AlreadyExists;
+    }
+    if (error == std::errc::io_error) {
+        return ErrorClass::Io;
+    }
+    return ErrorClass::Other;
+}
+
+void DurationHistogram::observe(std::chrono::nanoseconds duration) noexcept {
+    const std::uint64_t nanos = duration.count() < 0 ? 0 : static_cast<std::uint64_t>(duration.count());
+
+    std::size_t bucket = 0;
+    std::uint64_t bound = 1000;
+    while (bucket + 1 < kBucketCount && nanos > bound) {
+        bound *= 4;
+        ++bucket;
+    }
+
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sumNanoseconds_.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+double DurationHistogram::upperBoundSeconds(std::size_t bucket) noexcept {
+    double bound = 1e-6;
+    for (std::size_t i = 0; i < bucket; ++i) {
+        bound *= 4.0;
+    }
+    return bound;
+}
+
+std::uint64_t DurationHistogram::bucketCount(std::size_t bucket) const noexcept {
+    return buckets_[bucket].load(std::memory_order_relaxed);
+}
+
+std::uint64_t DurationHistogram::count() const noexcept {
+    return count_.load(std::memory_order_relaxed);
+}
+
+double DurationHistogram::sumSeconds() const noexcept {
+    return static_cast<double>(sumNanoseconds_.load(std::memory_order_relaxed)) / 1e9;
+}
+
+void RelocationMetrics::recordScanned() noexcept {
+    scanned_.value.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RelocationMetrics::recordMatched() noexcept {
+    matched_.value.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RelocationMetrics::recordMoved(MoveMethod method, std::uintmax_t bytes) noexcept {
+    moved_[indexOf(method)].value.fetch_add(1, std::memory_order_relaxed);
+    bytesMoved_.value.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void RelocationMetrics::recordSkipped() noexcept {
+    skipped_.value.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RelocationMetrics::recordError(ErrorClass errorClass) noexcept {
+    errors_[indexOf(errorClass)].value.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RelocationMetrics::observe(MetricOperation operation, std::chrono::nanoseconds duration) noexcept {
+    histograms_[indexOf(operation)].observe(duration);
+}
+
+void RelocationMetrics::setStageState(RelocationStageId stage, RelocationStageState state) noexcept {
+    stages_[indexOf(stage)].store(state, std::memory_order_relaxed);
+}
+
+std::uint64_t RelocationMetrics::scanned() const noexcept {
+    return scanned_.value.load(std::memory_order_relaxed);
+}
+
+std::uint64_t RelocationMetrics::matched() const noexcept {
+    return matched_.value.load(std::memory_order_relaxed);
+}
+
+std::uint64_t RelocationMetrics::moved(MoveMethod method) const noexcept {
+    return moved_[indexOf(method)].value.load(std::memory_order_relaxed);
+}
+
+std::uint64_t RelocationMetrics::bytesMoved() const noexcept {
+    return bytesMoved_.value.load(std::memory_order_relaxed);
+}
+
+std::uint64_t RelocationMetrics::skipped() const noexcept {
+    return skipped_.value.load(std::memory_order_relaxed);
+}
+
+std::uint64_t RelocationMetrics::errors(ErrorClass errorClass) const noexcept {
+    return errors_[indexOf(errorClass)].value.load(std::memory_order_relaxed);
+}
+
+const DurationHistogram& RelocationMetrics::histogram(MetricOperation operation) const noexcept {
+    return histograms_[indexOf(operation)];
+}
+
+RelocationStageState RelocationMetrics::stageState(RelocationStageId stage) const noexcept {
+    return stages_[indexOf(stage)].load(std::memory_order_relaxed);
+}
+
+std::string RelocationMetrics::renderOpenMetrics() const {
+    return render(true);
+}
+
+std::string RelocationMetrics::renderPrometheusText() const {
+    return render(false);
+}
+
+std::string RelocationMetrics::render(bool openMetrics) const {
+    std::ostringstream out;
+
+    writeCounter(out, "reelocator_files_scanned", "Regular files visited during traversal.", scanned(), openMetrics);
+    writeCounter(out, "reelocator_files_matched", "Files matching the selected media type.", matched(), openMetrics);
+
+    writeCounterHeader(out, "reelocator_files_moved", "Files moved, by method.", openMetrics);
+    for (std::size_t i = 0; i < moved_.size(); ++i) {
+        out << "reelocator_files_moved_total{method=\"" << kMethodNames[i] << "\"} "
+            << moved_[i].value.load(std::memory_order_relaxed) << "\n";
+    }
+
+    writeCounter(out, "reelocator_bytes_moved", "Bytes of file content moved.", bytesMoved(), openMetrics);
+    writeCounter(out, "reelocator_files_skipped", "Matched files left in place after an error.", skipped(),
+                 openMetrics);
+
+    writeCounterHeader(out, "reelocator_errors", "Filesystem errors, by class.", openMetrics);
+    for (std::size_t i = 0; i < errors_.size(); ++i) {
+        out << "reelocator_errors_total{class=\"" << kErrorClassNames[i] << "\"} "
+            << errors_[i].value.load(std::memory_order_relaxed) << "\n";
+    }
+
+    out << "# TYPE reelocator_operation_duration_seconds histogram\n";
+    if (openMetrics) {
+        out << "# UNIT reelocator_operation_duration_seconds seconds\n";
+    }
+    out << "# HELP reelocator_operation_duration_seconds Duration of each per-file operation.\n";
+    for (std::size_t i = 0; i < histograms_.size(); ++i) {
+        const DurationHistogram& histogram = histograms_[i];
+        std::uint64_t cumulative = 0;
+        for (std::size_t bucket = 0; bucket < DurationHistogram::kBucketCount; ++bucket) {
+            cumulative += histogram.bucketCount(bucket);
+            out << "reelocator_operation_duration_seconds_bucket{operation=\"" << kOperationNames[i] << "\",le=\"";
+            if (bucket + 1 == DurationHistogram::kBucketCount) {
+                out << "+Inf";
+            } else {
+                out << DurationHistogram::upperBoundSeconds(bucket);
+            }
+            out << "\"} " << cumulative << "\n";
+        }
+        out << "reelocator_operation_duration_seconds_sum{operation=\"" << kOperationNames[i] << "\"} "
+            << histogram.sumSeconds() << "\n";
+        out << "reelocator_operation_duration_seconds_count{operation=\"" << kOperationNames[i] << "\"} "
+            << cumulative << "\n";
+    }
+
+    // A stateset in OpenMetrics; Prometheus text has no such type, so there
+    // it is the equivalent gauge with one series per state.
+    const char* stateLabel = openMetrics ? "reelocator_stage" : "state";
+    out << "# TYPE reelocator_stage " << (openMetrics ? "stateset" : "gauge") << "\n";
+    out << "# HELP reelocator_stage Current state of each pipeline stage.\n";
+    for (std::size_t stage = 0; stage < stages_.size(); ++stage) {
+        const auto current = static_cast<std::size_t>(stages_[stage].load(std::memory_order_relaxed));
+        for (std::size_t state = 0; state < 4; ++state) {
+            out << "reelocator_stage{stage=\"" << kStageNames[stage] << "\"," << stateLabel << "=\""
+                << kStateNames[state] << "\"} " << (state == current ? 1 : 0) << "\n";
+        }
+    }
+
+    if (openMetrics) {
+        out << "# EOF\n";
+    }
+    return out.str();
+}
+
+MetricsExporter::MetricsExporter(const RelocationMetrics& metrics, MetricsExporterOptions options)
+    : metrics_(metrics), options_(std::move(options)) {}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+void MetricsExporter::start() {
+    if (running_) {
+        return;
+    }
+
+    if (!options_.textfilePath.empty() && options_.interval <= std::chrono::milliseconds::zero()) {
+        throw std::invalid_argument("metrics textfile interval must be positive");
+    }
+
+    if (options_.httpEnabled) {
+#ifdef REELOCATOR_HAVE_SOCKETS
+        listenSocket_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listenSocket_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "metrics socket");
+        }
+
+        const int reuse = 1;
+        ::setsockopt(listenSocket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(options_.httpPort);
+        if (::bind(listenSocket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(listenSocket_, 8) != 0) {
+            const int error = errno;
+            ::close(listenSocket_);
+            listenSocket_ = -1;
+            throw std::system_error(error, std::generic_category(), "metrics endpoint bind");
+        }
+
+        socklen_t length = sizeof(address);
+        ::getsockname(listenSocket_, reinterpret_cast<sockaddr*>(&address), &length);
+        boundPort_ = ntohs(address.sin_port);
+#else
+        throw std::runtime_error("metrics HTTP endpoint is not supported on this platform");
+#endif
+    }
+
+    stopping_ = false;
+    running_ = true;
+
+    if (!options_.textfilePath.empty()) {
+        textfileThread_ = std::thread([this] { textfileLoop(); });
+    }
+    if (listenSocket_ >= 0) {
+        httpThread_ = std::thread([this] { httpLoop(); });
+    }
+}
+
+void MetricsExporter::stop() {
+    if (!running_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+
+    if (textfileThread_.joinable()) {
+        textfileThread_.join();
+    }
+    if (httpThread_.joinable()) {
+        httpThread_.join();
+    }
+
+#ifdef REELOCATOR_HAVE_SOCKETS
+    if (listenSocket_ >= 0) {
+        ::close(listenSocket_);
+        listenSocket_ = -1;
+    }
+#endif
+
+    running_ = false;
+}
+
+void MetricsExporter::writeTextfile() const {
+    if (options_.textfilePath.empty()) {
+        return;
+    }
+
+    // node-exporter must never observe a half-written file, so write a sibling
+    // and rename it over the target.
+    fs::path temporary = options_.textfilePath;
+    temporary += ".tmp";
+
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Failed to open metrics textfile: " + temporary.string());
+        }
+        out << metrics_.renderPrometheusText();
+        out.close();
+        if (!out) {
+            // A full disk surfaces here rather than at open; renaming the
+            // truncated sibling over the target would publish a partial file.
+            std::error_code ignored;
+            fs::remove(temporary, ignored);
+            throw std::runtime_error("Failed to write metrics textfile: " + temporary.string());
+        }
+    }
+
+    fs::rename(temporary, options_.textfilePath);
+}
+
+std::uint16_t MetricsExporter::httpPort() const noexcept {
+    return boundPort_;
+}
+
+void MetricsExporter::textfileLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        const bool stopping = wake_.wait_for(lock, options_.interval, [this] { return stopping_; });
+
+        lock.unlock();
+        try {
+            writeTextfile();
+        } catch (const std::exception& ex) {
+            std::fprintf(stderr, "Metrics textfile error: %s\n", ex.what());
+        }
+        lock.lock();
+
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void MetricsExporter::httpLoop() {
+#ifdef REELOCATOR_HAVE_SOCKETS
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+        }
+
+        pollfd listener{listenSocket_, POLLIN, 0};
+        if (::poll(&listener, 1, 100) <= 0) {
+            continue;
+        }
+
+        const int client = ::accept(listenSocket_, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+
+        char request[1024];
+        std::size_t received = 0;
+        pollfd readable{client, POLLIN, 0};
+        while (received < sizeof(request) - 1 && ::poll(&readable, 1, 1000) > 0) {
+            const ssize_t n = ::recv(client, request + received, sizeof(request) - 1 - received, 0);
+            if (n <= 0) {
+                break;
+            }
+            received += static_cast<std::size_t>(n);
+            if (std::string(request, received).find("\r\n\r\n") != std::string::npos) {
+                break;
+            }
+        }
+
+        const std::string head(request, received);
+        std::string response;
+        if (head.rfind("GET /metrics ", 0) == 0 || head.rfind("GET / ", 0) == 0) {
+            const bool openMetrics = acceptsOpenMetrics(head);
+            const std::string body = openMetrics ? metrics_.renderOpenMetrics() : metrics_.renderPrometheusText();
+            response = std::string("HTTP/1.1 200 OK\r\nContent-Type: ") +
+                       (openMetrics ? "application/openmetrics-text; version=1.0.0; charset=utf-8"
+                                    : "text/plain; version=0.0.4; charset=utf-8") +
+                       "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        } else {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        }
+
+        std::size_t sent = 0;
+        while (sent < response.size()) {
+            const ssize_t n = ::send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                break;
+            }
+            sent += static_cast<std::size_t>(n);
+        }
+        ::close(client);
+    }
+#endif
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+enum class RelocationStageId {
+    Scan,
+    Move,
+};
+
+enum class RelocationStageState {
+    Pending,
+    Running,
+    Done,
+    Failed,
+};
+
+enum class MetricOperation {
+    Classify,
+    Name,
+    Rename,
+    Copy,
+};
+
+enum class MoveMethod {
+    Rename,
+    Copy,
+};
+
+enum class ErrorClass {
+    CrossDevice,
+    PermissionDenied,
+    NoSpace,
+    NotFound,
+    AlreadyExists,
+    Io,
+    Other,
+};
+
+ErrorClass classifyError(const std::error_code& error);
+
+// Fixed log4-spaced buckets from 1us to 4s; the final bucket is +Inf.
+class DurationHistogram {
+public:
+    static constexpr std::size_t kBucketCount = 13;
+
+    void observe(std::chrono::nanoseconds duration) noexcept;
+
+    static double upperBoundSeconds(std::size_t bucket) noexcept;
+    std::uint64_t bucketCount(std::size_t bucket) const noexcept;
+    std::uint64_t count() const noexcept;
+    double sumSeconds() const noexcept;
+
+private:
+    std::array<std::atomic<std::uint64_t>, kBucketCount> buckets_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sumNanoseconds_{0};
+};
+
+// Counters are updated with relaxed atomics on separate cache lines so worker
+// threads never share a lock with each other or with the exporter.
+class RelocationMetrics {
+public:
+    void recordScanned() noexcept;
+    void recordMatched() noexcept;
+    void recordMoved(MoveMethod method, std::uintmax_t bytes) noexcept;
+    void recordSkipped() noexcept;
+    void recordError(ErrorClass errorClass) noexcept;
+    void observe(MetricOperation operation, std::chrono::nanoseconds duration) noexcept;
+    void setStageState(RelocationStageId stage, RelocationStageState state) noexcept;
+
+    std::uint64_t scanned() const noexcept;
+    std::uint64_t matched() const noexcept;
+    std::uint64_t moved(MoveMethod method) const noexcept;
+    std::uint64_t bytesMoved() const noexcept;
+    std::uint64_t skipped() const noexcept;
+    std::uint64_t errors(ErrorClass errorClass) const noexcept;
+    const DurationHistogram& histogram(MetricOperation operation) const noexcept;
+    RelocationStageState stageState(RelocationStageId stage) const noexcept;
+
+    // OpenMetrics 1.0, for scrapers that ask for it.
+    std::string renderOpenMetrics() const;
+    // Prometheus text format 0.0.4, which node-exporter's textfile collector
+    // and older scrapers parse.
+    std::string renderPrometheusText() const;
+
+private:
+    std::string render(bool openMetrics) const;
+
+    struct alignas(64) Counter {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    Counter scanned_;
+    Counter matched_;
+    std::array<Counter, 2> moved_;
+    Counter bytesMoved_;
+    Counter skipped_;
+    std::array<Counter, 7> errors_;
+    std::array<DurationHistogram, 4> histograms_;
+    std::array<std::atomic<RelocationStageState>, 2> stages_{};
+};
+
+struct MetricsExporterOptions {
+    fs::path textfilePath;
+    std::chrono::milliseconds interval{1000};  // must be positive when textfilePath is set
+    bool httpEnabled = false;
+    std::uint16_t httpPort = 0;
+};
+
+// Publishes a RelocationMetrics snapshot from its own threads: an atomically
+// replaced textfile for node-exporter and an optional 127.0.0.1 HTTP endpoint.
+// The textfile is always Prometheus text; the endpoint serves OpenMetrics
+// only when the request's Accept header asks for it.
+class MetricsExporter {
+public:
+    MetricsExporter(const RelocationMetrics& metrics, MetricsExporterOptions options);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    void start();
+    void stop();
+
+    void writeTextfile() const;
+    std::uint16_t httpPort() const noexcept;
+
+private:
+    void textfileLoop();
+    void httpLoop();
+
+    const RelocationMetrics& metrics_;
+    MetricsExporterOptions options_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    bool running_ = false;
+    int listenSocket_ = -1;
+    std::uint16_t boundPort_ = 0;
+    std::thread textfileThread_;
+    std::thread httpThread_;
+};
@@ -0,0 +1,174 @@
+#include "ReelocatorPathArena.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+bool isSeparator(fs::path::value_type ch) {
+    return ch == '/' || ch == fs::path::preferred_separator;
+}
+
+// FNV-1a; names are short, so this is cheaper than std::hash's setup.
+std::uint64_t hashName(PathView name) noexcept {
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const auto ch : name) {
+        hash = (hash ^ static_cast<std::uint64_t>(ch)) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+}  // namespace
+
+PathArena::PathArena(SpillOptions spill) : spillEnabled_(spillSupported()), spill_(std::move(spill)) {}
+
+void PathArena::addChunk() {
+    const std::size_t chunkBytes = kChunkSize * sizeof(fs::path::value_type);
+    if (spillEnabled_ && (heapChunks_.size() + 1) * chunkBytes > spill_.memoryBudget) {
+        if (!spillFile_) {
+            spillFile_ = std::make_unique<SpillFile>(spill_.directory);
+        }
+        // The full chunk before this one is only read from now on.
+        if (!mappedChunks_.empty()) {
+            mappedChunks_.back().dropPrefix(chunkBytes);
+        }
+        mappedChunks_.push_back(spillFile_->map(spillFile_->extend(chunkBytes), chunkBytes, true));
+        chunks_.push_back(reinterpret_cast<fs::path::value_type*>(mappedChunks_.back().data()));
+    } else {
+        heapChunks_.push_back(std::make_unique<fs::path::value_type[]>(kChunkSize));
+        chunks_.push_back(heapChunks_.back().get());
+    }
+}
+
+ArenaString PathArena::store(PathView text) {
+    if (text.size() > ArenaString::kMaxLength) {
+        throw std::length_error("path component too long for PathArena");
+    }
+    const std::uint64_t chunkEnd = static_cast<std::uint64_t>(chunks_.size()) << kChunkShift;
+    if (chunks_.empty() || end_ + text.size() > chunkEnd) {
+        end_ = chunkEnd;
+        addChunk();
+    }
+
+    const std::uint64_t offset = end_;
+    std::copy(text.begin(), text.end(), chunks_.back() + (offset & (kChunkSize - 1)));
+    end_ += text.size();
+    return ArenaString(offset, text.size());
+}
+
+PathView PathArena::view(ArenaString string) const noexcept {
+    const fs::path::value_type* chunk = chunks_.empty() ? nullptr : chunks_[string.offset() >> kChunkShift];
+    return chunk == nullptr ? PathView() : PathView(chunk + (string.offset() & (kChunkSize - 1)), string.length());
+}
+
+DirectoryId PathArena::internDirectory(PathView directory) {
+    if (haveLastDirectory_ && view(directories_[lastDirectory_]) == directory) {
+        return lastDirectory_;
+    }
+
+    auto found = directoryIds_.find(directory);
+    if (found == directoryIds_.end()) {
+        const ArenaString stored = store(directory);
+        const auto id = static_cast<DirectoryId>(directories_.size());
+        directories_.push_back(stored);
+        found = directoryIds_.emplace(view(stored), id).first;
+    }
+    lastDirectory_ = found->second;
+    haveLastDirectory_ = true;
+    return lastDirectory_;
+}
+
+ArenaPath PathArena::add(const fs::path& file) {
+    const PathView native = file.native();
+    std::size_t slash = native.size();
+    while (slash > 0 && !isSeparator(native[slash - 1])) {
+        --slash;
+    }
+    // Keep the separator of a root directory ("/a.jpg" lives in "/").
+    const std::size_t directoryLength = slash > 1 ? slash - 1 : slash;
+
+    ArenaPath path;
+    path.directory = internDirectory(native.substr(0, directoryLength));
+    path.name = store(native.substr(slash));
+    return path;
+}
+
+PathView PathArena::directory(DirectoryId id) const noexcept {
+    return view(directories_[id]);
+}
+
+const fs::path::string_type& PathArena::rebuild(DirectoryId directory, ArenaString name,
+                                                fs::path::string_type& buffer) const {
+    const PathView prefix = this->directory(directory);
+    buffer.assign(prefix.data(), prefix.size());
+    if (!prefix.empty() && !isSeparator(prefix.back())) {
+        buffer.push_back(fs::path::preferred_separator);
+    }
+    const PathView filename = view(name);
+    buffer.append(filename.data(), filename.size());
+    return buffer;
+}
+
+fs::path PathArena::path(const ArenaPath& path) const {
+    fs::path::string_type buffer;
+    return fs::path(std::move(rebuild(path, buffer)));
+}
+
+std::size_t PathArena::bytesReserved() const noexcept {
+    return heapChunks_.size() * kChunkSize * sizeof(fs::path::value_type) +
+           directories_.capacity() * sizeof(ArenaString);
+}
+
+ArenaNameSet::ArenaNameSet(PathArena& arena) : arena_(arena), slots_(64, 0) {}
+
+std::size_t ArenaNameSet::find(PathView name, std::uint64_t hash) const noexcept {
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t slot = static_cast<std::size_t>(hash) & mask;
+    while (slots_[slot] != 0 && arena_.view(ArenaString::fromBits(slots_[slot] - 1)) != name) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+bool ArenaNameSet::contains(PathView name) const noexcept {
+    return slots_[find(name, hashName(name))] != 0;
+}
+
+std::pair<ArenaString, bool> ArenaNameSet::insert(PathView name) {
+    const std::size_t slot = find(name, hashName(name));
+    if (slots_[slot] != 0) {
+        return {ArenaString::fromBits(slots_[slot] - 1), false};
+    }
+    return insert(arena_.store(name));
+}
+
+std::pair<ArenaString, bool> ArenaNameSet::insert(ArenaString stored) {
+    // Grow at 70% load, before probing, so the slot found stays valid.
+    if ((size_ + 1) * 10 > slots_.size() * 7) {
+        grow();
+    }
+    const PathView name = arena_.view(stored);
+    const std::size_t slot = find(name, hashName(name));
+    if (slots_[slot] != 0) {
+        return {ArenaString::fromBits(slots_[slot] - 1), false};
+    }
+    slots_[slot] = stored.bits() + 1;
+    ++size_;
+    return {stored, true};
+}
+
+void ArenaNameSet::grow() {
+    std::vector<std::uint64_t> old(slots_.size() * 2, 0);
+    old.swap(slots_);
+    const std::size_t mask = slots_.size() - 1;
+    for (const std::uint64_t bits : old) {
+        if (bits == 0) {
+            continue;
+        }
+        std::size_t slot = static_cast<std::size_t>(hashName(arena_.view(ArenaString::fromBits(bits - 1)))) & mask;
+        while (slots_[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = bits;
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "ReelocatorSpill.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using PathView = std::basic_string_view<fs::path::value_type>;
+
+// A string stored in a PathArena, packed into one word: 48 bits of offset and
+// 16 bits of length. Names are at most a few hundred characters and whole
+// paths at most PATH_MAX, so 64 KiB is plenty.
+class ArenaString {
+public:
+    static constexpr std::size_t kMaxLength = 0xFFFF;
+
+    ArenaString() = default;
+    ArenaString(std::uint64_t offset, std::size_t length) noexcept : bits_(offset << 16 | length) {}
+
+    std::uint64_t offset() const noexcept { return bits_ >> 16; }
+    std::size_t length() const noexcept { return static_cast<std::size_t>(bits_ & kMaxLength); }
+    std::uint64_t bits() const noexcept { return bits_; }
+
+    static ArenaString fromBits(std::uint64_t bits) noexcept {
+        ArenaString string;
+        string.bits_ = bits;
+        return string;
+    }
+
+private:
+    std::uint64_t bits_ = 0;
+};
+
+using DirectoryId = std::uint32_t;
+
+// A file kept as its interned parent directory and its own name: 16 bytes
+// plus the name's characters, instead of an fs::path with a heap string
+// repeating the whole parent path.
+struct ArenaPath {
+    DirectoryId directory = 0;
+    ArenaString name;
+};
+
+// Append-only character storage for many paths. Each directory is interned
+// once; files refer to it by id. Strings never move once stored, so views
+// stay valid for the arena's lifetime. Paths are rebuilt on demand into a
+// caller-owned buffer that is reused from call to call. Not thread-safe;
+// concurrent readers are fine while nothing is being added.
+class PathArena {
+public:
+    PathArena() = default;
+    // Once `spill.memoryBudget` bytes of characters are on the heap, further
+    // chunks are mapped from a spill file, whose pages the kernel can write
+    // back and drop.
+    explicit PathArena(SpillOptions spill);
+    PathArena(const PathArena&) = delete;
+    PathArena& operator=(const PathArena&) = delete;
+
+    // Throws std::length_error for strings longer than ArenaString::kMaxLength.
+    ArenaString store(PathView text);
+    DirectoryId internDirectory(PathView directory);
+    // Splits at the last separator without building intermediate paths.
+    ArenaPath add(const fs::path& file);
+
+    PathView view(ArenaString string) const noexcept;
+    PathView directory(DirectoryId id) const noexcept;
+    PathView name(const ArenaPath& path) const noexcept { return view(path.name); }
+
+    // Replaces `buffer` with directory + separator + name; allocates only
+    // while the buffer is still growing.
+    const fs::path::string_type& rebuild(DirectoryId directory, ArenaString name,
+                                         fs::path::string_type& buffer) const;
+    const fs::path::string_type& rebuild(const ArenaPath& path, fs::path::string_type& buffer) const {
+        return rebuild(path.directory, path.name, buffer);
+    }
+    fs::path path(const ArenaPath& path) const;
+
+    std::size_t directoryCount() const noexcept { return directories_.size(); }
+    // Heap bytes of chunks and the directory table; spilled chunks excluded.
+    std::size_t bytesReserved() const noexcept;
+
+private:
+    static constexpr std::size_t kChunkShift = 20;
+    static constexpr std::size_t kChunkSize = std::size_t{1} << kChunkShift;
+
+    void addChunk();
+
+    std::vector<fs::path::value_type*> chunks_;
+    std::vector<std::unique_ptr<fs::path::value_type[]>> heapChunks_;
+    bool spillEnabled_ = false;
+    SpillOptions spill_;
+    std::unique_ptr<SpillFile> spillFile_;
+    std::vector<SpillMapping> mappedChunks_;
+    // Offset of the next free character; strings never straddle chunks.
+    std::uint64_t end_ = 0;
+    std::vector<ArenaString> directories_;
+    std::unordered_map<PathView, DirectoryId> directoryIds_;
+    // Traversal adds a directory's files together, so most lookups hit this.
+    DirectoryId lastDirectory_ = 0;
+    bool haveLastDirectory_ = false;
+};
+
+// Set of names stored in a PathArena, with eight bytes per slot and open
+// addressing, for indexes that would otherwise hold one heap string per
+// file. Names cannot be removed.
+class ArenaNameSet {
+public:
+    explicit ArenaNameSet(PathArena& arena);
+
+    bool contains(PathView name) const noexcept;
+    // Adds `name`, copying it into the arena only when it is new. Returns the
+    // stored string and whether it was inserted.
+    std::pair<ArenaString, bool> insert(PathView name);
+    // Adds a string already in the arena without copying it.
+    std::pair<ArenaString, bool> insert(ArenaString stored);
+
+    std::size_t size() const noexcept { return size_; }
+    std::size_t bytesReserved() const noexcept { return slots_.capacity() * sizeof(std::uint64_t); }
+
+private:
+    std::size_t find(PathView name, std::uint64_t hash) const noexcept;
+    void grow();
+
+    PathArena& arena_;
+    // ArenaString bits plus one, so zero marks an empty slot.
+    std::vector<std::uint64_t> slots_;
+    std::size_t size_ = 0;
+};
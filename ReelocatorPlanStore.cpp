@@ -0,0 +1,36 @@
+#include "ReelocatorPlanStore.hpp"
+#include "ReelocatorCore.hpp"
+
+#include <type_traits>
+
+namespace {
+
+static_assert(std::is_trivially_copyable<SpilledMoves::Record>::value, "spilled records are copied as bytes");
+
+SpillOptions halfBudget(SpillOptions options) {
+    options.memoryBudget /= 2;
+    return options;
+}
+
+}  // namespace
+
+SpilledMoves::SpilledMoves(const SpillOptions& options)
+    : arena_(halfBudget(options)), records_(sizeof(Record), halfBudget(options)) {}
+
+void SpilledMoves::add(const fs::path& source, const fs::path& destination, std::uintmax_t size) {
+    const ArenaPath from = arena_.add(source);
+    const ArenaPath to = arena_.add(destination);
+    const Record record{from.directory, to.directory, from.name, to.name, static_cast<std::uint64_t>(size)};
+    records_.append(&record);
+}
+
+PlannedMove SpilledMoves::move(const Record& record) const {
+    return PlannedMove{arena_.path(ArenaPath{record.sourceDirectory, record.sourceName}),
+                       arena_.path(ArenaPath{record.destinationDirectory, record.destinationName}),
+                       static_cast<std::uintmax_t>(record.size)};
+}
+
+fs::path SpilledMoves::destinationName(const Record& record) const {
+    const PathView name = arena_.view(record.destinationName);
+    return fs::path(fs::path::string_type(name));
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ReelocatorPathArena.hpp"
+#include "ReelocatorSpill.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+struct PlannedMove;
+
+// The moves of one plan, kept out of the heap once they outgrow a budget.
+// Paths go to a spilling PathArena and fixed-size records to a RecordSpill,
+// each allowed half of SpillOptions::memoryBudget. Moves are read back one
+// chunk of records at a time and rebuilt into PlannedMoves on demand. Adding
+// is not thread-safe; reading from many threads is.
+class SpilledMoves {
+public:
+    struct Record {
+        DirectoryId sourceDirectory;
+        DirectoryId destinationDirectory;
+        ArenaString sourceName;
+        ArenaString destinationName;
+        std::uint64_t size;
+    };
+
+    explicit SpilledMoves(const SpillOptions& options);
+
+    SpilledMoves(const SpilledMoves&) = delete;
+    SpilledMoves& operator=(const SpilledMoves&) = delete;
+
+    void add(const fs::path& source, const fs::path& destination, std::uintmax_t size);
+
+    std::uint64_t size() const noexcept { return records_.size(); }
+    std::uint64_t spilledBytes() const noexcept { return records_.spilledBytes(); }
+
+    // Records in plan order, as consecutive runs; see RecordSpill::chunk().
+    std::size_t chunkCount() const noexcept { return records_.chunkCount(); }
+    RecordSpill::Chunk chunk(std::size_t index) const { return records_.chunk(index, false); }
+    static const Record* records(const RecordSpill::Chunk& chunk) noexcept {
+        return reinterpret_cast<const Record*>(chunk.data());
+    }
+
+    PlannedMove move(const Record& record) const;
+    fs::path destinationName(const Record& record) const;
+
+private:
+    PathArena arena_;
+    RecordSpill records_;
+};
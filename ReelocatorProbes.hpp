@@ -0,0 +1,25 @@
+#pragma once
+
+// USDT probes for bpftrace/SystemTap, e.g.
+//   bpftrace -e 'usdt:./reelocator:reelocator:rename_end { @[arg2] = count(); }'
+// sys/sdt.h is header-only: an inactive probe is a single NOP plus an ELF note,
+// with no runtime library. When the header is unavailable, or the build sets
+// REELOCATOR_ENABLE_USDT=OFF, the macros compile to nothing.
+
+#if defined(REELOCATOR_ENABLE_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define REELOCATOR_HAVE_USDT 1
+#endif
+#endif
+
+#ifdef REELOCATOR_HAVE_USDT
+#define REELOCATOR_PROBE1(name, a) DTRACE_PROBE1(reelocator, name, a)
+#define REELOCATOR_PROBE2(name, a, b) DTRACE_PROBE2(reelocator, name, a, b)
+#define REELOCATOR_PROBE3(name, a, b, c) DTRACE_PROBE3(reelocator, name, a, b, c)
+#else
+// sizeof keeps the arguments unevaluated but still "used".
+#define REELOCATOR_PROBE1(name, a) ((void)sizeof(a))
+#define REELOCATOR_PROBE2(name, a, b) ((void)sizeof(a), (void)sizeof(b))
+#define REELOCATOR_PROBE3(name, a, b, c) ((void)sizeof(a), (void)sizeof(b), (void)sizeof(c))
+#endif
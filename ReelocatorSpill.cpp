@@ -0,0 +1,228 @@
+#include "ReelocatorSpill.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define REELOCATOR_HAVE_MMAP 1
+#endif
+
+namespace {
+
+#ifdef REELOCATOR_HAVE_MMAP
+
+[[noreturn]] void throwErrno(const char* what, const fs::path& path) {
+    throw fs::filesystem_error(what, path, std::error_code(errno, std::generic_category()));
+}
+
+std::size_t pageSize() {
+    static const std::size_t size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+#endif
+
+// Validates before the member initializers divide by the size.
+std::size_t checkedRecordSize(std::size_t recordSize) {
+    if (recordSize == 0) {
+        throw std::invalid_argument("record size must be positive");
+    }
+    return recordSize;
+}
+
+}  // namespace
+
+bool spillSupported() noexcept {
+#ifdef REELOCATOR_HAVE_MMAP
+    return true;
+#else
+    return false;
+#endif
+}
+
+SpillMapping::SpillMapping(unsigned char* base, std::size_t length, std::size_t offset, std::size_t size) noexcept
+    : base_(base), length_(length), offset_(offset), size_(size) {}
+
+SpillMapping::~SpillMapping() {
+#ifdef REELOCATOR_HAVE_MMAP
+    if (base_ != nullptr) {
+        ::munmap(base_, length_);
+    }
+#endif
+}
+
+SpillMapping::SpillMapping(SpillMapping&& other) noexcept
+    : base_(std::exchange(other.base_, nullptr)),
+      length_(std::exchange(other.length_, 0)),
+      offset_(std::exchange(other.offset_, 0)),
+      size_(std::exchange(other.size_, 0)) {}
+
+SpillMapping& SpillMapping::operator=(SpillMapping&& other) noexcept {
+    if (this != &other) {
+        SpillMapping old(std::move(*this));
+        base_ = std::exchange(other.base_, nullptr);
+        length_ = std::exchange(other.length_, 0);
+        offset_ = std::exchange(other.offset_, 0);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+void SpillMapping::dropPrefix(std::size_t bytes) noexcept {
+#ifdef REELOCATOR_HAVE_MMAP
+    if (base_ == nullptr) {
+        return;
+    }
+    const std::size_t whole = (offset_ + std::min(bytes, size_)) / pageSize() * pageSize();
+    if (whole != 0) {
+        ::madvise(base_, whole, MADV_DONTNEED);
+    }
+#else
+    (void)bytes;
+#endif
+}
+
+#ifdef REELOCATOR_HAVE_MMAP
+
+SpillFile::SpillFile(const fs::path& directory) {
+    const fs::path base = directory.empty() ? fs::temp_directory_path() : directory;
+    std::string pattern = (base / "reelocator-spill-XXXXXX").string();
+    fd_ = ::mkstemp(pattern.data());
+    if (fd_ < 0) {
+        throwErrno("cannot create spill file", base);
+    }
+    ::unlink(pattern.c_str());
+}
+
+SpillFile::~SpillFile() {
+    ::close(fd_);
+}
+
+std::uint64_t SpillFile::append(const void* data, std::size_t bytes) {
+    const std::uint64_t offset = size_;
+    const auto* next = static_cast<const unsigned char*>(data);
+    std::size_t left = bytes;
+    while (left > 0) {
+        const ssize_t written = ::pwrite(fd_, next, left, static_cast<off_t>(offset + (bytes - left)));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throwErrno("cannot write spill file", fs::path());
+        }
+        next += written;
+        left -= static_cast<std::size_t>(written);
+    }
+    size_ += bytes;
+    return offset;
+}
+
+std::uint64_t SpillFile::extend(std::size_t bytes) {
+    const std::uint64_t offset = size_;
+    if (::ftruncate(fd_, static_cast<off_t>(offset + bytes)) != 0) {
+        throwErrno("cannot extend spill file", fs::path());
+    }
+    size_ += bytes;
+    return offset;
+}
+
+SpillMapping SpillFile::map(std::uint64_t offset, std::size_t bytes, bool writable) const {
+    if (bytes == 0) {
+        return SpillMapping();
+    }
+    const std::uint64_t aligned = offset / pageSize() * pageSize();
+    const auto delta = static_cast<std::size_t>(offset - aligned);
+    const int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* base = ::mmap(nullptr, delta + bytes, protection, MAP_SHARED, fd_, static_cast<off_t>(aligned));
+    if (base == MAP_FAILED) {
+        throwErrno("cannot map spill file", fs::path());
+    }
+    return SpillMapping(static_cast<unsigned char*>(base), delta + bytes, delta, bytes);
+}
+
+#else
+
+SpillFile::SpillFile(const fs::path&) {
+    throw std::runtime_error("spill files require mmap");
+}
+
+SpillFile::~SpillFile() = default;
+
+std::uint64_t SpillFile::append(const void*, std::size_t) {
+    return 0;
+}
+
+std::uint64_t SpillFile::extend(std::size_t) {
+    return 0;
+}
+
+SpillMapping SpillFile::map(std::uint64_t, std::size_t, bool) const {
+    return SpillMapping();
+}
+
+#endif
+
+RecordSpill::RecordSpill(std::size_t recordSize, SpillOptions options)
+    : recordSize_(checkedRecordSize(recordSize)),
+      options_(std::move(options)),
+      bufferCapacity_(std::max<std::size_t>(1, options_.memoryBudget / recordSize_) * recordSize_) {}
+
+RecordSpill::RecordSpill(RecordSpill&&) noexcept = default;
+RecordSpill& RecordSpill::operator=(RecordSpill&&) noexcept = default;
+RecordSpill::~RecordSpill() = default;
+
+void RecordSpill::append(const void* record) {
+    if (buffer_.size() + recordSize_ > bufferCapacity_ && spillSupported()) {
+        flush();
+    }
+    // Grow by hand so doubling never takes the buffer past the budget.
+    if (buffer_.size() + recordSize_ > buffer_.capacity()) {
+        buffer_.reserve(std::min(bufferCapacity_, std::max(buffer_.capacity() * 2, recordSize_ * 64)));
+    }
+    const auto* bytes = static_cast<const unsigned char*>(record);
+    buffer_.insert(buffer_.end(), bytes, bytes + recordSize_);
+    ++size_;
+}
+
+void RecordSpill::flush() {
+    if (buffer_.empty()) {
+        return;
+    }
+    if (!file_) {
+        file_ = std::make_unique<SpillFile>(options_.directory);
+    }
+    const std::uint64_t offset = file_->append(buffer_.data(), buffer_.size());
+    segments_.push_back(Segment{offset, buffer_.size() / recordSize_});
+    buffer_.clear();
+}
+
+std::uint64_t RecordSpill::spilledBytes() const noexcept {
+    return file_ ? file_->size() : 0;
+}
+
+std::size_t RecordSpill::chunkCount() const noexcept {
+    return segments_.size() + (buffer_.empty() ? 0 : 1);
+}
+
+RecordSpill::Chunk RecordSpill::chunk(std::size_t index, bool writable) const {
+    Chunk chunk;
+    chunk.recordSize_ = recordSize_;
+    if (index < segments_.size()) {
+        const Segment& segment = segments_[index];
+        chunk.mapping_ = file_->map(segment.offset, segment.count * recordSize_, writable);
+        chunk.data_ = chunk.mapping_.data();
+        chunk.count_ = segment.count;
+    } else {
+        // The heap records; writable access is for in-place sorting by the
+        // SpillVector that owns this store.
+        chunk.data_ = const_cast<unsigned char*>(buffer_.data());
+        chunk.count_ = buffer_.size() / recordSize_;
+    }
+    return chunk;
+}
@@ -0,0 +1,308 @@
+#pragma once
+
+#include "ReelocatorThreadPool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct SpillOptions {
+    // Where spill files are created; empty uses fs::temp_directory_path().
+    // The files are unlinked as soon as they are open, so nothing is left
+    // behind even after a crash.
+    fs::path directory;
+    // Heap bytes a store may hold before it writes to a spill file.
+    std::size_t memoryBudget = std::size_t{64} << 20;
+};
+
+struct ExternalSortOptions {
+    // Sorts runs and merges groups on the pool's workers as well as the
+    // calling thread; null does all the work on the caller.
+    ThreadPool* pool = nullptr;
+    // Most runs merged at once. More runs take extra merge passes, each
+    // reading and writing every record once.
+    std::size_t fanIn = 64;
+    // Temporary space for merged runs, and for the sorted result; empty uses
+    // the store's own SpillOptions::directory.
+    fs::path directory;
+};
+
+// False where there is no mmap; stores then keep everything on the heap.
+bool spillSupported() noexcept;
+
+// A mapped range of a SpillFile, unmapped on destruction.
+class SpillMapping {
+public:
+    SpillMapping() = default;
+    SpillMapping(unsigned char* base, std::size_t length, std::size_t offset, std::size_t size) noexcept;
+    ~SpillMapping();
+
+    SpillMapping(SpillMapping&& other) noexcept;
+    SpillMapping& operator=(SpillMapping&& other) noexcept;
+    SpillMapping(const SpillMapping&) = delete;
+    SpillMapping& operator=(const SpillMapping&) = delete;
+
+    unsigned char* data() const noexcept { return base_ + offset_; }
+    std::size_t size() const noexcept { return size_; }
+
+    // Lets the kernel drop the resident pages of the first `bytes`, which are
+    // read back from the file if touched again. Keeps a sequential pass from
+    // growing RSS.
+    void dropPrefix(std::size_t bytes) noexcept;
+
+private:
+    unsigned char* base_ = nullptr;
+    std::size_t length_ = 0;
+    std::size_t offset_ = 0;
+    std::size_t size_ = 0;
+};
+
+// An append-only temporary file, read back through mmap.
+class SpillFile {
+public:
+    explicit SpillFile(const fs::path& directory);
+    ~SpillFile();
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    std::uint64_t size() const noexcept { return size_; }
+    // Writes at the end of the file and returns the offset written to.
+    std::uint64_t append(const void* data, std::size_t bytes);
+    // Grows the file by `bytes` of zeros and returns their offset.
+    std::uint64_t extend(std::size_t bytes);
+    // Writes through a writable mapping reach the file.
+    SpillMapping map(std::uint64_t offset, std::size_t bytes, bool writable) const;
+
+private:
+    int fd_ = -1;
+    std::uint64_t size_ = 0;
+};
+
+// Append-only sequence of fixed-size records. Records collect on the heap
+// until they fill the memory budget, then the batch is written to a spill
+// file as one segment and the heap buffer is reused, so heap use stays under
+// the budget however many records are added. Reading maps one segment at a
+// time. Not thread-safe.
+class RecordSpill {
+public:
+    RecordSpill(std::size_t recordSize, SpillOptions options = SpillOptions());
+
+    RecordSpill(RecordSpill&&) noexcept;
+    RecordSpill& operator=(RecordSpill&&) noexcept;
+    ~RecordSpill();
+
+    void append(const void* record);
+
+    std::size_t recordSize() const noexcept { return recordSize_; }
+    std::uint64_t size() const noexcept { return size_; }
+    std::size_t segmentCount() const noexcept { return segments_.size(); }
+    std::uint64_t spilledBytes() const noexcept;
+    const SpillOptions& options() const noexcept { return options_; }
+
+    // A run of consecutive records: one spilled segment, mapped, or the
+    // records still on the heap.
+    class Chunk {
+    public:
+        unsigned char* data() const noexcept { return data_; }
+        std::size_t count() const noexcept { return count_; }
+        void dropConsumed(std::size_t records) noexcept { mapping_.dropPrefix(records * recordSize_); }
+
+    private:
+        friend class RecordSpill;
+        SpillMapping mapping_;
+        unsigned char* data_ = nullptr;
+        std::size_t count_ = 0;
+        std::size_t recordSize_ = 0;
+    };
+
+    // Segments in append order, then the heap records.
+    std::size_t chunkCount() const noexcept;
+    Chunk chunk(std::size_t index, bool writable) const;
+
+private:
+    struct Segment {
+        std::uint64_t offset;
+        std::size_t count;
+    };
+
+    void flush();
+
+    std::size_t recordSize_;
+    SpillOptions options_;
+    std::size_t bufferCapacity_;
+    std::vector<unsigned char> buffer_;
+    std::unique_ptr<SpillFile> file_;
+    std::vector<Segment> segments_;
+    std::uint64_t size_ = 0;
+};
+
+// Typed view of a RecordSpill for trivially copyable records.
+template <typename Record>
+class SpillVector {
+    static_assert(std::is_trivially_copyable<Record>::value, "spilled records are copied as bytes");
+
+public:
+    explicit SpillVector(SpillOptions options = SpillOptions()) : spill_(sizeof(Record), std::move(options)) {}
+
+    void push_back(const Record& record) { spill_.append(&record); }
+    std::uint64_t size() const noexcept { return spill_.size(); }
+    bool empty() const noexcept { return spill_.size() == 0; }
+    const RecordSpill& storage() const noexcept { return spill_; }
+
+    template <typename Visitor>
+    void forEach(Visitor&& visit) const {
+        for (std::size_t i = 0; i < spill_.chunkCount(); ++i) {
+            RecordSpill::Chunk chunk = spill_.chunk(i, false);
+            const Record* records = reinterpret_cast<const Record*>(chunk.data());
+            for (std::size_t j = 0; j < chunk.count(); ++j) {
+                visit(records[j]);
+                if ((j + 1) % kDropInterval == 0) {
+                    chunk.dropConsumed(j + 1);
+                }
+            }
+        }
+    }
+
+    // External merge sort by key(record). Run generation sorts every chunk
+    // in place, in parallel on `options.pool`. The runs are then merged at
+    // most `options.fanIn` at a time, each pass writing new runs to the
+    // temporary directory and releasing the previous ones, until one run
+    // remains. Heap use stays within one budget per run being written plus
+    // the merge cursors. Records with equal keys keep no particular order.
+    template <typename KeyFn>
+    void sortBy(KeyFn key, const ExternalSortOptions& options = ExternalSortOptions()) {
+        auto less = [&key](const Record& a, const Record& b) { return key(a) < key(b); };
+        const std::size_t chunks = spill_.chunkCount();
+        auto sortChunk = [&](std::size_t i) {
+            RecordSpill::Chunk chunk = spill_.chunk(i, true);
+            Record* records = reinterpret_cast<Record*>(chunk.data());
+            std::sort(records, records + chunk.count(), less);
+        };
+        runOn(options.pool, chunks, sortChunk);
+        if (chunks <= 1) {
+            return;
+        }
+
+        SpillOptions runOptions = spill_.options();
+        if (!options.directory.empty()) {
+            runOptions.directory = options.directory;
+        }
+        const std::size_t fanIn = std::max<std::size_t>(2, options.fanIn);
+
+        std::vector<Run> runs;
+        for (std::size_t i = 0; i < chunks; ++i) {
+            runs.push_back(Run{&spill_, i, i + 1});
+        }
+        std::vector<RecordSpill> previous;
+        while (runs.size() > 1) {
+            const std::size_t groups = (runs.size() + fanIn - 1) / fanIn;
+            std::vector<RecordSpill> merged;
+            merged.reserve(groups);
+            for (std::size_t g = 0; g < groups; ++g) {
+                merged.emplace_back(sizeof(Record), runOptions);
+            }
+            runOn(options.pool, groups, [&](std::size_t g) {
+                const auto first = runs.begin() + static_cast<std::ptrdiff_t>(g * fanIn);
+                const auto last = runs.begin() + static_cast<std::ptrdiff_t>(std::min(runs.size(), (g + 1) * fanIn));
+                mergeRuns(std::vector<Run>(first, last), key, merged[g]);
+            });
+
+            // The inputs of this pass are no longer needed; dropping them
+            // frees their temporary space before the next pass.
+            previous = std::move(merged);
+            runs.clear();
+            for (const RecordSpill& store : previous) {
+                runs.push_back(Run{&store, 0, store.chunkCount()});
+            }
+        }
+        spill_ = std::move(previous.front());
+    }
+
+private:
+    static constexpr std::size_t kDropInterval = 4096;
+
+    // A sorted sequence of records: chunks [firstChunk, endChunk) of a store.
+    struct Run {
+        const RecordSpill* store;
+        std::size_t firstChunk;
+        std::size_t endChunk;
+    };
+
+    template <typename Body>
+    static void runOn(ThreadPool* pool, std::size_t count, Body&& body) {
+        if (pool != nullptr && count > 1) {
+            pool->parallelFor(count, body);
+        } else {
+            for (std::size_t i = 0; i < count; ++i) {
+                body(i);
+            }
+        }
+    }
+
+    // k-way merge of sorted runs into `output`, mapping one chunk per run at
+    // a time. Ties go to the earlier run, so merging is deterministic.
+    template <typename KeyFn>
+    static void mergeRuns(const std::vector<Run>& runs, KeyFn& key, RecordSpill& output) {
+        struct Cursor {
+            Run run;
+            std::size_t chunkIndex;
+            RecordSpill::Chunk chunk;
+            std::size_t next = 0;
+
+            // Moves to the next non-empty chunk; false once the run is done.
+            bool settle() {
+                while (next == chunk.count()) {
+                    if (++chunkIndex >= run.endChunk) {
+                        return false;
+                    }
+                    chunk = run.store->chunk(chunkIndex, false);
+                    next = 0;
+                }
+                return true;
+            }
+            const Record& record() const { return reinterpret_cast<const Record*>(chunk.data())[next]; }
+        };
+
+        std::vector<Cursor> cursors;
+        cursors.reserve(runs.size());
+        for (const Run& run : runs) {
+            cursors.push_back(Cursor{run, run.firstChunk, run.store->chunk(run.firstChunk, false), 0});
+        }
+        auto later = [&](std::size_t a, std::size_t b) {
+            const auto keyA = key(cursors[a].record());
+            const auto keyB = key(cursors[b].record());
+            return keyB < keyA || (!(keyA < keyB) && b < a);
+        };
+        std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> heads(later);
+        for (std::size_t i = 0; i < cursors.size(); ++i) {
+            if (cursors[i].settle()) {
+                heads.push(i);
+            }
+        }
+
+        while (!heads.empty()) {
+            const std::size_t top = heads.top();
+            heads.pop();
+            Cursor& cursor = cursors[top];
+            output.append(&cursor.record());
+            if (++cursor.next % kDropInterval == 0) {
+                cursor.chunk.dropConsumed(cursor.next);
+            }
+            if (cursor.settle()) {
+                heads.push(top);
+            }
+        }
+    }
+
+    RecordSpill spill_;
+};
@@ -0,0 +1,236 @@
+#include "ReelocatorThreadPool.hpp"
+
+#include <atomic>
+#include <exception>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr double kInteractiveWeight = 8.0;
+constexpr double kBulkWeight = 1.0;
+
+double weightOf(JobPriority priority) {
+    return priority == JobPriority::Interactive ? kInteractiveWeight : kBulkWeight;
+}
+
+#if defined(__linux__) && defined(SYS_ioprio_set) && defined(SYS_ioprio_get)
+#define REELOCATOR_HAVE_IOPRIO 1
+
+constexpr int kIoprioWhoProcess = 1;
+
+int ioprioValue(JobPriority priority) noexcept {
+    constexpr int kIoprioClassBestEffort = 2;
+    constexpr int kIoprioClassShift = 13;
+    const int level = priority == JobPriority::Interactive ? 0 : 7;
+    return (kIoprioClassBestEffort << kIoprioClassShift) | level;
+}
+
+// With IOPRIO_WHO_PROCESS, who == 0 means the calling thread.
+int threadIoprio() noexcept {
+    return static_cast<int>(::syscall(SYS_ioprio_get, kIoprioWhoProcess, 0));
+}
+
+void setThreadIoprio(int value) noexcept {
+    ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, value);
+}
+#endif
+
+}  // namespace
+
+bool parseJobPriority(const std::string& text, JobPriority& priority) {
+    if (text == "interactive") {
+        priority = JobPriority::Interactive;
+        return true;
+    }
+    if (text == "bulk") {
+        priority = JobPriority::Bulk;
+        return true;
+    }
+    return false;
+}
+
+const char* jobPriorityLabel(JobPriority priority) {
+    return priority == JobPriority::Interactive ? "interactive" : "bulk";
+}
+
+void applyIoPriority(JobPriority priority) noexcept {
+#ifdef REELOCATOR_HAVE_IOPRIO
+    // Skip the syscall when this thread already runs at the requested class.
+    thread_local int current = -1;
+    const int wanted = static_cast<int>(priority);
+    if (current == wanted) {
+        return;
+    }
+    current = wanted;
+    setThreadIoprio(ioprioValue(priority));
+#else
+    (void)priority;
+#endif
+}
+
+ScopedIoPriority::~ScopedIoPriority() {
+#ifdef REELOCATOR_HAVE_IOPRIO
+    if (saved_ >= 0) {
+        setThreadIoprio(saved_);
+    }
+#endif
+}
+
+void ScopedIoPriority::set(JobPriority priority) noexcept {
+#ifdef REELOCATOR_HAVE_IOPRIO
+    if (saved_ < 0) {
+        saved_ = threadIoprio();
+        if (saved_ < 0) {
+            return;
+        }
+    } else if (current_ == priority) {
+        return;
+    }
+    current_ = priority;
+    setThreadIoprio(ioprioValue(priority));
+#else
+    (void)priority;
+#endif
+}
+
+struct ThreadPool::Batch {
+    Batch(std::size_t itemCount, const std::function<void(std::size_t)>& itemBody, JobPriority itemPriority)
+        : count(itemCount), body(itemBody), priority(itemPriority), weight(weightOf(itemPriority)) {}
+
+    const std::size_t count;
+    const std::function<void(std::size_t)>& body;
+    const JobPriority priority;
+    const double weight;
+
+    // Guarded by ThreadPool::mutex_.
+    std::size_t next = 0;
+    double virtualTime = 0.0;
+
+    std::atomic<std::size_t> finished{0};
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+};
+
+ThreadPool::ThreadPool(std::size_t threadCount) {
+    workers_.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::size_t ThreadPool::size() const noexcept {
+    return workers_.size();
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& body, JobPriority priority) {
+    if (count == 0) {
+        return;
+    }
+
+    auto batch = std::make_shared<Batch>(count, body, priority);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch->virtualTime = virtualTime_;
+        batches_.push_back(batch);
+    }
+    wake_.notify_all();
+
+    // The caller schedules like any worker, so it may run another batch's
+    // index while its own batch waits for its fair share. It is not a pool
+    // thread, so its own I/O priority comes back when the batch is done.
+    ScopedIoPriority ioPriority;
+    while (true) {
+        std::shared_ptr<Batch> claimed;
+        std::size_t index = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (batch->next >= batch->count || !claim(claimed, index)) {
+                break;
+            }
+        }
+        ioPriority.set(claimed->priority);
+        run(*claimed, index);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(batch->mutex);
+        batch->done.wait(lock, [&batch] { return batch->finished.load() == batch->count; });
+    }
+
+    if (batch->error) {
+        std::rethrow_exception(batch->error);
+    }
+}
+
+// Requires mutex_. Takes the next index of the batch with the smallest virtual
+// time and retires batches whose indices have all been handed out.
+bool ThreadPool::claim(std::shared_ptr<Batch>& batch, std::size_t& index) {
+    auto best = batches_.end();
+    for (auto it = batches_.begin(); it != batches_.end(); ++it) {
+        if (best == batches_.end() || (*it)->virtualTime < (*best)->virtualTime) {
+            best = it;
+        }
+    }
+    if (best == batches_.end()) {
+        return false;
+    }
+
+    batch = *best;
+    index = batch->next++;
+    virtualTime_ = batch->virtualTime;
+    batch->virtualTime += 1.0 / batch->weight;
+    if (batch->next == batch->count) {
+        batches_.erase(best);
+    }
+    return true;
+}
+
+void ThreadPool::run(Batch& batch, std::size_t index) {
+    try {
+        batch.body(index);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        if (!batch.error) {
+            batch.error = std::current_exception();
+        }
+    }
+
+    if (batch.finished.fetch_add(1) + 1 == batch.count) {
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        batch.done.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::shared_ptr<Batch> batch;
+        std::size_t index = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !batches_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            claim(batch, index);
+        }
+
+        applyIoPriority(batch->priority);
+        run(*batch, index);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Scheduling class of a parallelFor() batch. Interactive batches get eight
+// times the share of pool time of bulk batches and run at the highest
+// best-effort I/O priority; bulk batches run at the lowest.
+enum class JobPriority {
+    Interactive,
+    Bulk
+};
+
+bool parseJobPriority(const std::string& text, JobPriority& priority);
+const char* jobPriorityLabel(JobPriority priority);
+
+// Sets the calling thread's I/O priority for the given class and leaves it
+// there; meant for threads the pool owns. Only Linux supports per-thread I/O
+// priorities; elsewhere this does nothing.
+void applyIoPriority(JobPriority priority) noexcept;
+
+// Switches a thread the pool does not own, such as a parallelFor() caller,
+// to a class's I/O priority for the lifetime of the guard, then puts back
+// whatever priority the thread had before.
+class ScopedIoPriority {
+public:
+    ScopedIoPriority() = default;
+    ~ScopedIoPriority();
+
+    ScopedIoPriority(const ScopedIoPriority&) = delete;
+    ScopedIoPriority& operator=(const ScopedIoPriority&) = delete;
+
+    void set(JobPriority priority) noexcept;
+
+private:
+    // The thread's ioprio value before the first set(), or -1 while unchanged.
+    int saved_ = -1;
+    JobPriority current_ = JobPriority::Interactive;
+};
+
+// Fixed set of worker threads kept alive across calls. parallelFor() may be
+// called from several threads at once; each call's indices are shared between
+// the pool and the calling thread, which also does work until its batch drains.
+// Concurrent batches are served by start-time weighted fair queuing: every
+// index taken advances its batch's virtual time by 1/weight, and the next index
+// always comes from the batch with the smallest virtual time.
+class ThreadPool {
+public:
+    explicit ThreadPool(std::size_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const noexcept;
+
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& body,
+                     JobPriority priority = JobPriority::Interactive);
+
+private:
+    struct Batch;
+
+    void workerLoop();
+    bool claim(std::shared_ptr<Batch>& batch, std::size_t& index);
+    static void run(Batch& batch, std::size_t index);
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::shared_ptr<Batch>> batches_;
+    double virtualTime_ = 0.0;
+    bool stopping_ = false;
+};
@@ -0,0 +1,122 @@
+#include "ReelocatorTrace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+
+namespace {
+
+std::atomic<std::uint64_t> nextRecorderId{1};
+
+// Recorder ids are never reused, so a stale cache entry left behind by a
+// destroyed recorder can never be mistaken for a live one.
+struct ThreadBufferCacheEntry {
+    std::uint64_t recorderId = 0;
+    void* buffer = nullptr;
+};
+
+// Most recently used first. A thread rarely feeds more than a couple of
+// recorders; one that outgrows the cache finds its buffer again under the
+// recorder lock instead of starting a new one.
+thread_local std::array<ThreadBufferCacheEntry, 4> threadBufferCache;
+
+void writeMicroseconds(std::ostream& out, std::int64_t nanoseconds) {
+    out << nanoseconds / 1000 << "." << std::setw(3) << std::setfill('0') << nanoseconds % 1000;
+}
+
+}  // namespace
+
+TraceRecorder::TraceRecorder() : id_(nextRecorderId.fetch_add(1)), origin_(Clock::now()) {}
+
+void TraceRecorder::record(const char* name, Clock::time_point start, Clock::time_point end) {
+    const auto startNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin_).count();
+    const auto durationNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    threadBuffer().events.push_back(Event{name, startNanoseconds, durationNanoseconds, 0, false});
+}
+
+void TraceRecorder::record(const char* name, Clock::time_point start, Clock::time_point end, std::uint64_t count) {
+    const auto startNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin_).count();
+    const auto durationNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    threadBuffer().events.push_back(Event{name, startNanoseconds, durationNanoseconds, count, true});
+}
+
+TraceRecorder::ThreadBuffer& TraceRecorder::threadBuffer() {
+    if (threadBufferCache[0].recorderId == id_) {
+        return *static_cast<ThreadBuffer*>(threadBufferCache[0].buffer);
+    }
+
+    auto cached = std::find_if(threadBufferCache.begin() + 1, threadBufferCache.end(),
+                               [this](const ThreadBufferCacheEntry& entry) { return entry.recorderId == id_; });
+    ThreadBuffer* buffer = nullptr;
+    if (cached != threadBufferCache.end()) {
+        buffer = static_cast<ThreadBuffer*>(cached->buffer);
+    } else {
+        --cached;
+        const std::thread::id self = std::this_thread::get_id();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& existing : buffers_) {
+            if (existing->owner == self) {
+                buffer = existing.get();
+                break;
+            }
+        }
+        if (buffer == nullptr) {
+            buffers_.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers_.back().get();
+            buffer->owner = self;
+            buffer->threadIndex = static_cast<std::uint32_t>(buffers_.size());
+            buffer->events.reserve(4096);
+        }
+    }
+
+    std::rotate(threadBufferCache.begin(), cached, cached + 1);
+    threadBufferCache[0] = ThreadBufferCacheEntry{id_, buffer};
+    return *buffer;
+}
+
+std::size_t TraceRecorder::eventCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t count = 0;
+    for (const auto& buffer : buffers_) {
+        count += buffer->events.size();
+    }
+    return count;
+}
+
+void TraceRecorder::writeChromeTrace(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"reelocator\"}}";
+
+    for (const auto& buffer : buffers_) {
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadIndex
+            << ",\"args\":{\"name\":\"worker-" << buffer->threadIndex << "\"}}";
+
+        for (const Event& event : buffer->events) {
+            out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"reelocator\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << buffer->threadIndex << ",\"ts\":";
+            writeMicroseconds(out, event.startNanoseconds);
+            out << ",\"dur\":";
+            writeMicroseconds(out, event.durationNanoseconds);
+            if (event.hasCount) {
+                out << ",\"args\":{\"count\":" << event.count << "}";
+            }
+            out << "}";
+        }
+    }
+
+    out << "\n]}\n";
+}
+
+void TraceRecorder::writeChromeTrace(const fs::path& outputPath) const {
+    std::ofstream out(outputPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open trace output path: " + outputPath.string());
+    }
+    writeChromeTrace(out);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Collects complete ("X") spans into per-thread buffers and writes them in the
+// Chrome trace-event JSON format, which Perfetto and chrome://tracing both load.
+// A thread only takes the recorder lock the first time it records a span, and
+// keeps one buffer per recorder even when it alternates between recorders.
+class TraceRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    void record(const char* name, Clock::time_point start, Clock::time_point end);
+    // Also attaches `count` to the span as args.count, for spans that cover
+    // many items, such as a whole directory walk.
+    void record(const char* name, Clock::time_point start, Clock::time_point end, std::uint64_t count);
+
+    // These read the buffers without synchronising with record(), so call
+    // them only once every span has finished, e.g. after the run returned.
+    std::size_t eventCount() const;
+    void writeChromeTrace(std::ostream& out) const;
+    void writeChromeTrace(const fs::path& outputPath) const;
+
+private:
+    struct Event {
+        const char* name;
+        std::int64_t startNanoseconds;
+        std::int64_t durationNanoseconds;
+        std::uint64_t count;
+        bool hasCount;
+    };
+
+    struct ThreadBuffer {
+        std::thread::id owner;
+        std::uint32_t threadIndex;
+        std::vector<Event> events;
+    };
+
+    ThreadBuffer& threadBuffer();
+
+    const std::uint64_t id_;
+    const Clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+// Records one span for its lifetime. A null recorder makes this a single
+// branch on construction and destruction.
+class TraceSpan {
+public:
+    TraceSpan(TraceRecorder* recorder, const char* name) noexcept : recorder_(recorder), name_(name) {
+        if (recorder_ != nullptr) {
+            start_ = TraceRecorder::Clock::now();
+        }
+    }
+
+    ~TraceSpan() {
+        if (recorder_ == nullptr) {
+            return;
+        }
+        if (hasCount_) {
+            recorder_->record(name_, start_, TraceRecorder::Clock::now(), count_);
+        } else {
+            recorder_->record(name_, start_, TraceRecorder::Clock::now());
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // Number of items the span covered, written as args.count.
+    void setCount(std::uint64_t count) noexcept {
+        count_ = count;
+        hasCount_ = true;
+    }
+
+private:
+    TraceRecorder* recorder_;
+    const char* name_;
+    TraceRecorder::Clock::time_point start_{};
+    std::uint64_t count_ = 0;
+    bool hasCount_ = false;
+};
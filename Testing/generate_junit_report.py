@@ -17,6 +17,9 @@ This tool parses JUnit XML files, aggregates results, and renders a styled HTML
   -- Interactive filtering and search for failures
  -- CI-friendly exit codes
  -- Produces a single self-contained HTML file
+ -- Optional benchmark JSON (reelocator_bench / reelocator_e2e_bench) compared
+    against a baseline, with trend sparklines, regression badges and a
+    --max-slowdown gate
  
 | Option             | Required | Description                                 |
 | ------------------ | -------- | ------------------------------------------- |
@@ -28,6 +31,12 @@ This tool parses JUnit XML files, aggregates results, and renders a styled HTML
 | `--tag`            | No         | Version or tag label (default: `v1.0.0`)    |
 | `--sha`            | No         | Commit SHA shown in report                  |
 | `--fail-exit-code` | No         | Exit with code `1` if failures/errors exist |
+| `--bench`          | No         | Benchmark JSON files to report              |
+| `--baseline`       | No         | Benchmark JSON to compare against           |
+| `--history`        | No         | JSON-lines history for trends and baseline  |
+| `--update-history` | No         | Append this run's results to `--history`    |
+| `--baseline-window`| No         | History runs whose median is the baseline   |
+| `--max-slowdown`   | No         | Exit `3` if any benchmark slows by > PCT %  |
  
  Output
   -- HTML report with:
@@ -39,9 +48,11 @@ This tool parses JUnit XML files, aggregates results, and renders a styled HTML
     ++ 0 → success
     1 → failures present (--fail-exit-code)
     2 → fatal error (IO, template, parsing)
+    3 → benchmark regression beyond --max-slowdown
 """
 
 import argparse
+import json
 import os
 import sys
 import xml.etree.ElementTree as ET
@@ -265,12 +276,166 @@ def sort_key(case):
         case.get("status") or "",
     )
 
+# Slowdowns within this band are shown as OK when --max-slowdown is not given.
+DEFAULT_BADGE_THRESHOLD_PCT = 10.0
+
+# Picks the headline metric of one benchmark entry. Microbenchmarks report
+# ns_per_op (lower is better); end-to-end runs report files_per_second
+# (higher is better). Returns None for entries without a known metric.
+def bench_metric(entry):
+    if isinstance(entry.get("files_per_second"), dict):
+        return ("files_per_second", parse_float(entry["files_per_second"].get("p50")), "files/s", True)
+    if isinstance(entry.get("ns_per_op"), dict):
+        return ("ns_per_op", parse_float(entry["ns_per_op"].get("p50")), "ns/op", False)
+    if entry.get("completed") and entry.get("heap_bytes_per_file") is not None:
+        return ("heap_bytes_per_file", parse_float(entry["heap_bytes_per_file"]), "B/file", False)
+    return None
+
+# Loads benchmark JSON files into {name: result dict}.
+def parse_bench_files(paths):
+    results = {}
+    warnings = []
+    for path in paths:
+        try:
+            with open(path, "r", encoding="utf-8") as f:
+                data = json.load(f)
+        except Exception as e:
+            warnings.append("Could not parse benchmark file {}: {}".format(os.path.basename(path), e))
+            continue
+
+        for entry in data.get("benchmarks", []):
+            name = entry.get("name")
+            metric = bench_metric(entry)
+            if not name or metric is None:
+                continue
+            key, value, unit, higher_is_better = metric
+            results[name] = {
+                "name": name,
+                "metric": key,
+                "value": value,
+                "unit": unit,
+                "higher_is_better": higher_is_better,
+                "allocations": entry.get("allocations_per_op"),
+                "source_file": os.path.basename(path),
+            }
+    return results, warnings
+
+# Reads the JSON-lines history; each line is {"sha", "tag", "generated", "results": {name: value}}.
+def load_history(path):
+    if not path or not os.path.exists(path):
+        return []
+    history = []
+    with open(path, "r", encoding="utf-8") as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                history.append(json.loads(line))
+            except ValueError:
+                continue
+    return history
+
+def append_history(path, bench_results, sha, tag, generated):
+    entry = {
+        "sha": sha,
+        "tag": tag,
+        "generated": generated,
+        "results": {name: r["value"] for name, r in sorted(bench_results.items())},
+    }
+    out_dir = os.path.dirname(os.path.abspath(path))
+    if out_dir and not os.path.isdir(out_dir):
+        os.makedirs(out_dir, exist_ok=True)
+    with open(path, "a", encoding="utf-8", newline="\n") as f:
+        f.write(json.dumps(entry, sort_keys=True) + "\n")
+
+# Baseline per benchmark: an explicit baseline file wins; otherwise the median
+# of the last `window` history runs, which smooths out one noisy CI run.
+def compute_baseline(baseline_results, history, window):
+    if baseline_results:
+        return {name: r["value"] for name, r in baseline_results.items()}
+
+    values = {}
+    for entry in history[-window:] if window > 0 else []:
+        for name, value in (entry.get("results") or {}).items():
+            values.setdefault(name, []).append(parse_float(value))
+
+    baseline = {}
+    for name, series in values.items():
+        series.sort()
+        mid = len(series) // 2
+        baseline[name] = series[mid] if len(series) % 2 else (series[mid - 1] + series[mid]) / 2.0
+    return baseline
+
+# Relative slowdown in percent; positive means worse whatever the metric's direction.
+def slowdown_pct(current, baseline, higher_is_better):
+    if baseline <= 0 or current <= 0:
+        return None
+    ratio = baseline / current if higher_is_better else current / baseline
+    return (ratio - 1.0) * 100.0
+
+# Inline SVG polyline of the metric over the history plus the current run.
+def sparkline_svg(series, width=120, height=28):
+    points = [v for v in series if v is not None]
+    if len(points) < 2:
+        return ""
+    low, high = min(points), max(points)
+    span = (high - low) or 1.0
+    step = float(width - 4) / float(len(points) - 1)
+    coords = " ".join(
+        "{:.1f},{:.1f}".format(2 + i * step, height - 2 - (v - low) / span * (height - 4))
+        for i, v in enumerate(points)
+    )
+    last_x, last_y = coords.split(" ")[-1].split(",")
+    return (
+        '<svg class="spark" width="{w}" height="{h}" viewBox="0 0 {w} {h}" role="img">'
+        '<polyline points="{c}" /><circle cx="{x}" cy="{y}" r="2.5" /></svg>'
+    ).format(w=width, h=height, c=coords, x=last_x, y=last_y)
+
+# Builds the rows of the performance card and the list of gated regressions.
+def compute_bench_rows(bench_results, baseline, history, history_limit, max_slowdown):
+    threshold = max_slowdown if max_slowdown is not None else DEFAULT_BADGE_THRESHOLD_PCT
+    rows = []
+    regressions = []
+    for name in sorted(bench_results):
+        r = bench_results[name]
+        base = baseline.get(name)
+        change = slowdown_pct(r["value"], base, r["higher_is_better"]) if base is not None else None
+
+        if change is None:
+            status, dot = "NEW", "warn"
+        elif change > threshold:
+            status, dot = "REGRESSED", "bad"
+            if max_slowdown is not None:
+                regressions.append("{}: {:+.1f}% ({:.4g} {} vs baseline {:.4g})".format(
+                    name, change, r["value"], r["unit"], base))
+        elif change < -threshold:
+            status, dot = "IMPROVED", "good"
+        else:
+            status, dot = "OK", "good"
+
+        series = [parse_float((h.get("results") or {}).get(name), None) for h in history[-history_limit:]]
+        series.append(r["value"])
+
+        rows.append({
+            "name": name,
+            "unit": r["unit"],
+            "current": "{:.4g}".format(r["value"]),
+            "baseline": "{:.4g}".format(base) if base is not None else "—",
+            "change": "{:+.1f}%".format(change) if change is not None else "—",
+            "status": status,
+            "dot": dot,
+            "sparkline": sparkline_svg(series),
+        })
+    return rows, regressions
+
 # Renders the final HTML report using Jinja2.
-def render_html_report(summary, cases, parse_warnings, base_css, template_text, inline_js, tag, sha):
+def render_html_report(summary, cases, parse_warnings, base_css, template_text, inline_js, tag, sha,
+                       bench_rows=None, regressions=None, max_slowdown=None, generated=None):
     if Environment is None:
         raise RuntimeError("Jinja2 is required. Install with: pip install jinja2")
 
-    now = datetime.now(timezone.utc).strftime("%Y-%m-%d %H:%M:%SZ")
+    now = generated or datetime.now(timezone.utc).strftime("%Y-%m-%d %H:%M:%SZ")
 
     bad_cases = [c for c in cases if c["status"] in ("failure", "error")]
     bad_cases.sort(key=sort_key)
@@ -313,6 +478,9 @@ def render_html_report(summary, cases, parse_warnings, base_css, template_text,
         warnings=parse_warnings,
         bad_cases=bad_cases,
         suite_rows=suite_rows,
+        bench_rows=bench_rows or [],
+        regressions=regressions or [],
+        max_slowdown=max_slowdown,
     )
 
 
@@ -388,6 +556,48 @@ def build_arg_parser():
         help="Optional path to a JavaScript file to inline into the HTML report. "
              "If omitted, uses the built-in JS."
     )
+    p.add_argument(
+        "--bench",
+        nargs="+",
+        default=[],
+        help="Benchmark JSON files from reelocator_bench / reelocator_e2e_bench"
+    )
+    p.add_argument(
+        "--baseline",
+        nargs="+",
+        default=[],
+        help="Benchmark JSON files to compare against. If omitted, the median of "
+             "recent --history runs is used."
+    )
+    p.add_argument(
+        "--history",
+        default=None,
+        help="JSON-lines benchmark history used for trend charts and as the default baseline"
+    )
+    p.add_argument(
+        "--update-history",
+        action="store_true",
+        help="Append this run's benchmark results to --history"
+    )
+    p.add_argument(
+        "--baseline-window",
+        type=int,
+        default=5,
+        help="Number of most recent history runs whose median forms the baseline"
+    )
+    p.add_argument(
+        "--history-limit",
+        type=int,
+        default=30,
+        help="Number of history runs drawn in trend charts"
+    )
+    p.add_argument(
+        "--max-slowdown",
+        type=float,
+        default=None,
+        metavar="PCT",
+        help="Exit with code 3 if any benchmark is more than PCT percent slower than its baseline"
+    )
 
     return p
 
@@ -415,6 +625,17 @@ def main(argv):
         warnings.extend(w)
     
     summary = compute_summary(all_cases)
+
+    # Benchmarks: compare against the baseline before this run joins the history.
+    bench_results, w = parse_bench_files(args.bench)
+    warnings.extend(w)
+    baseline_results, w = parse_bench_files(args.baseline)
+    warnings.extend(w)
+    history = load_history(args.history)
+    baseline = compute_baseline(baseline_results, history, args.baseline_window)
+    bench_rows, regressions = compute_bench_rows(
+        bench_results, baseline, history, args.history_limit, args.max_slowdown)
+    generated = datetime.now(timezone.utc).strftime("%Y-%m-%d %H:%M:%SZ")
     
     template_text = load_template_text(args.template)
     if template_text is None:
@@ -435,6 +656,10 @@ def main(argv):
         inline_js=inline_js,
         tag=args.tag,
         sha=args.sha,
+        bench_rows=bench_rows,
+        regressions=regressions,
+        max_slowdown=args.max_slowdown,
+        generated=generated,
     )
 
     try:
@@ -443,10 +668,24 @@ def main(argv):
         print("ERROR: could not write output HTML {}: {}".format(args.out, e), file=sys.stderr)
         return 2
 
+    if args.history and args.update_history and bench_results:
+        try:
+            append_history(args.history, bench_results, args.sha, args.tag, generated)
+        except Exception as e:
+            print("ERROR: could not update history {}: {}".format(args.history, e), file=sys.stderr)
+            return 2
+
     #fail the step if overall FAIL
     if args.fail_exit_code and summary["overall"] == "FAIL":
         return 1
 
+    # fail the step on performance regressions beyond the threshold
+    if regressions:
+        print("Performance regressions beyond {:.1f}%:".format(args.max_slowdown), file=sys.stderr)
+        for r in regressions:
+            print("  " + r, file=sys.stderr)
+        return 3
+
     return 0
 
 
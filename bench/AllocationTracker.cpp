@@ -0,0 +1,95 @@
+#include "AllocationTracker.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions for the benchmark and test
+// executables so they can count allocations per operation and track the
+// live heap.
+
+namespace {
+
+std::atomic<std::uint64_t> allocationCount{0};
+std::atomic<std::uint64_t> allocatedBytes{0};
+std::atomic<std::uint64_t> liveBytes{0};
+std::atomic<std::uint64_t> peakLiveBytes{0};
+
+// Trivially constructed, so touching it from operator new never allocates.
+thread_local AllocationSnapshot threadAllocations;
+
+// Each block starts with its requested size so unsized delete can subtract
+// it from the live total; the header keeps malloc's alignment.
+constexpr std::size_t kHeaderSize = alignof(std::max_align_t);
+
+void* countedAllocate(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    ++threadAllocations.count;
+    threadAllocations.bytes += size;
+
+    void* block = std::malloc(size + kHeaderSize);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<std::size_t*>(block) = size;
+
+    const std::uint64_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    std::uint64_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return static_cast<char*>(block) + kHeaderSize;
+}
+
+void countedFree(void* memory) noexcept {
+    if (memory == nullptr) {
+        return;
+    }
+    void* block = static_cast<char*>(memory) - kHeaderSize;
+    liveBytes.fetch_sub(*static_cast<std::size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+}  // namespace
+
+AllocationSnapshot allocationSnapshot() noexcept {
+    return AllocationSnapshot{allocationCount.load(std::memory_order_relaxed),
+                              allocatedBytes.load(std::memory_order_relaxed)};
+}
+
+AllocationSnapshot threadAllocationSnapshot() noexcept {
+    return threadAllocations;
+}
+
+HeapUsage heapUsage() noexcept {
+    return HeapUsage{liveBytes.load(std::memory_order_relaxed), peakLiveBytes.load(std::memory_order_relaxed)};
+}
+
+void resetPeakHeap() noexcept {
+    peakLiveBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size) {
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    countedFree(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    countedFree(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    countedFree(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    countedFree(memory);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+struct AllocationSnapshot {
+    std::uint64_t count = 0;
+    std::uint64_t bytes = 0;
+};
+
+// Defined in AllocationTracker.cpp, which replaces the global operator new
+// and delete. Only test and benchmark executables link it.
+
+// Totals since process start, over all threads.
+AllocationSnapshot allocationSnapshot() noexcept;
+
+// Totals made by the calling thread since it started.
+AllocationSnapshot threadAllocationSnapshot() noexcept;
+
+struct HeapUsage {
+    // Bytes requested through operator new and not yet deleted.
+    std::uint64_t live = 0;
+    // Highest `live` since process start or the last resetPeakHeap().
+    std::uint64_t peak = 0;
+};
+
+HeapUsage heapUsage() noexcept;
+void resetPeakHeap() noexcept;
+
+// Counts the allocations the constructing thread makes while the scope is
+// alive, so assertions are not disturbed by tests running on other threads.
+class AllocationScope {
+public:
+    AllocationScope() noexcept : start_(threadAllocationSnapshot()) {}
+
+    AllocationSnapshot allocations() const noexcept {
+        const AllocationSnapshot now = threadAllocationSnapshot();
+        return AllocationSnapshot{now.count - start_.count, now.bytes - start_.bytes};
+    }
+
+private:
+    AllocationSnapshot start_;
+};
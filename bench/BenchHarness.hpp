@@ -0,0 +1,149 @@
+#pragma once
+
+#include "AllocationTracker.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Keeps the optimizer from discarding a benchmarked result.
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct BenchOptions {
+    std::chrono::milliseconds warmup{50};
+    std::chrono::microseconds minSampleTime{2000};
+    std::size_t samples = 15;
+    std::string filter;
+};
+
+struct BenchResult {
+    std::string name;
+    std::uint64_t iterationsPerSample = 0;
+    std::vector<double> nanosecondsPerOp;
+    double allocationsPerOp = 0.0;
+    double bytesPerOp = 0.0;
+
+    double percentile(double fraction) const {
+        std::vector<double> sorted = nanosecondsPerOp;
+        std::sort(sorted.begin(), sorted.end());
+        const double rank = fraction * static_cast<double>(sorted.size() - 1);
+        const std::size_t lower = static_cast<std::size_t>(rank);
+        const std::size_t upper = std::min(lower + 1, sorted.size() - 1);
+        return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - static_cast<double>(lower));
+    }
+
+    double mean() const {
+        double total = 0.0;
+        for (const double value : nanosecondsPerOp) {
+            total += value;
+        }
+        return total / static_cast<double>(nanosecondsPerOp.size());
+    }
+};
+
+// Runs each benchmark body through warm-up, calibration and a fixed number of
+// timed samples. A sample repeats the body until it lasts at least
+// minSampleTime, so fast operations are not dominated by clock overhead.
+class BenchRunner {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit BenchRunner(BenchOptions options) : options_(std::move(options)) {}
+
+    bool selected(const std::string& name) const {
+        return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+    }
+
+    template <typename Body>
+    void run(const std::string& name, Body&& body) {
+        if (!selected(name)) {
+            return;
+        }
+
+        const Clock::time_point warmupEnd = Clock::now() + options_.warmup;
+        do {
+            body();
+        } while (Clock::now() < warmupEnd);
+
+        std::uint64_t iterations = 1;
+        while (true) {
+            const Clock::time_point start = Clock::now();
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                body();
+            }
+            if (Clock::now() - start >= options_.minSampleTime || iterations >= (std::uint64_t{1} << 24)) {
+                break;
+            }
+            iterations *= 2;
+        }
+
+        BenchResult result;
+        result.name = name;
+        result.iterationsPerSample = iterations;
+        result.nanosecondsPerOp.reserve(options_.samples);
+
+        const AllocationSnapshot before = allocationSnapshot();
+        for (std::size_t sample = 0; sample < options_.samples; ++sample) {
+            const Clock::time_point start = Clock::now();
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                body();
+            }
+            const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+            result.nanosecondsPerOp.push_back(elapsed.count() / static_cast<double>(iterations));
+        }
+        const AllocationSnapshot after = allocationSnapshot();
+
+        // The sample vector was reserved up front, so every counted allocation
+        // came from the body.
+        const double operations = static_cast<double>(iterations) * static_cast<double>(options_.samples);
+        result.allocationsPerOp = static_cast<double>(after.count - before.count) / operations;
+        result.bytesPerOp = static_cast<double>(after.bytes - before.bytes) / operations;
+        results_.push_back(std::move(result));
+    }
+
+    const std::vector<BenchResult>& results() const noexcept { return results_; }
+
+    void writeSummary(std::ostream& out) const {
+        out << std::left << std::setw(52) << "benchmark" << std::right << std::setw(12) << "p50 ns" << std::setw(12)
+            << "p99 ns" << std::setw(12) << "allocs/op" << "\n";
+        for (const BenchResult& result : results_) {
+            out << std::left << std::setw(52) << result.name << std::right << std::fixed << std::setprecision(1)
+                << std::setw(12) << result.percentile(0.50) << std::setw(12) << result.percentile(0.99)
+                << std::setprecision(2) << std::setw(12) << result.allocationsPerOp << "\n";
+        }
+    }
+
+    void writeJson(std::ostream& out) const {
+        out << "{\"benchmarks\":[";
+        for (std::size_t i = 0; i < results_.size(); ++i) {
+            const BenchResult& result = results_[i];
+            out << (i == 0 ? "" : ",") << "\n  {\"name\":\"" << result.name << "\""
+                << ",\"iterations_per_sample\":" << result.iterationsPerSample
+                << ",\"samples\":" << result.nanosecondsPerOp.size() << std::setprecision(6)
+                << ",\"ns_per_op\":{\"min\":" << result.percentile(0.0) << ",\"p50\":" << result.percentile(0.50)
+                << ",\"p90\":" << result.percentile(0.90) << ",\"p99\":" << result.percentile(0.99)
+                << ",\"max\":" << result.percentile(1.0) << ",\"mean\":" << result.mean() << "}"
+                << ",\"allocations_per_op\":" << result.allocationsPerOp
+                << ",\"bytes_per_op\":" << result.bytesPerOp << "}";
+        }
+        out << "\n]}\n";
+    }
+
+private:
+    BenchOptions options_;
+    std::vector<BenchResult> results_;
+};
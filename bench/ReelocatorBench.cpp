@@ -0,0 +1,169 @@
+#include "BenchHarness.hpp"
+
+#include "ReelocatorCore.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct BenchCliOptions {
+    BenchOptions bench;
+    fs::path jsonOutputPath;
+    std::size_t maxChain = 100000;
+};
+
+std::string requireValue(int argc, char* argv[], int& i) {
+    const std::string flag = argv[i];
+    if (i + 1 >= argc) {
+        throw std::invalid_argument(flag + " requires a value");
+    }
+    return argv[++i];
+}
+
+BenchCliOptions parseBenchOptions(int argc, char* argv[]) {
+    BenchCliOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--json-out") {
+            options.jsonOutputPath = requireValue(argc, argv, i);
+        } else if (arg == "--filter") {
+            options.bench.filter = requireValue(argc, argv, i);
+        } else if (arg == "--samples") {
+            options.bench.samples = std::stoul(requireValue(argc, argv, i));
+            if (options.bench.samples == 0) {
+                throw std::invalid_argument("--samples must be positive");
+            }
+        } else if (arg == "--warmup-ms") {
+            options.bench.warmup = std::chrono::milliseconds(std::stoul(requireValue(argc, argv, i)));
+        } else if (arg == "--max-chain") {
+            options.maxChain = std::stoul(requireValue(argc, argv, i));
+        } else {
+            throw std::invalid_argument("unknown argument: " + arg);
+        }
+    }
+    return options;
+}
+
+fs::path makeScratchDir() {
+    const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    const fs::path dir = fs::temp_directory_path() / ("reelocator-bench-" + std::to_string(stamp));
+    fs::create_directories(dir);
+    return dir;
+}
+
+// Creates IMG.jpg, IMG_1.jpg, ... IMG_<length-1>.jpg so the next unique name
+// for IMG.jpg is found after `length` collisions.
+void createCollisionChain(const fs::path& dir, std::size_t length) {
+    fs::create_directories(dir);
+    for (std::size_t i = 0; i < length; ++i) {
+        const std::string name = i == 0 ? "IMG.jpg" : "IMG_" + std::to_string(i) + ".jpg";
+        std::ofstream(dir / name).put('x');
+    }
+}
+
+void benchToLower(BenchRunner& runner) {
+    const std::vector<std::pair<std::string, std::string>> inputs = {
+        {"short_upper", "IMG_0001.JPG"},
+        {"short_lower", "img_0001.jpg"},
+        {"mixed_case", "Holiday_Beach_Sunset.JpEg"},
+        {"long_name", std::string(120, 'A') + "_" + std::string(120, 'b') + ".MOV"},
+    };
+    for (const auto& input : inputs) {
+        runner.run("toLower/" + input.first, [&input] { doNotOptimize(toLower(input.second)); });
+    }
+}
+
+void benchIsTargetFile(BenchRunner& runner) {
+    struct Input {
+        const char* label;
+        fs::path path;
+        MediaType mediaType;
+    };
+    const std::vector<Input> inputs = {
+        {"image_lower_ext", "/cards/DCIM/100CANON/img_0001.jpg", MediaType::Images},
+        {"image_upper_ext", "/cards/DCIM/100CANON/IMG_0001.JPG", MediaType::Images},
+        {"image_mixed_ext", "/cards/DCIM/100CANON/IMG_0001.JpEg", MediaType::Images},
+        {"video_mixed_ext", "/cards/DCIM/100CANON/MVI_0001.MoV", MediaType::Videos},
+        {"wrong_media", "/cards/DCIM/100CANON/MVI_0001.MP4", MediaType::Images},
+        {"non_media", "/cards/DCIM/100CANON/notes.txt", MediaType::Images},
+        {"no_extension", "/cards/DCIM/100CANON/README", MediaType::Images},
+        {"long_name", fs::path("/cards/DCIM") / (std::string(240, 'x') + ".JPG"), MediaType::Images},
+    };
+    for (const Input& input : inputs) {
+        runner.run(std::string("isTargetFile/") + input.label,
+                   [&input] { doNotOptimize(isTargetFile(input.path, input.mediaType)); });
+    }
+}
+
+void benchUniqueDestinationPath(BenchRunner& runner, const fs::path& scratch, std::size_t maxChain) {
+    for (std::size_t length = 1; length <= maxChain; length *= 10) {
+        const std::string suffix = "/chain_" + std::to_string(length);
+        const bool probes = runner.selected("getUniqueDestinationPath" + suffix);
+        const bool index = runner.selected("DestinationIndex::reserveUniquePath" + suffix);
+        if (!probes && !index) {
+            continue;
+        }
+
+        const fs::path dir = scratch / ("chain_" + std::to_string(length));
+        createCollisionChain(dir, length);
+        const fs::path filename = "IMG.jpg";
+
+        runner.run("getUniqueDestinationPath" + suffix,
+                   [&] { doNotOptimize(getUniqueDestinationPath(dir, filename)); });
+
+        DestinationIndex destinationIndex(dir);
+        destinationIndex.load(defaultFileSystem());
+        runner.run("DestinationIndex::reserveUniquePath" + suffix, [&] {
+            const fs::path reserved = destinationIndex.reserveUniquePath(filename);
+            destinationIndex.release(reserved.filename());
+            doNotOptimize(reserved);
+        });
+
+        fs::remove_all(dir);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchCliOptions options;
+    try {
+        options = parseBenchOptions(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << "Argument error: " << ex.what() << "\n";
+        return 2;
+    }
+
+    BenchRunner runner(options.bench);
+    const fs::path scratch = makeScratchDir();
+    try {
+        benchToLower(runner);
+        benchIsTargetFile(runner);
+        benchUniqueDestinationPath(runner, scratch, options.maxChain);
+    } catch (const std::exception& ex) {
+        std::cerr << "Benchmark error: " << ex.what() << "\n";
+        fs::remove_all(scratch);
+        return 1;
+    }
+    fs::remove_all(scratch);
+
+    runner.writeSummary(std::cout);
+    if (!options.jsonOutputPath.empty()) {
+        std::ofstream out(options.jsonOutputPath);
+        runner.writeJson(out);
+        if (!out) {
+            std::cerr << "Failed to write " << options.jsonOutputPath << "\n";
+            return 1;
+        }
+        std::cout << "Benchmark JSON written to " << options.jsonOutputPath << "\n";
+    }
+    return 0;
+}
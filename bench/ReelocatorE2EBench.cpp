@@ -0,0 +1,263 @@
+#include "ReelocatorCore.hpp"
+#include "ReelocatorFaultInjection.hpp"
+#include "TreeGenerator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define REELOCATOR_HAVE_RUSAGE 1
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct E2EOptions {
+    fs::path sourceRoot;
+    fs::path destinationRoot;
+    std::string label = "default";
+    std::string commit;
+    std::size_t repetitions = 3;
+    std::size_t threads = 0;
+    TreeSpec tree;
+    // Fraction of renames failing with EXDEV and of copies failing with EIO,
+    // to measure the fallback and skip paths under load.
+    double faultRate = 0.0;
+    std::chrono::microseconds faultLatency{0};
+    fs::path jsonOutputPath;
+};
+
+struct RunResult {
+    double seconds = 0.0;
+    std::uint64_t moved = 0;
+    std::uint64_t skipped = 0;
+    std::uint64_t renamed = 0;
+    std::uint64_t copied = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t fileSystemCalls = 0;
+    std::uint64_t faultsInjected = 0;
+};
+
+std::string requireValue(int argc, char* argv[], int& i) {
+    const std::string flag = argv[i];
+    if (i + 1 >= argc) {
+        throw std::invalid_argument(flag + " requires a value");
+    }
+    return argv[++i];
+}
+
+E2EOptions parseE2EOptions(int argc, char* argv[]) {
+    E2EOptions options;
+    options.tree.files = 100000;
+    options.tree.content = GeneratedContent::Sparse;
+    options.tree.otherRate = 0.0;
+    options.tree.videoRate = 0.0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--source-root") {
+            options.sourceRoot = requireValue(argc, argv, i);
+        } else if (arg == "--destination-root") {
+            options.destinationRoot = requireValue(argc, argv, i);
+        } else if (arg == "--label") {
+            options.label = requireValue(argc, argv, i);
+        } else if (arg == "--commit") {
+            options.commit = requireValue(argc, argv, i);
+        } else if (arg == "--repetitions") {
+            options.repetitions = std::stoul(requireValue(argc, argv, i));
+            if (options.repetitions == 0) {
+                throw std::invalid_argument("--repetitions must be positive");
+            }
+        } else if (arg == "--threads") {
+            options.threads = std::stoul(requireValue(argc, argv, i));
+        } else if (arg == "--files") {
+            options.tree.files = std::stoull(requireValue(argc, argv, i));
+        } else if (arg == "--seed") {
+            options.tree.seed = std::stoull(requireValue(argc, argv, i));
+        } else if (arg == "--collision-rate") {
+            options.tree.collisionRate = std::stod(requireValue(argc, argv, i));
+        } else if (arg == "--sparse-size") {
+            options.tree.sparseSize = std::stoull(requireValue(argc, argv, i));
+        } else if (arg == "--fault-rate") {
+            options.faultRate = std::stod(requireValue(argc, argv, i));
+            if (options.faultRate < 0.0 || options.faultRate > 1.0) {
+                throw std::invalid_argument("--fault-rate must be between 0 and 1");
+            }
+        } else if (arg == "--fault-latency-us") {
+            options.faultLatency = std::chrono::microseconds(std::stoul(requireValue(argc, argv, i)));
+        } else if (arg == "--json-out") {
+            options.jsonOutputPath = requireValue(argc, argv, i);
+        } else {
+            throw std::invalid_argument("unknown argument: " + arg);
+        }
+    }
+
+    if (options.sourceRoot.empty()) {
+        throw std::invalid_argument("--source-root is required");
+    }
+    if (options.destinationRoot.empty()) {
+        options.destinationRoot = options.sourceRoot;
+    }
+    return options;
+}
+
+std::uint64_t peakRssKilobytes() {
+#ifdef REELOCATOR_HAVE_RUSAGE
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<std::uint64_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<std::uint64_t>(usage.ru_maxrss);
+#endif
+#else
+    return 0;
+#endif
+}
+
+// Generates a fresh tree (untimed), then times one plan + execute over it.
+RunResult runOnce(const E2EOptions& options, std::size_t repetition) {
+    const std::string runName = "reelocator-e2e-" + std::to_string(repetition);
+    const fs::path source = options.sourceRoot / runName;
+    const fs::path destination = options.destinationRoot / (runName + "-out");
+    fs::remove_all(source);
+    fs::remove_all(destination);
+    generateTree(source, options.tree);
+
+    FaultInjectingFileSystem faultyFileSystem(options.tree.seed);
+    faultyFileSystem.setRule(FsOperation::Rename,
+                             FaultRule{options.faultRate, std::errc::cross_device_link, options.faultLatency});
+    faultyFileSystem.setRule(FsOperation::CopyFile,
+                             FaultRule{options.faultRate, std::errc::io_error, options.faultLatency});
+    const bool injectFaults = options.faultRate > 0.0 || options.faultLatency.count() > 0;
+
+    std::atomic<std::uint64_t> renamed{0};
+    std::atomic<std::uint64_t> copied{0};
+    RelocatorOptions relocatorOptions;
+    relocatorOptions.workerThreads = options.threads;
+    relocatorOptions.fileSystem = injectFaults ? &faultyFileSystem : nullptr;
+    relocatorOptions.onEvent = [&](const RelocationEvent& event) {
+        if (event.outcome == MoveOutcome::Renamed) {
+            renamed.fetch_add(1, std::memory_order_relaxed);
+        } else if (event.outcome == MoveOutcome::Copied) {
+            copied.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+    Relocator relocator(relocatorOptions);
+    relocator.fileSystem().counters().reset();
+
+    const auto start = std::chrono::steady_clock::now();
+    const RelocationSummary summary = relocator.run(RelocationJob{MediaType::Images, source, destination});
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    RunResult result;
+    result.seconds = elapsed.count();
+    result.moved = summary.moved;
+    result.skipped = summary.skipped;
+    result.renamed = renamed.load();
+    result.copied = copied.load();
+    result.bytes = summary.bytesMoved;
+    result.fileSystemCalls = relocator.fileSystem().counters().total();
+    result.faultsInjected = faultyFileSystem.injectedTotal();
+
+    fs::remove_all(source);
+    fs::remove_all(destination);
+    return result;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (const char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            escaped += '\\';
+        }
+        escaped += ch;
+    }
+    return escaped;
+}
+
+void writeStats(std::ostream& out, const char* name, std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    out << "\"" << name << "\":{\"min\":" << values.front() << ",\"p50\":" << values[values.size() / 2]
+        << ",\"max\":" << values.back() << "}";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    E2EOptions options;
+    try {
+        options = parseE2EOptions(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << "Argument error: " << ex.what() << "\n";
+        return 2;
+    }
+
+    std::vector<RunResult> runs;
+    try {
+        for (std::size_t i = 0; i < options.repetitions; ++i) {
+            runs.push_back(runOnce(options, i));
+            const RunResult& run = runs.back();
+            std::cout << options.label << " run " << i + 1 << ": " << run.moved << " files in " << run.seconds
+                      << " s (" << run.renamed << " renamed, " << run.copied << " copied, " << run.skipped
+                      << " skipped)\n";
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Benchmark error: " << ex.what() << "\n";
+        return 1;
+    }
+
+    std::vector<double> seconds;
+    std::vector<double> filesPerSecond;
+    std::vector<double> megabytesPerSecond;
+    RunResult totals;
+    for (const RunResult& run : runs) {
+        seconds.push_back(run.seconds);
+        filesPerSecond.push_back(static_cast<double>(run.moved) / run.seconds);
+        megabytesPerSecond.push_back(static_cast<double>(run.bytes) / 1e6 / run.seconds);
+        totals.moved += run.moved;
+        totals.renamed += run.renamed;
+        totals.copied += run.copied;
+        totals.skipped += run.skipped;
+        totals.fileSystemCalls += run.fileSystemCalls;
+        totals.faultsInjected += run.faultsInjected;
+    }
+    const double callsPerFile =
+        totals.moved == 0 ? 0.0 : static_cast<double>(totals.fileSystemCalls) / static_cast<double>(totals.moved);
+
+    std::sort(filesPerSecond.begin(), filesPerSecond.end());
+    std::cout << options.label << ": " << filesPerSecond[filesPerSecond.size() / 2] << " files/s (median), "
+              << callsPerFile << " filesystem calls per file, peak RSS " << peakRssKilobytes() << " KiB\n";
+
+    if (!options.jsonOutputPath.empty()) {
+        std::ofstream out(options.jsonOutputPath);
+        out << "{\"context\":{\"commit\":\"" << jsonEscape(options.commit) << "\",\"files\":" << options.tree.files
+            << ",\"seed\":" << options.tree.seed << ",\"threads\":" << options.threads
+            << ",\"fault_rate\":" << options.faultRate << "},\n"
+            << "\"benchmarks\":[\n  {\"name\":\"e2e/" << jsonEscape(options.label) << "\",\"kind\":\"e2e\""
+            << ",\"repetitions\":" << runs.size() << ",";
+        writeStats(out, "seconds", seconds);
+        out << ",";
+        writeStats(out, "files_per_second", filesPerSecond);
+        out << ",";
+        writeStats(out, "mb_per_second", megabytesPerSecond);
+        out << ",\"fs_calls_per_file\":" << callsPerFile << ",\"renamed\":" << totals.renamed
+            << ",\"copied\":" << totals.copied << ",\"skipped\":" << totals.skipped
+            << ",\"faults_injected\":" << totals.faultsInjected
+            << ",\"peak_rss_kb\":" << peakRssKilobytes() << "}\n]}\n";
+        if (!out) {
+            std::cerr << "Failed to write " << options.jsonOutputPath << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,490 @@
+#include "AllocationTracker.hpp"
+
+#include "ReelocatorCore.hpp"
+#include "ReelocatorPathArena.hpp"
+#include "ReelocatorSpill.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define REELOCATOR_HAVE_FORK 1
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct MemoryOptions {
+    std::vector<std::uint64_t> entries = {1000000, 10000000, 50000000};
+    std::string mode;
+    double collisionRate = 0.01;
+    std::size_t threads = 0;
+    // Address-space cap per case, so an oversized case fails with bad_alloc
+    // instead of waking the OOM killer. 0 leaves it unlimited.
+    std::uint64_t memoryLimitMb = 0;
+    // Heap budget of the "spill" mode's arena and move store.
+    std::size_t spillBudgetMb = 16;
+    fs::path spillDirectory;
+    fs::path jsonOutputPath;
+};
+
+struct CaseResult {
+    bool completed = false;
+    char error[160] = {};
+    std::uint64_t entries = 0;
+    std::uint64_t planHeapPeak = 0;
+    std::uint64_t executeHeapPeak = 0;
+    std::uint64_t peakRssKb = 0;
+    double planSeconds = 0.0;
+    double executeSeconds = 0.0;
+    double sortSeconds = 0.0;
+};
+
+// Accepts every move without touching the disk, so the benchmark measures
+// only what the engine holds in memory.
+class NullFileSystem : public FileSystem {
+public:
+    using FileSystem::exists;
+    using FileSystem::remove;
+    using FileSystem::rename;
+
+    bool exists(const fs::path&, std::error_code& error) override {
+        error.clear();
+        return false;
+    }
+    void rename(const fs::path&, const fs::path&, std::error_code& error) override { error.clear(); }
+    void renameNoReplace(const fs::path&, const fs::path&, std::error_code& error) override { error.clear(); }
+    bool remove(const fs::path&, std::error_code& error) override {
+        error.clear();
+        return true;
+    }
+    fs::directory_iterator openDirectory(const fs::path&) override { return fs::directory_iterator(); }
+};
+
+std::uint64_t splitmix64(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Card-dump shaped entry: /ingest/card_<c>/DCIM/<1xx>MEDIA/<name>, with a
+// fraction of names drawn from the shared IMG_NNNN pool.
+fs::path syntheticSource(std::uint64_t index, double collisionRate) {
+    const std::uint64_t hash = splitmix64(index);
+    const bool shared = static_cast<double>(hash >> 11) * (1.0 / 9007199254740992.0) < collisionRate;
+    const auto card = static_cast<unsigned long long>(index / 100000);
+    const auto folder = static_cast<unsigned long long>(100 + index / 1000 % 100);
+    char buffer[96];
+    if (shared) {
+        std::snprintf(buffer, sizeof(buffer), "/ingest/card_%llu/DCIM/%lluMEDIA/IMG_%04llu.JPG", card, folder,
+                      static_cast<unsigned long long>(1 + hash % 9999));
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "/ingest/card_%llu/DCIM/%lluMEDIA/DSC_%llu.JPG", card, folder,
+                      static_cast<unsigned long long>(index));
+    }
+    return fs::path(buffer);
+}
+
+// The Relocator's own representation: a RelocationPlan of PlannedMoves plus
+// the destination index, executed on the worker pool.
+void runRelocatorMode(const MemoryOptions& options, std::uint64_t entries, CaseResult& result) {
+    NullFileSystem fileSystem;
+    RelocatorOptions relocatorOptions;
+    relocatorOptions.workerThreads = options.threads;
+    relocatorOptions.fileSystem = &fileSystem;
+    Relocator relocator(relocatorOptions);
+
+    const fs::path destination = "/library/photos";
+    resetPeakHeap();
+    const auto planStart = std::chrono::steady_clock::now();
+    RelocationPlan plan;
+    plan.jobId = 1;
+    plan.job = RelocationJob{MediaType::Images, "/ingest", destination};
+    plan.index = relocator.destinationIndexFor(destination);
+    DestinationIndex& index = *plan.index;
+    for (std::uint64_t i = 0; i < entries; ++i) {
+        fs::path source = syntheticSource(i, options.collisionRate);
+        fs::path target = index.reserveUniquePath(source.filename());
+        plan.moves.push_back(PlannedMove{std::move(source), std::move(target), 4096});
+    }
+    result.planSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - planStart).count();
+    result.planHeapPeak = heapUsage().peak;
+
+    resetPeakHeap();
+    const auto executeStart = std::chrono::steady_clock::now();
+    const RelocationSummary summary = relocator.execute(plan);
+    result.executeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - executeStart).count();
+    result.executeHeapPeak = heapUsage().peak;
+
+    if (summary.moved != entries) {
+        throw std::runtime_error("execute moved " + std::to_string(summary.moved) + " of " + std::to_string(entries));
+    }
+}
+
+// A planned move kept in a PathArena: each side as a directory id plus a
+// name, in 32 bytes.
+struct ArenaMove {
+    ArenaString sourceName;
+    ArenaString destinationName;
+    std::uint64_t size;
+    DirectoryId sourceDirectory;
+    DirectoryId destinationDirectory;
+};
+
+// Destination directory first, so a sorted plan is moved directory by
+// directory; then source directory, for locality on the reading side.
+std::uint64_t directoryKey(const ArenaMove& move) {
+    return static_cast<std::uint64_t>(move.destinationDirectory) << 32 | move.sourceDirectory;
+}
+
+ArenaString reserveArenaName(ArenaNameSet& taken, ArenaString name, PathView text,
+                             fs::path::string_type& candidate) {
+    const auto inserted = taken.insert(name);
+    if (inserted.second) {
+        return inserted.first;
+    }
+    const std::size_t dot = std::min(text.rfind('.'), text.size());
+    for (int counter = 1;; ++counter) {
+        candidate.assign(text.data(), dot);
+        candidate.push_back('_');
+        const std::string number = std::to_string(counter);
+        candidate.append(number.begin(), number.end());
+        candidate.append(text.data() + dot, text.size() - dot);
+        const auto numbered = taken.insert(PathView(candidate));
+        if (numbered.second) {
+            return numbered.first;
+        }
+    }
+}
+
+void groupByDirectory(std::vector<ArenaMove>&, const MemoryOptions&) {}
+
+// Threads besides the caller for --threads (0 = one per CPU).
+std::size_t helperThreads(std::size_t threads) {
+    const std::size_t total = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    return total - 1;
+}
+
+// External merge sort, with runs sorted and merged on a pool of --threads.
+void groupByDirectory(SpillVector<ArenaMove>& moves, const MemoryOptions& options) {
+    ThreadPool pool(helperThreads(options.threads));
+    ExternalSortOptions sort;
+    sort.pool = &pool;
+    moves.sortBy(directoryKey, sort);
+}
+
+template <typename Visitor>
+void forEachMove(const std::vector<ArenaMove>& moves, Visitor&& visit) {
+    for (const ArenaMove& move : moves) {
+        visit(move);
+    }
+}
+
+template <typename Visitor>
+void forEachMove(const SpillVector<ArenaMove>& moves, Visitor&& visit) {
+    moves.forEach(visit);
+}
+
+// Plans into `arena` and `moves`, naming in an ArenaNameSet, then executes by
+// rebuilding both paths of each move into reused buffers. Spilled plans are
+// grouped by directory first; the sort counts toward execute.
+template <typename Moves>
+void runArenaPlan(const MemoryOptions& options, std::uint64_t entries, CaseResult& result, PathArena& arena,
+                  Moves& moves) {
+    NullFileSystem fileSystem;
+    const fs::path destination = "/library/photos";
+    resetPeakHeap();
+    const auto planStart = std::chrono::steady_clock::now();
+    ArenaNameSet taken(arena);
+    const DirectoryId destinationId = arena.internDirectory(destination.native());
+    fs::path::string_type candidate;
+    for (std::uint64_t i = 0; i < entries; ++i) {
+        const ArenaPath source = arena.add(syntheticSource(i, options.collisionRate));
+        const ArenaString name = reserveArenaName(taken, source.name, arena.name(source), candidate);
+        moves.push_back(ArenaMove{source.name, name, 4096, source.directory, destinationId});
+    }
+    result.planSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - planStart).count();
+    result.planHeapPeak = heapUsage().peak;
+
+    resetPeakHeap();
+    const auto executeStart = std::chrono::steady_clock::now();
+    groupByDirectory(moves, options);
+    result.sortSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - executeStart).count();
+    std::uint64_t moved = 0;
+    fs::path::string_type from;
+    fs::path::string_type to;
+    forEachMove(moves, [&](const ArenaMove& move) {
+        std::error_code error;
+        fileSystem.renameNoReplace(fs::path(arena.rebuild(move.sourceDirectory, move.sourceName, from)),
+                                   fs::path(arena.rebuild(move.destinationDirectory, move.destinationName, to)),
+                                   error);
+        moved += error ? 0 : 1;
+    });
+    result.executeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - executeStart).count();
+    result.executeHeapPeak = heapUsage().peak;
+
+    if (moved != entries) {
+        throw std::runtime_error("execute moved " + std::to_string(moved) + " of " + std::to_string(entries));
+    }
+}
+
+// The plan held in a PathArena and a vector of fixed-size moves.
+void runArenaMode(const MemoryOptions& options, std::uint64_t entries, CaseResult& result) {
+    PathArena arena;
+    std::vector<ArenaMove> moves;
+    runArenaPlan(options, entries, result, arena, moves);
+}
+
+// As "arena", but the arena's characters and the moves go to mmap-backed
+// spill files past the budget, and the moves are sorted by directory before
+// executing. Only the name set grows with the plan.
+void runSpillMode(const MemoryOptions& options, std::uint64_t entries, CaseResult& result) {
+    SpillOptions spill;
+    spill.directory = options.spillDirectory;
+    spill.memoryBudget = options.spillBudgetMb << 20;
+    PathArena arena(spill);
+    SpillVector<ArenaMove> moves(spill);
+    runArenaPlan(options, entries, result, arena, moves);
+}
+
+struct MemoryMode {
+    const char* name;
+    void (*run)(const MemoryOptions&, std::uint64_t, CaseResult&);
+};
+
+const MemoryMode kModes[] = {
+    {"relocator", runRelocatorMode},
+    {"arena", runArenaMode},
+    {"spill", runSpillMode},
+};
+
+std::uint64_t selfPeakRssKb() {
+#ifdef REELOCATOR_HAVE_FORK
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<std::uint64_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<std::uint64_t>(usage.ru_maxrss);
+#endif
+#else
+    return 0;
+#endif
+}
+
+void runCaseInProcess(const MemoryOptions& options, const MemoryMode& mode, std::uint64_t entries,
+                      CaseResult& result) {
+    result.entries = entries;
+    try {
+        mode.run(options, entries, result);
+        result.completed = true;
+    } catch (const std::bad_alloc&) {
+        std::snprintf(result.error, sizeof(result.error), "out of memory");
+    } catch (const std::exception& ex) {
+        std::snprintf(result.error, sizeof(result.error), "%s", ex.what());
+    }
+    result.peakRssKb = selfPeakRssKb();
+}
+
+// Each case runs in its own child so peak RSS is per case and an OOM kill
+// loses only that case.
+CaseResult runCase(const MemoryOptions& options, const MemoryMode& mode, std::uint64_t entries) {
+    CaseResult result;
+#ifdef REELOCATOR_HAVE_FORK
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        throw std::runtime_error(std::string("pipe failed: ") + std::strerror(errno));
+    }
+    std::cout.flush();
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+        ::close(fds[0]);
+        if (options.memoryLimitMb != 0) {
+            const rlim_t limit = static_cast<rlim_t>(options.memoryLimitMb) * 1024 * 1024;
+            const rlimit cap{limit, limit};
+            ::setrlimit(RLIMIT_AS, &cap);
+        }
+        CaseResult child;
+        runCaseInProcess(options, mode, entries, child);
+        const ssize_t written = ::write(fds[1], &child, sizeof(child));
+        ::_exit(written == static_cast<ssize_t>(sizeof(child)) ? 0 : 1);
+    }
+    ::close(fds[1]);
+    if (pid < 0) {
+        ::close(fds[0]);
+        throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+    }
+
+    const ssize_t received = ::read(fds[0], &result, sizeof(result));
+    ::close(fds[0]);
+    int status = 0;
+    rusage usage{};
+    ::wait4(pid, &status, 0, &usage);
+    if (received != static_cast<ssize_t>(sizeof(result))) {
+        result = CaseResult{};
+        result.entries = entries;
+        std::snprintf(result.error, sizeof(result.error), "%s",
+                      WIFSIGNALED(status) ? "killed (out of memory?)" : "child exited without a result");
+    }
+#if defined(__APPLE__)
+    result.peakRssKb = static_cast<std::uint64_t>(usage.ru_maxrss) / 1024;
+#else
+    result.peakRssKb = static_cast<std::uint64_t>(usage.ru_maxrss);
+#endif
+#else
+    runCaseInProcess(options, mode, entries, result);
+#endif
+    return result;
+}
+
+std::string requireValue(int argc, char* argv[], int& i) {
+    const std::string flag = argv[i];
+    if (i + 1 >= argc) {
+        throw std::invalid_argument(flag + " requires a value");
+    }
+    return argv[++i];
+}
+
+std::vector<std::uint64_t> parseEntryList(const std::string& text) {
+    std::vector<std::uint64_t> entries;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        entries.push_back(std::stoull(item));
+        if (entries.back() == 0) {
+            throw std::invalid_argument("--entries values must be positive");
+        }
+    }
+    if (entries.empty()) {
+        throw std::invalid_argument("--entries requires at least one count");
+    }
+    return entries;
+}
+
+MemoryOptions parseMemoryOptions(int argc, char* argv[]) {
+    MemoryOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--entries") {
+            options.entries = parseEntryList(requireValue(argc, argv, i));
+        } else if (arg == "--mode") {
+            options.mode = requireValue(argc, argv, i);
+        } else if (arg == "--collision-rate") {
+            options.collisionRate = std::stod(requireValue(argc, argv, i));
+        } else if (arg == "--threads") {
+            options.threads = std::stoul(requireValue(argc, argv, i));
+        } else if (arg == "--memory-limit-mb") {
+            options.memoryLimitMb = std::stoull(requireValue(argc, argv, i));
+        } else if (arg == "--spill-budget-mb") {
+            options.spillBudgetMb = std::stoul(requireValue(argc, argv, i));
+        } else if (arg == "--spill-dir") {
+            options.spillDirectory = requireValue(argc, argv, i);
+        } else if (arg == "--json-out") {
+            options.jsonOutputPath = requireValue(argc, argv, i);
+        } else {
+            throw std::invalid_argument("unknown argument: " + arg);
+        }
+    }
+    return options;
+}
+
+std::string entryLabel(std::uint64_t entries) {
+    if (entries % 1000000 == 0) {
+        return std::to_string(entries / 1000000) + "M";
+    }
+    if (entries % 1000 == 0) {
+        return std::to_string(entries / 1000) + "k";
+    }
+    return std::to_string(entries);
+}
+
+double perFile(std::uint64_t bytes, std::uint64_t entries) {
+    return static_cast<double>(bytes) / static_cast<double>(entries);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    MemoryOptions options;
+    try {
+        options = parseMemoryOptions(argc, argv);
+    } catch (const std::exception& ex) {
+        std::cerr << "Argument error: " << ex.what() << "\n";
+        return 2;
+    }
+
+    struct Row {
+        std::string name;
+        CaseResult result;
+    };
+    std::vector<Row> rows;
+    try {
+        for (const MemoryMode& mode : kModes) {
+            if (!options.mode.empty() && options.mode != mode.name) {
+                continue;
+            }
+            for (const std::uint64_t entries : options.entries) {
+                Row row{std::string("memory/") + mode.name + "/" + entryLabel(entries),
+                        runCase(options, mode, entries)};
+                const CaseResult& r = row.result;
+                if (r.completed) {
+                    std::cout << row.name << ": plan heap " << perFile(r.planHeapPeak, entries)
+                              << " B/file, execute heap " << perFile(r.executeHeapPeak, entries)
+                              << " B/file, peak RSS " << perFile(r.peakRssKb * 1024, entries) << " B/file ("
+                              << r.peakRssKb << " KiB)\n";
+                } else {
+                    std::cout << row.name << ": failed - " << r.error << "\n";
+                }
+                rows.push_back(std::move(row));
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Benchmark error: " << ex.what() << "\n";
+        return 1;
+    }
+
+    bool ok = true;
+    if (!options.jsonOutputPath.empty()) {
+        std::ofstream out(options.jsonOutputPath);
+        out << "{\"benchmarks\":[";
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            const CaseResult& r = rows[i].result;
+            out << (i == 0 ? "" : ",") << "\n  {\"name\":\"" << rows[i].name << "\",\"kind\":\"memory\""
+                << ",\"entries\":" << r.entries << ",\"completed\":" << (r.completed ? "true" : "false");
+            if (r.completed) {
+                const std::uint64_t heapPeak = std::max(r.planHeapPeak, r.executeHeapPeak);
+                out << ",\"heap_bytes_per_file\":" << perFile(heapPeak, r.entries)
+                    << ",\"plan_heap_peak_bytes\":" << r.planHeapPeak
+                    << ",\"execute_heap_peak_bytes\":" << r.executeHeapPeak
+                    << ",\"rss_bytes_per_file\":" << perFile(r.peakRssKb * 1024, r.entries)
+                    << ",\"peak_rss_kb\":" << r.peakRssKb << ",\"plan_seconds\":" << r.planSeconds
+                    << ",\"execute_seconds\":" << r.executeSeconds << ",\"sort_seconds\":" << r.sortSeconds;
+            } else {
+                out << ",\"error\":\"" << r.error << "\"";
+            }
+            out << "}";
+        }
+        out << "\n]}\n";
+        if (!out) {
+            std::cerr << "Failed to write " << options.jsonOutputPath << "\n";
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
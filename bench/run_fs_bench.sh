@@ -0,0 +1,84 @@
+#!/usr/bin/env bash
+# Runs reelocator_e2e_bench on tmpfs, on loop-mounted ext4/XFS/btrfs images,
+# and across two loop devices (ext4 -> XFS) so every move takes the copy path.
+# Needs root for mount/losetup; filesystems whose mkfs tool is missing are
+# skipped. Results land in <out-dir>/<label>.json.
+#
+# Usage: sudo bench/run_fs_bench.sh <build-dir> <out-dir> [extra bench args...]
+set -euo pipefail
+
+build_dir=${1:?usage: run_fs_bench.sh <build-dir> <out-dir> [bench args...]}
+out_dir=${2:?usage: run_fs_bench.sh <build-dir> <out-dir> [bench args...]}
+shift 2
+
+bench="$build_dir/reelocator_e2e_bench"
+image_size=${REELOCATOR_BENCH_IMAGE_SIZE:-4G}
+commit=$(git -C "$(dirname "$0")/.." rev-parse --short HEAD 2>/dev/null || echo unknown)
+work=$(mktemp -d /tmp/reelocator-fsbench.XXXXXX)
+mounts=()
+
+cleanup() {
+    for ((i = ${#mounts[@]} - 1; i >= 0; i--)); do
+        umount "${mounts[$i]}" 2>/dev/null || true
+    done
+    rm -rf "$work"
+}
+trap cleanup EXIT
+
+mkdir -p "$out_dir"
+
+# The mount helpers record the mount point in $mounted_dir (not on stdout) so
+# that $mounts is updated in this shell rather than in a subshell.
+mount_tmpfs() {
+    mounted_dir="$work/tmpfs"
+    mkdir -p "$mounted_dir"
+    mount -t tmpfs -o size="$image_size" tmpfs "$mounted_dir"
+    mounts+=("$mounted_dir")
+}
+
+# Creates a sparse image, formats it with mkfs.<type> and loop-mounts it.
+mount_image() {
+    local type=$1 name=$2
+    local image="$work/$name.img"
+    mounted_dir="$work/$name"
+    truncate -s "$image_size" "$image"
+    case "$type" in
+        ext4) mkfs.ext4 -q -F "$image" ;;
+        xfs) mkfs.xfs -q -f "$image" ;;
+        btrfs) mkfs.btrfs -q -f "$image" ;;
+    esac
+    mkdir -p "$mounted_dir"
+    mount -o loop "$image" "$mounted_dir"
+    mounts+=("$mounted_dir")
+}
+
+run() {
+    local label=$1 source=$2 destination=$3
+    shift 3
+    echo "== $label"
+    "$bench" --label "$label" --commit "$commit" --source-root "$source" --destination-root "$destination" \
+        --json-out "$out_dir/$label.json" "$@"
+}
+
+mount_tmpfs
+run tmpfs "$mounted_dir" "$mounted_dir" "$@"
+
+declare -A mounted
+for type in ext4 xfs btrfs; do
+    if ! command -v "mkfs.$type" >/dev/null; then
+        echo "== $type skipped (mkfs.$type not found)"
+        continue
+    fi
+    mount_image "$type" "$type"
+    mounted[$type]=$mounted_dir
+    run "$type" "${mounted[$type]}" "${mounted[$type]}" "$@"
+done
+
+if [[ -n ${mounted[ext4]:-} && -n ${mounted[xfs]:-} ]]; then
+    run cross-device "${mounted[ext4]}" "${mounted[xfs]}" "$@"
+elif [[ -n ${mounted[ext4]:-} ]]; then
+    mount_image ext4 ext4-second
+    run cross-device "${mounted[ext4]}" "$mounted_dir" "$@"
+else
+    echo "== cross-device skipped (needs mkfs.ext4)"
+fi
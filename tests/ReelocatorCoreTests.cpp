@@ -1,13 +1,51 @@
+#include "AllocationTracker.hpp"
+#include "ReelocatorCApi.h"
+#ifdef REELOCATOR_HAVE_ASYNC
+#include "ReelocatorAsync.hpp"
+#endif
 #include "ReelocatorCore.hpp"
+#include "ReelocatorDaemon.hpp"
+#include "ReelocatorFaultInjection.hpp"
+#include "ReelocatorIdentitySet.hpp"
+#include "ReelocatorMetrics.hpp"
+#include "ReelocatorPathArena.hpp"
+#include "ReelocatorPlanStore.hpp"
+#include "ReelocatorSpill.hpp"
+#include "ReelocatorTrace.hpp"
+#include "SyscallTracer.hpp"
+#include "TreeGenerator.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
 namespace fs = std::filesystem;
 
 namespace {
@@ -127,6 +165,126 @@ void testIsTargetFileRejectsWrongMediaType() {
     expect(!isTargetFile("clip.mp4", MediaType::Images), "video extension should not match image media type");
 }
 
+void testClassificationAndNamingDoNotAllocatePerCollision() {
+    const std::vector<fs::path> paths = {
+        "/cards/DCIM/100CANON/IMG_0001.JPG",
+        "/cards/DCIM/100CANON/MVI_0001.MoV",
+        fs::path("/cards/DCIM") / (std::string(240, 'x') + ".JpEg"),
+        "/cards/DCIM/100CANON/sidecar.extension_longer_than_any_media_type",
+        "/cards/DCIM/100CANON/README",
+        "/cards/.jpg",
+        "/cards/DCIM.jpg/notes",
+    };
+    // Counts are read before expect() builds its message string.
+    std::size_t matched = 0;
+    std::uint64_t allocations = 0;
+    {
+        AllocationScope scope;
+        for (const fs::path& path : paths) {
+            matched += isTargetFile(path, MediaType::Images) ? 1 : 0;
+            matched += isTargetFile(path, MediaType::Videos) ? 1 : 0;
+        }
+        allocations = scope.allocations().count;
+    }
+    expect(allocations == 0, "isTargetFile should never allocate");
+    expect(matched == 3, "classification should match only the two images and the video");
+    expect(isTargetFile("photo.JPEG", MediaType::Images) && !isTargetFile("photo.", MediaType::Images) &&
+               !isTargetFile("..", MediaType::Images),
+           "extensions should follow fs::path::extension()");
+
+    std::string longName(200, 'A');
+    {
+        AllocationScope scope;
+        longName = toLower(std::move(longName));
+        allocations = scope.allocations().count;
+    }
+    expect(allocations == 0, "toLower should reuse the buffer of an rvalue argument");
+    expect(longName == std::string(200, 'a'), "toLower should lowercase every character");
+
+    // Reserving the 201st IMG name costs what reserving a fresh name does,
+    // plus one candidate buffer: the set node and the returned path (whose
+    // long components allocate), not one string per probe.
+    DestinationIndex index(fs::path("/library/photos/2024/a-destination-directory-with-a-long-name"));
+    const std::string longStem = "holiday_" + std::string(40, 'x');
+    for (int i = 0; i <= 200; ++i) {
+        index.markTaken(i == 0 ? "IMG.jpg" : "IMG_" + std::to_string(i) + ".jpg");
+        index.markTaken(i == 0 ? longStem + ".jpg" : longStem + "_" + std::to_string(i) + ".jpg");
+    }
+    auto reserveCost = [&index](const fs::path& filename) {
+        AllocationScope scope;
+        const fs::path reserved = index.reserveUniquePath(filename);
+        const std::uint64_t count = scope.allocations().count;
+        index.release(reserved.filename());
+        return count;
+    };
+    const fs::path fresh = "fresh.jpg";
+    const fs::path freshLong = "fresh_" + std::string(40, 'x') + ".jpg";
+    const fs::path chained = "IMG.jpg";
+    const fs::path chainedLong = longStem + ".jpg";
+    const std::uint64_t freshCost = reserveCost(fresh);
+    const std::uint64_t chainedCost = reserveCost(chained);
+    const std::uint64_t freshLongCost = reserveCost(freshLong);
+    const std::uint64_t chainedLongCost = reserveCost(chainedLong);
+    expect(chainedCost <= freshCost + 1, "a 200-name collision chain should not allocate per probe");
+    expect(chainedLongCost <= freshLongCost + 1, "long names should cost one candidate buffer, not one per probe");
+    expect(chainedCost <= 6, "naming should need only a handful of allocations");
+}
+
+void testPathArenaInternsDirectoriesAndRebuildsPaths() {
+    const std::vector<fs::path> files = {
+        "/cards/card_0/DCIM/100MEDIA/IMG_0001.JPG",
+        "/cards/card_0/DCIM/100MEDIA/IMG_0002.JPG",
+        "/cards/card_1/DCIM/100MEDIA/IMG_0001.JPG",
+        "/cards/card_0/DCIM/100MEDIA/IMG_0003.JPG",
+        "/root.jpg",
+        "relative.jpg",
+    };
+    PathArena arena;
+    std::vector<ArenaPath> stored;
+    for (const fs::path& file : files) {
+        stored.push_back(arena.add(file));
+    }
+    expect(arena.directoryCount() == 4, "each directory should be interned once");
+    expect(stored[0].directory == stored[3].directory && stored[0].directory != stored[2].directory,
+           "files should share their directory's id");
+
+    fs::path::string_type buffer;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        expect(arena.rebuild(stored[i], buffer) == files[i].native() && arena.path(stored[i]) == files[i],
+               "rebuilt path should match " + files[i].string());
+    }
+    std::uint64_t allocations = 0;
+    {
+        AllocationScope scope;
+        for (const ArenaPath& path : stored) {
+            arena.rebuild(path, buffer);
+        }
+        allocations = scope.allocations().count;
+    }
+    expect(allocations == 0, "rebuilding into a grown buffer should not allocate");
+
+    bool threw = false;
+    try {
+        arena.store(fs::path::string_type(ArenaString::kMaxLength + 1, 'x'));
+    } catch (const std::length_error&) {
+        threw = true;
+    }
+    expect(threw, "strings longer than an ArenaString can address should be rejected");
+
+    ArenaNameSet names(arena);
+    expect(names.insert(stored[0].name).second, "a new name should be inserted without copying");
+    const auto again = names.insert(stored[2].name);
+    expect(!again.second && arena.view(again.first) == arena.name(stored[0]),
+           "an equal name should be found whichever copy is inserted");
+    for (int i = 0; i < 5000; ++i) {
+        const fs::path::string_type name = fs::path("DSC_" + std::to_string(i) + ".JPG").native();
+        expect(names.insert(PathView(name)).second, "new names should be inserted across growth");
+    }
+    expect(names.size() == 5001 && names.contains(fs::path("DSC_4999.JPG").native()) &&
+               names.contains(fs::path("IMG_0001.JPG").native()) && !names.contains(fs::path("DSC_5000.JPG").native()),
+           "the set should keep every name through rehashing");
+}
+
 void testGetUniqueDestinationPathAddsNumericSuffix() {
     const auto tick = std::chrono::high_resolution_clock::now().time_since_epoch().count();
     const fs::path tempDir = fs::temp_directory_path() / ("reelocator-tests-" + std::to_string(tick));
@@ -144,24 +302,1897 @@ void testGetUniqueDestinationPathAddsNumericSuffix() {
     fs::remove_all(tempDir);
 }
 
-fs::path parseJunitOutputPath(int argc, char* argv[]) {
-    fs::path outputPath = fs::path("build") / "test-results" / "reelocator-unit.xml";
+// Set by the runner for the test executing on this thread (or in this forked
+// child), so parallel tests never share scratch directories and a failing
+// test's leftovers are removed with its root.
+thread_local fs::path currentTestRoot;
+
+fs::path makeTempDir(const std::string& label) {
+    static std::atomic<unsigned> sequence{0};
+    const fs::path base = currentTestRoot.empty() ? fs::temp_directory_path() : currentTestRoot;
+    const fs::path tempDir = base / ("reelocator-" + label + "-" + std::to_string(sequence.fetch_add(1)));
+    fs::create_directories(tempDir);
+    return tempDir;
+}
+
+std::string readFile(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void testGetUniqueDestinationPathStaysWithinSyscallBudget() {
+    const fs::path tempDir = makeTempDir("budget");
+    std::ofstream((tempDir / "frame.jpg").string()).close();
+    std::ofstream((tempDir / "frame_1.jpg").string()).close();
+
+    FileSystem fileSystem;
+    getUniqueDestinationPath(tempDir, "fresh.jpg", fileSystem);
+    expect(fileSystem.counters().total() == 1, "a non-colliding name should cost exactly one exists probe");
+
+    fileSystem.counters().reset();
+    getUniqueDestinationPath(tempDir, "frame.jpg", fileSystem);
+    expect(fileSystem.counters().count(FsOperation::Exists) == 3,
+           "a name with two collisions should cost three exists probes");
+    expect(fileSystem.counters().total() == 3, "naming should make no calls besides exists probes");
+
+    fs::remove_all(tempDir);
+}
+
+struct SpillTestRecord {
+    std::uint64_t key;
+    std::uint32_t sequence;
+};
+
+void testSpillVectorBoundsHeapAndSortsExternally() {
+    if (!spillSupported()) {
+        throw SkippedTest("spilling requires mmap");
+    }
+    const fs::path spillDir = makeTempDir("spill");
+    SpillOptions options;
+    options.directory = spillDir;
+    options.memoryBudget = 4096;
+
+    SpillVector<SpillTestRecord> records(options);
+    std::mt19937_64 random(7);
+    std::vector<std::uint64_t> keys;
+    for (std::uint32_t i = 0; i < 20000; ++i) {
+        keys.push_back(random() % 5000);
+        records.push_back(SpillTestRecord{keys.back(), i});
+    }
+    expect(records.size() == 20000 && records.storage().segmentCount() > 1,
+           "records past the budget should be written as segments");
+    expect(fs::is_empty(spillDir), "spill files should be unlinked while in use");
+
+    std::uint32_t expected = 0;
+    bool inOrder = true;
+    records.forEach([&](const SpillTestRecord& record) {
+        inOrder = inOrder && record.sequence == expected && record.key == keys[expected];
+        ++expected;
+    });
+    expect(inOrder && expected == 20000, "iteration should return records in append order");
+
+    // A small fan-in forces several merge passes (78 runs, 3 at a time).
+    ThreadPool pool(2);
+    ExternalSortOptions sortOptions;
+    sortOptions.pool = &pool;
+    sortOptions.fanIn = 3;
+    sortOptions.directory = makeTempDir("spill-sort");
+    records.sortBy([](const SpillTestRecord& record) { return record.key; }, sortOptions);
+    expect(fs::is_empty(sortOptions.directory), "merge runs should not leave files behind");
+    std::vector<std::uint64_t> sortedKeys;
+    std::vector<bool> seen(20000, false);
+    records.forEach([&](const SpillTestRecord& record) {
+        sortedKeys.push_back(record.key);
+        seen[record.sequence] = record.key == keys[record.sequence];
+    });
+    std::sort(keys.begin(), keys.end());
+    expect(sortedKeys == keys, "an external sort should order every record by key");
+    expect(std::all_of(seen.begin(), seen.end(), [](bool ok) { return ok; }),
+           "sorting should keep each record intact");
+
+    PathArena arena(options);
+    std::vector<ArenaPath> stored;
+    for (int i = 0; i < 200000; ++i) {
+        stored.push_back(arena.add("/cards/card_" + std::to_string(i / 1000) + "/DSC_" + std::to_string(i) + ".JPG"));
+    }
+    expect(arena.bytesReserved() < (std::size_t{2} << 20), "arena chunks past the budget should be mapped");
+    expect(arena.path(stored[123456]) == "/cards/card_123/DSC_123456.JPG",
+           "paths in mapped chunks should rebuild like heap ones");
+}
+
+void testParseJobManifestReadsTabSeparatedJobs() {
+    std::istringstream manifest("# nightly ingest\n"
+                                "images\t/cards/a\t/library/photos\n"
+                                "\n"
+                                "Videos\t/cards/with space\t/library/clips\r\n");
+    const std::vector<RelocationJob> jobs = parseJobManifest(manifest);
+    expect(jobs.size() == 2, "comments and blank lines should be skipped");
+    expect(jobs[0].mediaType == MediaType::Images && jobs[0].destination == "/library/photos",
+           "first job should parse type and destination");
+    expect(jobs[1].mediaType == MediaType::Videos && jobs[1].source == "/cards/with space" &&
+               jobs[1].destination == "/library/clips",
+           "media type should be case-insensitive and CRLF stripped");
+
+    std::istringstream malformed("images /cards/a /library\n");
+    bool threw = false;
+    try {
+        parseJobManifest(malformed);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    expect(threw, "lines without tab separators should be rejected");
+}
+
+void testDestinationIndexMatchesUniquePathWithoutProbes() {
+    const fs::path tempDir = makeTempDir("index");
+    std::ofstream((tempDir / "capture.png").string()).close();
+    std::ofstream((tempDir / "capture_1.png").string()).close();
+
+    FileSystem fileSystem;
+    DestinationIndex index(tempDir);
+    index.load(fileSystem);
+    fileSystem.counters().reset();
+
+    expect(index.reserveUniquePath("capture.png") == getUniqueDestinationPath(tempDir, "capture.png"),
+           "index should choose the same name as getUniqueDestinationPath");
+    expect(index.reserveUniquePath("capture.png").filename() == "capture_3.png",
+           "reserved names should count as taken for later files");
+    index.release("capture_3.png");
+    expect(index.reserveUniquePath("capture.png").filename() == "capture_3.png",
+           "released names should become available again");
+    expect(fileSystem.counters().total() == 0, "a loaded index should answer without filesystem calls");
+
+    fs::remove_all(tempDir);
+}
+
+void touchFile(const fs::path& path) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path.string()).close();
+}
+
+void testRelocatorPlanChoosesNamesAndExecuteMoves() {
+    const fs::path tempDir = makeTempDir("engine");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    touchFile(source / "card1" / "IMG_0001.JPG");
+    touchFile(source / "card2" / "IMG_0001.JPG");
+    touchFile(source / "card2" / "notes.txt");
+    touchFile(destination / "IMG_0001.JPG");
+
+    RelocatorOptions options;
+    options.workerThreads = 2;
+    std::atomic<std::uintmax_t> events{0};
+    options.onEvent = [&events](const RelocationEvent&) { ++events; };
+    Relocator relocator(options);
+
+    const RelocationPlan plan = relocator.plan(RelocationJob{MediaType::Images, source, destination});
+    expect(plan.moves.size() == 2, "plan should include only matching files");
+    expect(plan.scanned == 3, "plan should count every regular file it visited");
+    expect(fs::exists(source / "card1" / "IMG_0001.JPG"), "plan must not move anything");
+    expect(plan.moves[0].destination.filename() == "IMG_0001_1.JPG" &&
+               plan.moves[1].destination.filename() == "IMG_0001_2.JPG",
+           "plan should assign collision suffixes in traversal order");
+    expect(plan.moves[0].source.parent_path() != plan.moves[1].source.parent_path(),
+           "both colliding cards should be planned");
+
+    const RelocationSummary summary = relocator.execute(plan);
+    expect(summary.moved == 2 && summary.skipped == 0, "execute should move every planned file");
+    expect(events.load() == 2, "execute should report one event per planned file");
+    expect(fs::exists(destination / "IMG_0001_1.JPG") && fs::exists(destination / "IMG_0001_2.JPG"),
+           "planned destinations should exist after execute");
+
+    touchFile(source / "card3" / "IMG_0001.JPG");
+    const RelocationSummary second = relocator.run(RelocationJob{MediaType::Images, source, destination});
+    expect(second.moved == 1 && fs::exists(destination / "IMG_0001_3.JPG"),
+           "a reused relocator should keep naming from its warm destination index");
+
+    fs::remove_all(tempDir);
+}
+
+void testRelocatorPrunesDestinationInsideSource() {
+    const fs::path tempDir = makeTempDir("nested");
+    const fs::path source = tempDir / "source";
+    touchFile(source / "IMG_0001.JPG");
+    touchFile(source / "card" / "IMG_0002.JPG");
+    touchFile(source / "library" / "IMG_0001.JPG");
+
+    RelocatorOptions options;
+    options.workerThreads = 1;
+    Relocator relocator(options);
+
+    const RelocationPlan plan = relocator.plan(RelocationJob{MediaType::Images, source, source / "library"});
+    expect(plan.scanned == 2, "traversal should not enter a destination inside the source");
+    const RelocationSummary summary = relocator.execute(plan);
+    expect(summary.moved == 2, "files outside the nested destination should move");
+    expect(fs::exists(source / "library" / "IMG_0001.JPG") && fs::exists(source / "library" / "IMG_0001_1.JPG") &&
+               fs::exists(source / "library" / "IMG_0002.JPG"),
+           "existing destination files should stay and new ones get free names");
+
+    // Reached through a symlink and a deeper path, the destination is still
+    // found inside the source and left alone on a second run.
+    touchFile(source / "card" / "IMG_0003.JPG");
+    touchFile(source / "card" / "sorted" / "IMG_0004.JPG");
+    std::error_code linkError;
+    fs::create_directory_symlink(source / "card", tempDir / "link", linkError);
+    if (!linkError) {
+        const RelocationSummary second =
+            relocator.run(RelocationJob{MediaType::Images, tempDir / "link" / "..", tempDir / "link" / "sorted"});
+        expect(second.moved == 4 && fs::exists(source / "card" / "sorted" / "IMG_0004.JPG") &&
+                   !fs::exists(source / "card" / "sorted" / "IMG_0004_1.JPG"),
+               "a destination spelled through a symlink should still be pruned");
+    }
+
+    fs::remove_all(tempDir);
+}
+
+void testIdentitySetAdmitsEachIdentityOnceAcrossThreads() {
+    IdentitySet set;
+    ThreadPool pool(3);
+    constexpr std::size_t kDistinct = 20000;
+    std::atomic<std::size_t> inserted{0};
+    // Every identity is inserted by four tasks at once; sequential inodes on
+    // two devices make sure shards and slots both see collisions.
+    pool.parallelFor(4 * kDistinct, [&](std::size_t i) {
+        const std::size_t id = i / 4;
+        if (set.insert(FileIdentity{id % 2, id / 2})) {
+            ++inserted;
+        }
+    });
+    expect(inserted.load() == kDistinct && set.size() == kDistinct,
+           "each identity should be inserted exactly once under contention");
+    expect(set.contains(FileIdentity{0, 0}) && set.contains(FileIdentity{1, kDistinct / 2 - 1}) &&
+               !set.contains(FileIdentity{2, 0}) && !set.contains(FileIdentity{0, kDistinct}),
+           "contains should report exactly the inserted identities");
+}
+
+void testRelocatorFollowsSymlinksScanningEachDirectoryOnce() {
+    const fs::path tempDir = makeTempDir("follow");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    touchFile(source / "cardA" / "IMG_0001.JPG");
+    touchFile(source / "cardA" / "nested" / "IMG_0002.JPG");
+    touchFile(tempDir / "elsewhere" / "cardB" / "IMG_0003.JPG");
+    touchFile(destination / "IMG_0009.JPG");
+
+    std::error_code linkError;
+    fs::create_directory_symlink(source / "cardA", source / "again", linkError);
+    fs::create_directory_symlink(source, source / "cardA" / "nested" / "loop", linkError);
+    fs::create_directory_symlink(tempDir / "elsewhere" / "cardB", source / "cardB", linkError);
+    fs::create_directory_symlink(destination, source / "library", linkError);
+    if (linkError) {
+        fs::remove_all(tempDir);
+        throw SkippedTest("directory symlinks are not supported here");
+    }
+
+    RelocatorOptions options;
+    options.workerThreads = 3;
+    Relocator relocator(options);
+
+    RelocationJob job{MediaType::Images, source, destination};
+    const RelocationPlan plain = relocator.plan(job);
+    expect(plain.scanned == 2, "the default walk should not follow directory symlinks");
+    relocator.discard(plain);
+
+    job.followSymlinks = true;
+    const RelocationPlan plan = relocator.plan(job);
+    expect(plan.scanned == 3, "every physical directory should be scanned once, skipping loops and the destination");
+    const RelocationSummary summary = relocator.execute(plan);
+    expect(summary.moved == 3 && fs::exists(destination / "IMG_0001.JPG") && fs::exists(destination / "IMG_0002.JPG") &&
+               fs::exists(destination / "IMG_0003.JPG") && fs::exists(destination / "IMG_0009.JPG") &&
+               !fs::exists(destination / "IMG_0001_1.JPG"),
+           "each file should be moved once under its own name");
+
+    fs::remove_all(tempDir);
+}
+
+void testRelocatorSpillsPlanPastMemoryBudget() {
+    bool rejected = false;
+    try {
+        RecordSpill empty(0);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    expect(rejected, "a zero record size should be rejected before it is divided by");
+    if (!spillSupported()) {
+        throw SkippedTest("spilling requires mmap");
+    }
+
+    const fs::path tempDir = makeTempDir("plan-spill");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    constexpr std::size_t kFiles = 600;
+    for (std::size_t i = 0; i < kFiles; ++i) {
+        touchFile(source / ("card" + std::to_string(i % 3)) / ("IMG_" + std::to_string(i % 200) + ".JPG"));
+    }
+    touchFile(destination / "IMG_0.JPG");
+
+    RelocatorOptions options;
+    options.workerThreads = 2;
+    options.spillPlans = true;
+    options.planSpill.memoryBudget = 4096;
+    options.planSpill.directory = tempDir;
+    std::atomic<std::uintmax_t> planned{0};
+    options.onProgress = [&planned](const RelocationProgress& progress) { planned = progress.planned; };
+    Relocator relocator(options);
+
+    const RelocationJob job{MediaType::Images, source, destination};
+    const RelocationPlan discarded = relocator.plan(job);
+    expect(discarded.moves.empty() && discarded.spilled && discarded.moveCount() == kFiles,
+           "a spilling relocator should keep the plan out of RelocationPlan::moves");
+    expect(discarded.spilled->spilledBytes() > 0 && discarded.spilled->chunkCount() > 1,
+           "records past the budget should be written to a spill file");
+    relocator.discard(discarded);
+
+    // Discarding released every reserved name, so the next plan starts from
+    // _1 again.
+    const RelocationPlan plan = relocator.plan(job);
+    const RelocationSummary summary = relocator.execute(plan);
+    expect(summary.moved == kFiles && summary.skipped == 0 && planned.load() == kFiles,
+           "every spilled move should be executed and reported");
+    std::size_t count = 0;
+    for (const auto& entry : fs::directory_iterator(destination)) {
+        count += entry.is_regular_file() ? 1 : 0;
+    }
+    expect(count == kFiles + 1 && fs::exists(destination / "IMG_0_1.JPG") && fs::exists(destination / "IMG_0_3.JPG") &&
+               !fs::exists(destination / "IMG_0_4.JPG"),
+           "spilled moves should land under the names chosen while planning");
+
+    fs::remove_all(tempDir);
+}
+
+void testFollowSymlinksPlanIsStableAcrossThreadedRuns() {
+    const fs::path tempDir = makeTempDir("follow-stable");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    for (int i = 0; i < 20; ++i) {
+        touchFile(tempDir / "shared" / ("IMG_" + std::to_string(i) + ".JPG"));
+        touchFile(source / ("card" + std::to_string(i)) / "IMG_0.JPG");
+    }
+
+    // Both links sit in the same level, so their listings race to claim the
+    // shared directory.
+    std::error_code linkError;
+    fs::create_directory_symlink(tempDir / "shared", source / "link_a", linkError);
+    fs::create_directory_symlink(tempDir / "shared", source / "link_b", linkError);
+    if (linkError) {
+        fs::remove_all(tempDir);
+        throw SkippedTest("directory symlinks are not supported here");
+    }
+
+    RelocatorOptions options;
+    options.workerThreads = 4;
+    Relocator relocator(options);
+    RelocationJob job{MediaType::Images, source, destination};
+    job.followSymlinks = true;
+
+    std::vector<std::pair<fs::path, fs::path>> first;
+    for (int run = 0; run < 20; ++run) {
+        const RelocationPlan plan = relocator.plan(job);
+        std::vector<std::pair<fs::path, fs::path>> moves;
+        for (const PlannedMove& move : plan.moves) {
+            moves.emplace_back(move.source, move.destination);
+        }
+        relocator.discard(plan);
+        if (run == 0) {
+            first = moves;
+            expect(moves.size() == 40, "the shared directory should be scanned once");
+            expect(std::all_of(moves.begin(), moves.end(),
+                               [&](const auto& move) { return move.first.parent_path() != source / "link_b"; }),
+                   "the first link in name order should own the shared directory");
+        } else {
+            expect(moves == first, "every run should produce the same plan");
+        }
+    }
+
+    fs::remove_all(tempDir);
+}
+
+// Kernel calls made by one single-threaded relocation of `files` images,
+// flat in one card folder. With `planned`, only execute() is traced.
+SyscallCounts traceRelocation(const std::string& label, std::size_t files, bool planned) {
+    const fs::path tempDir = makeTempDir(label);
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    for (std::size_t i = 0; i < files; ++i) {
+        touchFile(source / "DCIM" / ("DSC_" + std::to_string(i) + ".JPG"));
+    }
+    fs::create_directories(destination);
+
+    RelocatorOptions options;
+    options.workerThreads = 1;
+    Relocator relocator(options);
+    const RelocationJob job{MediaType::Images, source, destination};
+    SyscallCounts counts;
+    if (planned) {
+        const RelocationPlan plan = relocator.plan(job);
+        counts = countSyscalls([&] { relocator.execute(plan); });
+    } else {
+        counts = countSyscalls([&] { relocator.run(job); });
+    }
+
+    std::size_t moved = 0;
+    for (const auto& entry : fs::directory_iterator(destination)) {
+        moved += entry.is_regular_file() ? 1 : 0;
+    }
+    fs::remove_all(tempDir);
+    expect(moved == files, "traced relocation should move every file");
+    return counts;
+}
+
+// Budgets are per extra file, taken as the difference between two tree
+// sizes so fixed setup costs do not hide a per-file regression.
+void expectPerFileBudget(const SyscallCounts& small, const SyscallCounts& large, std::uint64_t extraFiles,
+                         SyscallKind kind, std::uint64_t budget, const std::string& what) {
+    const SyscallCounts extra = large - small;
+    expect(extra.count(kind) <= budget * extraFiles,
+           what + " should make at most " + std::to_string(budget) + " " + syscallKindName(kind) +
+               " calls per file (extra calls for " + std::to_string(extraFiles) + " files: " + extra.describe() +
+               ")");
+}
+
+void testRelocationStaysWithinKernelSyscallBudget() {
+    SyscallCounts fresh;
+    SyscallCounts collided;
+    const fs::path tempDir = makeTempDir("syscalls");
+    touchFile(tempDir / "frame.jpg");
+    touchFile(tempDir / "frame_1.jpg");
+    try {
+        fresh = countSyscalls([&] { getUniqueDestinationPath(tempDir, "fresh.jpg"); });
+        collided = countSyscalls([&] { getUniqueDestinationPath(tempDir, "frame.jpg"); });
+    } catch (const SyscallTracingUnavailable& ex) {
+        fs::remove_all(tempDir);
+        throw SkippedTest(ex.what());
+    }
+    fs::remove_all(tempDir);
+    expect(fresh.count(SyscallKind::Stat) <= 1 && fresh.fileSystemTotal() <= 1,
+           "a non-colliding name should cost one stat, got " + fresh.describe());
+    expect(collided.count(SyscallKind::Stat) <= 3 && collided.fileSystemTotal() <= 3,
+           "a name with two collisions should cost three stats, got " + collided.describe());
+
+    constexpr std::size_t kSmall = 8;
+    constexpr std::size_t kLarge = 40;
+    const SyscallCounts executeSmall = traceRelocation("syscalls-execute", kSmall, true);
+    const SyscallCounts executeLarge = traceRelocation("syscalls-execute", kLarge, true);
+    const std::string execute = "executing a non-colliding same-device move";
+    expectPerFileBudget(executeSmall, executeLarge, kLarge - kSmall, SyscallKind::Rename, 1, execute);
+    for (const SyscallKind kind : {SyscallKind::Stat, SyscallKind::Open, SyscallKind::Unlink, SyscallKind::Io}) {
+        expectPerFileBudget(executeSmall, executeLarge, kLarge - kSmall, kind, 0, execute);
+    }
+
+    const SyscallCounts runSmall = traceRelocation("syscalls-run", kSmall, false);
+    const SyscallCounts runLarge = traceRelocation("syscalls-run", kLarge, false);
+    const std::string run = "scanning and moving a non-colliding file";
+    expectPerFileBudget(runSmall, runLarge, kLarge - kSmall, SyscallKind::Rename, 1, run);
+    expectPerFileBudget(runSmall, runLarge, kLarge - kSmall, SyscallKind::Stat, 1, run);
+    for (const SyscallKind kind : {SyscallKind::Open, SyscallKind::Unlink, SyscallKind::Io}) {
+        expectPerFileBudget(runSmall, runLarge, kLarge - kSmall, kind, 0, run);
+    }
+}
+
+void testRelocatorCancellationLeavesFilesInPlace() {
+    const fs::path tempDir = makeTempDir("cancel");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    touchFile(source / "a.mp4");
+    touchFile(source / "b.mp4");
+
+    Relocator relocator(RelocatorOptions{});
+    const RelocationPlan plan = relocator.plan(RelocationJob{MediaType::Videos, source, destination});
+
+    CancellationToken token;
+    token.cancel();
+    const RelocationSummary summary = relocator.execute(plan, token);
+    expect(summary.cancelled && summary.moved == 0, "a cancelled execute should move nothing");
+    expect(fs::exists(source / "a.mp4") && fs::exists(source / "b.mp4"), "sources should stay in place");
+
+    const RelocationSummary retry = relocator.run(RelocationJob{MediaType::Videos, source, destination});
+    expect(retry.moved == 2 && fs::exists(destination / "a.mp4"),
+           "names reserved by a cancelled run should be released");
+
+    bool threw = false;
+    try {
+        relocator.plan(RelocationJob{MediaType::Videos, tempDir / "missing", destination});
+    } catch (const RelocationError&) {
+        threw = true;
+    }
+    expect(threw, "planning a missing source should throw RelocationError");
+
+    fs::remove_all(tempDir);
+}
+
+std::size_t countFiles(const fs::path& root) {
+    std::size_t count = 0;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root)) {
+        count += entry.is_regular_file() ? 1 : 0;
+    }
+    return count;
+}
+
+void testRelocatorCopiesOnCrossDeviceAndSkipsFailedCopies() {
+    const fs::path tempDir = makeTempDir("faults");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    for (int i = 0; i < 200; ++i) {
+        touchFile(source / ("card" + std::to_string(i / 50)) / ("IMG_" + std::to_string(i % 50) + ".jpg"));
+    }
+
+    FaultInjectingFileSystem fileSystem(7);
+    fileSystem.setRule(FsOperation::Rename, FaultRule{1.0, std::errc::cross_device_link});
+    fileSystem.setRule(FsOperation::CopyFile, FaultRule{0.1, std::errc::no_space_on_device});
+
+    RelocationMetrics metrics;
+    RelocatorOptions options;
+    options.workerThreads = 4;
+    options.fileSystem = &fileSystem;
+    options.metrics = &metrics;
+    std::atomic<int> copied{0};
+    std::atomic<int> skippedWithError{0};
+    options.onEvent = [&](const RelocationEvent& event) {
+        if (event.outcome == MoveOutcome::Copied) {
+            ++copied;
+        } else if (event.outcome == MoveOutcome::Skipped && event.error == std::errc::no_space_on_device) {
+            ++skippedWithError;
+        }
+    };
+    Relocator relocator(options);
+
+    const RelocationSummary summary = relocator.run(RelocationJob{MediaType::Images, source, destination});
+    expect(summary.moved + summary.skipped == 200, "every planned file should be moved or skipped");
+    expect(summary.skipped == fileSystem.injected(FsOperation::CopyFile) && summary.skipped > 0,
+           "exactly the files whose copy failed should be skipped");
+    expect(copied.load() == static_cast<int>(summary.moved), "with rename failing, every move should be a copy");
+    expect(skippedWithError.load() == static_cast<int>(summary.skipped), "skip events should carry the copy error");
+    expect(countFiles(source) == summary.skipped, "skipped files should stay at their source");
+    expect(countFiles(destination) == summary.moved, "skipped files should leave nothing in the destination");
+    expect(metrics.renderOpenMetrics().find("reelocator_errors_total{class=\"cross_device\"} 200\n") !=
+               std::string::npos,
+           "every EXDEV should be counted");
+
+    fileSystem.clearRules();
+    const RelocationSummary retry = relocator.run(RelocationJob{MediaType::Images, source, destination});
+    expect(retry.moved == summary.skipped && countFiles(destination) == 200,
+           "names released by skipped files should be reusable on retry");
+
+    fs::remove_all(tempDir);
+}
+
+void testRelocatorTraversalErrorReleasesReservedNames() {
+    const fs::path tempDir = makeTempDir("walkfault");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    touchFile(source / "a" / "IMG_1.jpg");
+    touchFile(source / "b" / "IMG_1.jpg");
+
+    FaultInjectingFileSystem fileSystem;
+    fileSystem.setRule(FsOperation::DirectoryStep, FaultRule{1.0, std::errc::io_error});
+    RelocatorOptions options;
+    options.fileSystem = &fileSystem;
+    Relocator relocator(options);
+
+    bool threw = false;
+    try {
+        relocator.plan(RelocationJob{MediaType::Images, source, destination});
+    } catch (const fs::filesystem_error& ex) {
+        threw = ex.code() == std::errc::io_error;
+    }
+    expect(threw, "a failing directory step should abort planning with the I/O error");
+
+    fileSystem.clearRules();
+    const RelocationPlan plan = relocator.plan(RelocationJob{MediaType::Images, source, destination});
+    expect(plan.moves.size() == 2 && plan.moves[0].destination.filename() == "IMG_1.jpg",
+           "names reserved by the aborted plan should be released");
+    relocator.discard(plan);
+
+    fs::remove_all(tempDir);
+}
+
+void countCApiEvent(const reelocator_event* event, void* userData) {
+    auto* renamed = static_cast<std::atomic<int>*>(userData);
+    if (event->outcome == REELOCATOR_OUTCOME_RENAMED && event->source_length > 0 && event->destination_length > 0) {
+        ++*renamed;
+    }
+}
+
+void testCApiRunsJobAndReportsProgress() {
+    const fs::path tempDir = makeTempDir("capi");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    touchFile(source / "a.png");
+    touchFile(source / "nested" / "b.png");
+
+    std::atomic<int> renamed{0};
+    reelocator_engine* engine = reelocator_engine_create(2, countCApiEvent, &renamed);
+    expect(engine != nullptr, "engine creation should succeed");
+    expect(reelocator_abi_version() == REELOCATOR_ABI_VERSION, "library should report the header's ABI version");
+
+    std::uint64_t jobId = 0;
+    expect(reelocator_submit(engine, REELOCATOR_MEDIA_IMAGES, source.string().c_str(), destination.string().c_str(),
+                             &jobId) == REELOCATOR_OK,
+           "submit should accept a valid job");
+    expect(reelocator_wait(engine, jobId, 10000) == REELOCATOR_OK, "job should finish");
+
+    reelocator_progress progress{};
+    expect(reelocator_poll(engine, jobId, &progress) == REELOCATOR_OK, "finished jobs should remain pollable");
+    expect(progress.state == REELOCATOR_JOB_DONE && progress.moved == 2 && progress.planned == 2,
+           "progress should report the completed job");
+    expect(renamed.load() == 2, "callback should see one event per moved file");
+
+    std::uint64_t badJob = 0;
+    expect(reelocator_submit(engine, REELOCATOR_MEDIA_IMAGES, (tempDir / "missing").string().c_str(),
+                             destination.string().c_str(), &badJob) == REELOCATOR_OK,
+           "submit should be asynchronous");
+    reelocator_wait(engine, badJob, -1);
+    reelocator_poll(engine, badJob, &progress);
+    expect(progress.state == REELOCATOR_JOB_FAILED && std::string(progress.error_message).find("Source") == 0,
+           "validation failures should surface as FAILED with a message");
+
+    expect(reelocator_release(engine, jobId) == REELOCATOR_OK, "release should forget finished jobs");
+    expect(reelocator_poll(engine, jobId, &progress) == REELOCATOR_E_NOT_FOUND, "released ids should be unknown");
+    expect(reelocator_cancel(engine, 9999) == REELOCATOR_E_NOT_FOUND, "cancelling an unknown job should fail");
+
+    reelocator_engine_destroy(engine);
+    fs::remove_all(tempDir);
+}
+
+void testJobProgressCallbackReceivesEachMove() {
+    const fs::path tempDir = makeTempDir("job-progress");
+    const fs::path source = tempDir / "source";
+    for (int i = 0; i < 20; ++i) {
+        touchFile(source / ("IMG_" + std::to_string(i) + ".JPG"));
+    }
+
+    RelocatorOptions options;
+    options.workerThreads = 4;
+    std::atomic<int> engineCalls{0};
+    options.onProgress = [&](const RelocationProgress&) { ++engineCalls; };
+    Relocator relocator(options);
+
+    std::atomic<int> jobCalls{0};
+    std::atomic<std::uintmax_t> lastCompleted{0};
+    RelocationJob job{MediaType::Images, source, tempDir / "destination", 7};
+    job.onProgress = [&](const RelocationProgress& progress) {
+        expect(progress.jobId == 7 && progress.planned == 20, "progress should describe the job it was given to");
+        ++jobCalls;
+        std::uintmax_t seen = lastCompleted.load();
+        while (seen < progress.completed && !lastCompleted.compare_exchange_weak(seen, progress.completed)) {
+        }
+    };
+    expect(relocator.run(job).moved == 20, "every file should move");
+    expect(jobCalls == 20 && engineCalls == 20, "both callbacks should see every move");
+    expect(lastCompleted == 20, "the last progress should count every move");
+
+    fs::remove_all(tempDir);
+}
+
+void testDaemonRunsSubmittedJobOverUnixSocket() {
+#if defined(__unix__) || defined(__APPLE__)
+    const fs::path tempDir = makeTempDir("daemon");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    touchFile(source / "a.png");
+    touchFile(source / "nested" / "b.png");
+
+    DaemonOptions options;
+    options.socketPath = tempDir / "reelocator.sock";
+    options.workerThreads = 2;
+    RelocationDaemon daemon(options);
+    daemon.start();
+
+    const int client = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, options.socketPath.c_str(), sizeof(address.sun_path) - 1);
+    expect(::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0,
+           "daemon should accept connections on its socket");
+
+    std::string pending;
+    auto readLine = [&] {
+        char buffer[1024];
+        while (pending.find('\n') == std::string::npos) {
+            const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                throw std::runtime_error("daemon closed the connection");
+            }
+            pending.append(buffer, static_cast<std::size_t>(n));
+        }
+        const std::string line = pending.substr(0, pending.find('\n'));
+        pending.erase(0, line.size() + 1);
+        return line;
+    };
+    auto sendLine = [&](const std::string& line) {
+        const std::string framed = line + "\n";
+        ::send(client, framed.data(), framed.size(), 0);
+    };
+
+    sendLine("{\"op\":\"ping\"}");
+    expect(readLine() == "{\"ok\":true}", "ping should be acknowledged");
+
+    sendLine("{\"op\":\"submit\",\"type\":\"images\",\"source\":\"" + source.string() +
+             "\",\"destination\":\"" + destination.string() + "\"}");
+    expect(readLine() == "{\"ok\":true,\"job\":1}", "submit should reply with the new job id");
+
+    std::string done;
+    while (done.empty()) {
+        const std::string line = readLine();
+        if (line.rfind("{\"event\":\"done\"", 0) == 0) {
+            done = line;
+        }
+    }
+    expect(done.find("\"state\":\"done\"") != std::string::npos && done.find("\"moved\":2") != std::string::npos,
+           "done event should report the finished job");
+    expect(fs::exists(destination / "a.png") && fs::exists(destination / "b.png"), "files should be moved");
+
+    sendLine("{\"op\":\"status\",\"job\":1}");
+    expect(readLine().rfind("{\"ok\":true,\"event\":\"status\",\"job\":1,\"state\":\"done\"", 0) == 0,
+           "finished jobs should remain queryable");
+    sendLine("{\"op\":\"cancel\",\"job\":42}");
+    expect(readLine().find("unknown job") != std::string::npos, "cancelling an unknown job should fail");
+    sendLine("not json");
+    expect(readLine().find("malformed request") != std::string::npos, "malformed lines should be rejected");
+
+    ::close(client);
+    daemon.stop();
+    expect(!fs::exists(options.socketPath), "stop should remove the socket");
+
+    fs::remove_all(tempDir);
+#else
+    throw SkippedTest("daemon requires Unix domain sockets");
+#endif
+}
+
+void testRelocatorReleasesIdleDestinationIndexes() {
+    const fs::path tempDir = makeTempDir("release-indexes");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    touchFile(source / "IMG_0001.JPG");
+
+    RelocatorOptions options;
+    options.workerThreads = 1;
+    Relocator relocator(options);
+
+    {
+        const RelocationPlan plan = relocator.plan(RelocationJob{MediaType::Images, source, destination});
+        expect(relocator.releaseIdleDestinationIndexes() == 0, "a live plan should keep its index");
+        expect(relocator.execute(plan).moved == 1, "the planned file should move");
+    }
+    expect(relocator.releaseIdleDestinationIndexes() == 1, "the index should be dropped once no plan holds it");
+
+    // Removed behind the relocator's back; a kept index would still count
+    // the name as taken.
+    fs::remove(destination / "IMG_0001.JPG");
+    touchFile(source / "IMG_0001.JPG");
+    expect(relocator.run(RelocationJob{MediaType::Images, source, destination}).moved == 1,
+           "the second job should move its file");
+    expect(fs::exists(destination / "IMG_0001.JPG") && !fs::exists(destination / "IMG_0001_1.JPG"),
+           "a rescanned destination should reuse freed names");
+
+    fs::remove_all(tempDir);
+}
+
+void testRelocatorKeepsWarmIndexesUntilDestinationChanges() {
+    const fs::path tempDir = makeTempDir("warm-indexes");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    const fs::path other = tempDir / "other";
+
+    FileSystem fileSystem;
+    RelocatorOptions options;
+    options.workerThreads = 1;
+    options.fileSystem = &fileSystem;
+    options.maxDestinationIndexes = 1;
+    Relocator relocator(options);
+
+    // Each run opens the source once, plus the destination when its index
+    // has to be scanned.
+    auto directoriesOpenedBy = [&](const fs::path& file, const fs::path& to) {
+        touchFile(source / file);
+        const std::uint64_t before = fileSystem.counters().count(FsOperation::DirectoryOpen);
+        expect(relocator.run(RelocationJob{MediaType::Images, source, to}).moved == 1, "the new file should move");
+        return fileSystem.counters().count(FsOperation::DirectoryOpen) - before;
+    };
+
+    expect(directoriesOpenedBy("IMG_0001.JPG", destination) == 2, "the first job should scan the destination");
+    expect(directoriesOpenedBy("IMG_0002.JPG", destination) == 1,
+           "a destination only this relocator wrote to should keep its index");
+
+    // Removed behind the relocator's back; the old index would still count
+    // the name as taken.
+    fs::remove(destination / "IMG_0001.JPG");
+    expect(directoriesOpenedBy("IMG_0001.JPG", destination) == 2, "a destination written by others should be rescanned");
+    expect(fs::exists(destination / "IMG_0001.JPG") && !fs::exists(destination / "IMG_0001_1.JPG"),
+           "the rescanned index should reuse the freed name");
+
+    // With room for one index, using another destination evicts it.
+    expect(directoriesOpenedBy("IMG_0003.JPG", other) == 2, "a new destination should be scanned");
+    expect(directoriesOpenedBy("IMG_0004.JPG", destination) == 2,
+           "an index evicted past maxDestinationIndexes should be scanned again");
+
+    fs::remove_all(tempDir);
+}
+
+void testPinnedDestinationIndexKeepsReservations() {
+    const fs::path tempDir = makeTempDir("pinned-index");
+    const fs::path destination = tempDir / "destination";
+    fs::create_directories(destination);
+    fs::create_directories(tempDir / "other");
+
+    RelocatorOptions options;
+    options.workerThreads = 1;
+    options.maxDestinationIndexes = 0;
+    Relocator relocator(options);
+
+    const std::shared_ptr<DestinationIndex> pinned = relocator.destinationIndexFor(destination);
+    const fs::path reserved = pinned->reserveUniquePath("IMG_0001.JPG");
+    expect(relocator.releaseIdleDestinationIndexes() == 0, "a pinned index should not be released");
+    expect(relocator.destinationIndexFor(tempDir / "other").get() != nullptr, "other destinations should still load");
+    expect(relocator.destinationIndexFor(destination) == pinned, "a pinned index should not be evicted");
+    expect(relocator.destinationIndexFor(destination)->reserveUniquePath("IMG_0001.JPG") != reserved,
+           "names reserved through a pinned index should stay reserved");
+
+    fs::remove_all(tempDir);
+}
+
+void testDaemonProgressDoesNotWaitForSlowClients() {
+#if defined(__unix__) || defined(__APPLE__)
+    const fs::path tempDir = makeTempDir("daemon-slow-client");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    constexpr int kFiles = 4000;
+    for (int i = 0; i < kFiles; ++i) {
+        touchFile(source / ("IMG_" + std::to_string(i) + ".JPG"));
+    }
+
+    DaemonOptions options;
+    options.socketPath = tempDir / "reelocator.sock";
+    options.workerThreads = 2;
+    options.progressInterval = std::chrono::milliseconds(0);
+    RelocationDaemon daemon(options);
+    daemon.start();
+
+    auto connectClient = [&] {
+        const int client = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, options.socketPath.c_str(), sizeof(address.sun_path) - 1);
+        expect(::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0,
+               "daemon should accept connections on its socket");
+        return client;
+    };
+    auto sendLine = [](int client, const std::string& line) {
+        const std::string framed = line + "\n";
+        ::send(client, framed.data(), framed.size(), 0);
+    };
+
+    // Submits and then never reads, so every event for the job backs up on
+    // this connection.
+    const int submitter = connectClient();
+    sendLine(submitter, "{\"op\":\"submit\",\"type\":\"images\",\"source\":\"" + source.string() +
+                            "\",\"destination\":\"" + destination.string() + "\"}");
+
+    const int watcher = connectClient();
+    std::string status;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (status.find("\"state\":\"done\"") == std::string::npos) {
+        expect(std::chrono::steady_clock::now() < deadline, "the job should finish while its client is not reading");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        sendLine(watcher, "{\"op\":\"status\",\"job\":1}");
+        char buffer[1024];
+        const ssize_t n = ::recv(watcher, buffer, sizeof(buffer), 0);
+        expect(n > 0, "status requests should be answered");
+        status.assign(buffer, static_cast<std::size_t>(n));
+    }
+    expect(status.find("\"moved\":" + std::to_string(kFiles)) != std::string::npos, "every file should move");
+
+    ::close(watcher);
+    ::close(submitter);
+    daemon.stop();
+    fs::remove_all(tempDir);
+#else
+    throw SkippedTest("daemon requires Unix domain sockets");
+#endif
+}
+
+void testDaemonClosesConnectionsDroppedMidJob() {
+#if defined(__linux__)
+    auto openDescriptors = [] {
+        std::size_t count = 0;
+        for (auto it = fs::directory_iterator("/proc/self/fd"); it != fs::directory_iterator(); ++it) {
+            ++count;
+        }
+        return count;
+    };
+
+    const fs::path tempDir = makeTempDir("daemon-drop");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    constexpr int kFiles = 2000;
+    for (int i = 0; i < kFiles; ++i) {
+        touchFile(source / ("IMG_" + std::to_string(i) + ".JPG"));
+    }
+
+    DaemonOptions options;
+    options.socketPath = tempDir / "reelocator.sock";
+    options.workerThreads = 2;
+    options.progressInterval = std::chrono::milliseconds(0);
+    RelocationDaemon daemon(options);
+    daemon.start();
+    const std::size_t before = openDescriptors();
+
+    auto connectClient = [&] {
+        const int client = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, options.socketPath.c_str(), sizeof(address.sun_path) - 1);
+        expect(::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0,
+               "daemon should accept connections on its socket");
+        return client;
+    };
+    auto request = [](int client, const std::string& line) {
+        const std::string framed = line + "\n";
+        ::send(client, framed.data(), framed.size(), 0);
+        char buffer[1024];
+        const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+        expect(n > 0, "the daemon should reply");
+        return std::string(buffer, static_cast<std::size_t>(n));
+    };
+
+    // Hangs up as soon as the job is accepted, while its progress is still
+    // being queued for this connection.
+    const int submitter = connectClient();
+    request(submitter, "{\"op\":\"submit\",\"type\":\"images\",\"source\":\"" + source.string() +
+                           "\",\"destination\":\"" + destination.string() + "\"}");
+    ::close(submitter);
+
+    const int watcher = connectClient();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (request(watcher, "{\"op\":\"status\",\"job\":1}").find("\"state\":\"done\"") == std::string::npos) {
+        expect(std::chrono::steady_clock::now() < deadline, "the job should finish without its client");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ::close(watcher);
+
+    // The finished job stays queryable, but must not keep either
+    // connection's socket or wake pipe open.
+    while (openDescriptors() != before) {
+        expect(std::chrono::steady_clock::now() < deadline, "dropped connections should release their descriptors");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    daemon.stop();
+    fs::remove_all(tempDir);
+#else
+    throw SkippedTest("counts descriptors through /proc/self/fd");
+#endif
+}
+
+void testDaemonDecodesEscapedNonBmpPaths() {
+#if defined(__unix__) || defined(__APPLE__)
+    const fs::path tempDir = makeTempDir("daemon-utf8");
+    // U+1F4F7 CAMERA, which JSON encoders with ASCII output send as the
+    // escaped surrogate pair \ud83d\udcf7.
+    const fs::path source = tempDir / "cards-\xF0\x9F\x93\xB7";
+    const fs::path destination = tempDir / "destination";
+    touchFile(source / "a.png");
+
+    DaemonOptions options;
+    options.socketPath = tempDir / "reelocator.sock";
+    options.workerThreads = 1;
+    RelocationDaemon daemon(options);
+    daemon.start();
+
+    const int client = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, options.socketPath.c_str(), sizeof(address.sun_path) - 1);
+    expect(::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0,
+           "daemon should accept connections on its socket");
+
+    std::string pending;
+    auto readLine = [&] {
+        char buffer[1024];
+        while (pending.find('\n') == std::string::npos) {
+            const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                throw std::runtime_error("daemon closed the connection");
+            }
+            pending.append(buffer, static_cast<std::size_t>(n));
+        }
+        const std::string line = pending.substr(0, pending.find('\n'));
+        pending.erase(0, line.size() + 1);
+        return line;
+    };
+    auto sendLine = [&](const std::string& line) {
+        const std::string framed = line + "\n";
+        ::send(client, framed.data(), framed.size(), 0);
+    };
+    auto submit = [&](const std::string& escapedSource) {
+        sendLine("{\"op\":\"submit\",\"type\":\"images\",\"source\":\"" + escapedSource + "\",\"destination\":\"" +
+                 destination.string() + "\"}");
+        return readLine();
+    };
+
+    const std::string escapedDirectory = (tempDir / "cards-").string();
+    expect(submit(escapedDirectory + "\\ud83d").find("malformed request") != std::string::npos,
+           "a lone high surrogate should be rejected");
+    expect(submit(escapedDirectory + "\\udcf7").find("malformed request") != std::string::npos,
+           "a lone low surrogate should be rejected");
+    expect(submit(escapedDirectory + "\\u0000").find("malformed request") != std::string::npos,
+           "an escaped NUL should be rejected");
+
+    expect(submit(escapedDirectory + "\\ud83d\\udcf7") == "{\"ok\":true,\"job\":1}",
+           "an escaped surrogate pair should be accepted");
+    std::string done;
+    while (done.empty()) {
+        const std::string line = readLine();
+        if (line.rfind("{\"event\":\"done\"", 0) == 0) {
+            done = line;
+        }
+    }
+    expect(done.find("\"state\":\"done\"") != std::string::npos && fs::exists(destination / "a.png"),
+           "the pair should decode to the UTF-8 path on disk");
+
+    ::close(client);
+    daemon.stop();
+    fs::remove_all(tempDir);
+#else
+    throw SkippedTest("daemon requires Unix domain sockets");
+#endif
+}
+
+void testThreadPoolSharesWorkersFairlyAcrossPriorities() {
+    ThreadPool pool(1);
+    std::mutex orderMutex;
+    std::vector<char> order;
+    auto record = [&](char batch) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard<std::mutex> lock(orderMutex);
+        order.push_back(batch);
+    };
+
+    std::atomic<bool> bulkStarted{false};
+    std::thread bulk([&] {
+        pool.parallelFor(
+            200,
+            [&](std::size_t) {
+                bulkStarted.store(true);
+                record('b');
+            },
+            JobPriority::Bulk);
+    });
+    while (!bulkStarted.load()) {
+        std::this_thread::yield();
+    }
+    pool.parallelFor(16, [&](std::size_t) { record('i'); }, JobPriority::Interactive);
+    bulk.join();
+
+    expect(order.size() == 216, "every index of both batches should run exactly once");
+    const auto first = std::find(order.begin(), order.end(), 'i');
+    const auto last = std::find(order.rbegin(), order.rend(), 'i').base();
+    const auto bulkWhileInteractive = std::count(first, last, 'b');
+    expect(bulkWhileInteractive <= 8, "bulk work should get only a small share while an interactive batch is queued");
+
+    JobPriority priority = JobPriority::Interactive;
+    expect(parseJobPriority("bulk", priority) && priority == JobPriority::Bulk, "bulk should parse");
+    expect(!parseJobPriority("urgent", priority), "unknown priorities should be rejected");
+}
+
+void testIoPriorityIsRestoredOnCallerThreads() {
+#if defined(__linux__) && defined(SYS_ioprio_get)
+    auto currentIoprio = [] { return ::syscall(SYS_ioprio_get, 1, 0); };
+    const long before = currentIoprio();
+    if (before < 0) {
+        throw SkippedTest("ioprio_get is not available");
+    }
+    // Best-effort class, level 7.
+    const long bulk = (2L << 13) | 7;
+
+    ThreadPool pool(0);
+    long during = -1;
+    pool.parallelFor(1, [&](std::size_t) { during = currentIoprio(); }, JobPriority::Bulk);
+    expect(during == bulk, "a caller running its own bulk batch should do so at bulk I/O priority");
+    expect(currentIoprio() == before, "parallelFor should give the caller back its I/O priority");
+
+    const fs::path tempDir = makeTempDir("ioprio");
+    touchFile(tempDir / "source" / "a.png");
+    RelocatorOptions options;
+    options.workerThreads = 1;
+    Relocator relocator(options);
+    RelocationJob job{MediaType::Images, tempDir / "source", tempDir / "destination"};
+    job.priority = JobPriority::Bulk;
+    relocator.discard(relocator.plan(job));
+    expect(currentIoprio() == before, "plan should give the caller back its I/O priority");
+    fs::remove_all(tempDir);
+#else
+    throw SkippedTest("per-thread I/O priorities are Linux-only");
+#endif
+}
+
+void testAsyncRelocatorRunsManyMovesOnFewThreads() {
+#ifdef REELOCATOR_HAVE_ASYNC
+    const fs::path tempDir = makeTempDir("async");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    for (int i = 0; i < 300; ++i) {
+        touchFile(source / ("dir" + std::to_string(i % 7)) / ("IMG_" + std::to_string(i % 100) + ".jpg"));
+    }
+    touchFile(source / "notes.txt");
+
+    Relocator relocator;
+    AsyncExecutor executor(2);
+    AsyncRelocator async(relocator, executor);
+
+    const std::vector<fs::path> files = syncWait(async.scan(source));
+    expect(files.size() == 301, "scan should find every regular file");
+    expect(syncWait(async.classify(source / "notes.txt", MediaType::Images)) == false,
+           "classify should reject non-media files");
+
+    const RelocationSummary summary = syncWait(async.run(RelocationJob{MediaType::Images, source, destination}));
+    expect(summary.moved == 300 && summary.skipped == 0 && !summary.cancelled, "every image should be moved");
+    expect(fs::exists(destination / "IMG_0.jpg") && fs::exists(destination / "IMG_0_2.jpg"),
+           "colliding names should be numbered");
+    expect(syncWait(async.place(destination, "IMG_0.jpg")) == destination / "IMG_0_3.jpg",
+           "place should reserve the next free name");
+
+    bool threw = false;
+    try {
+        syncWait(async.run(RelocationJob{MediaType::Images, tempDir / "missing", destination}));
+    } catch (const RelocationError&) {
+        threw = true;
+    }
+    expect(threw, "validation errors should propagate through the coroutine");
+
+    fs::remove_all(tempDir);
+#else
+    throw SkippedTest("coroutine API requires a C++20 compiler");
+#endif
+}
+
+void testAsyncRelocatorCancelsMidRunAndReportsMoves() {
+#ifdef REELOCATOR_HAVE_ASYNC
+    const fs::path tempDir = makeTempDir("async-cancel");
+    const fs::path source = tempDir / "source";
+    const fs::path destination = tempDir / "destination";
+    constexpr std::uintmax_t kFiles = 200;
+    for (std::uintmax_t i = 0; i < kFiles; ++i) {
+        touchFile(source / ("IMG_" + std::to_string(i) + ".jpg"));
+    }
+
+    // Cancels from inside the run, once some moves have finished, so only
+    // a check made just before each later move can see it.
+    CancellationToken token;
+    RelocationMetrics metrics;
+    std::atomic<std::uintmax_t> events{0};
+    std::atomic<std::uintmax_t> lastProgress{0};
+    RelocatorOptions options;
+    options.metrics = &metrics;
+    options.onEvent = [&](const RelocationEvent&) {
+        if (++events == 10) {
+            token.cancel();
+        }
+    };
+    options.onProgress = [&](const RelocationProgress& progress) {
+        std::uintmax_t seen = lastProgress.load();
+        while (seen < progress.completed && !lastProgress.compare_exchange_weak(seen, progress.completed)) {
+        }
+    };
+    Relocator relocator(options);
+    AsyncExecutor executor(2);
+    AsyncRelocator async(relocator, executor);
+
+    const RelocationSummary summary = syncWait(async.run(RelocationJob{MediaType::Images, source, destination}, token));
+    std::uintmax_t left = 0;
+    for (const auto& entry : fs::directory_iterator(source)) {
+        left += entry.is_regular_file() ? 1 : 0;
+    }
+    expect(summary.cancelled, "a cancel issued mid-run should be reported");
+    expect(left > 0 && summary.moved < kFiles && summary.moved + left == kFiles,
+           "files not yet moved at the cancel should stay in place");
+    expect(events.load() == summary.moved && lastProgress.load() == summary.moved &&
+               metrics.moved(MoveMethod::Rename) == summary.moved,
+           "async moves should reach onEvent, onProgress and the metrics");
+
+    fs::remove_all(tempDir);
+#else
+    throw SkippedTest("coroutine API requires a C++20 compiler");
+#endif
+}
+
+std::vector<std::string> listTree(const fs::path& root) {
+    std::vector<std::string> entries;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root)) {
+        entries.push_back(fs::relative(entry.path(), root).generic_string() +
+                          (entry.is_regular_file() ? ":" + std::to_string(entry.file_size()) : "/"));
+    }
+    std::sort(entries.begin(), entries.end());
+    return entries;
+}
+
+void testTreeGeneratorIsDeterministicAndCollides() {
+    const fs::path tempDir = makeTempDir("treegen");
+
+    TreeSpec spec;
+    spec.seed = 42;
+    spec.files = 500;
+    spec.cards = 3;
+    spec.depth = 1;
+    spec.fanOut = 2;
+    spec.collisionPool = 50;
+    spec.content = GeneratedContent::Header;
+    spec.sparseSize = 64;
+
+    spec.threads = 1;
+    const GeneratedTree first = generateTree(tempDir / "a", spec);
+    spec.threads = 4;
+    const GeneratedTree second = generateTree(tempDir / "b", spec);
+
+    expect(first.files == 500 && second.files == 500, "generator should create the requested number of files");
+    expect(first.images + first.videos + first.others == first.files, "every file should have one kind");
+    expect(first.directories == 3 * (2 + 2), "directory count should follow cards, depth and fan-out");
+    expect(listTree(tempDir / "a") == listTree(tempDir / "b"), "same seed should give the same tree for any thread count");
+
+    std::map<std::string, int> nameCounts;
+    std::string jpeg;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(tempDir / "a")) {
+        if (entry.is_regular_file()) {
+            ++nameCounts[entry.path().filename().string()];
+            const std::string extension = toLower(entry.path().extension().string());
+            if (jpeg.empty() && (extension == ".jpg" || extension == ".jpeg")) {
+                jpeg = readFile(entry.path());
+            }
+        }
+    }
+    const bool collides = std::any_of(nameCounts.begin(), nameCounts.end(), [](const auto& entry) {
+        return entry.first.rfind("IMG_", 0) == 0 && entry.second > 1;
+    });
+    expect(collides, "shared IMG_ names should repeat across folders");
+    expect(jpeg.size() == 64 && jpeg.compare(0, 3, "\xFF\xD8\xFF") == 0,
+           "header content should start with a JPEG marker and be padded to the sparse size");
+
+    spec.seed = 43;
+    generateTree(tempDir / "c", spec);
+    expect(listTree(tempDir / "a") != listTree(tempDir / "c"), "a different seed should give a different tree");
+
+    fs::remove_all(tempDir);
+}
+
+// The loop the CLI ran before the engine existed: walk, classify, probe for a
+// free name, rename or copy+delete. Kept as the oracle for the engine.
+RelocationSummary runSequentialReference(const RelocationJob& job) {
+    RelocationSummary summary;
+    fs::create_directories(job.destination);
+    fs::recursive_directory_iterator end;
+    for (fs::recursive_directory_iterator it(job.source, fs::directory_options::skip_permission_denied); it != end;
+         ++it) {
+        const fs::path currentPath = it->path();
+        if (!it->is_regular_file() || !isTargetFile(currentPath, job.mediaType)) {
+            continue;
+        }
+
+        const fs::path finalDestination = getUniqueDestinationPath(job.destination, currentPath.filename());
+        const std::uintmax_t size = it->file_size();
+        std::error_code error;
+        fs::rename(currentPath, finalDestination, error);
+        if (error) {
+            error.clear();
+            fs::copy_file(currentPath, finalDestination, fs::copy_options::none, error);
+            if (!error) {
+                fs::remove(currentPath, error);
+            }
+        }
+        if (error) {
+            ++summary.skipped;
+        } else {
+            ++summary.moved;
+            summary.bytesMoved += size;
+        }
+    }
+    return summary;
+}
+
+// Writes every file's relative path into it, so a moved file can be traced
+// back to where it came from.
+void stampRelativePaths(const fs::path& root) {
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root)) {
+        if (entry.is_regular_file()) {
+            std::ofstream(entry.path(), std::ios::binary) << fs::relative(entry.path(), root).generic_string();
+        }
+    }
+}
+
+std::map<std::string, std::string> namesByContent(const fs::path& directory) {
+    std::map<std::string, std::string> names;
+    for (const fs::directory_entry& entry : fs::directory_iterator(directory)) {
+        names[readFile(entry.path())] = entry.path().filename().string();
+    }
+    return names;
+}
+
+// True when `name` is `original` or one of its numbered variants stem_N.ext.
+bool isNameFor(const std::string& name, const fs::path& original) {
+    if (name == original.string()) {
+        return true;
+    }
+    const std::string stem = original.stem().string() + "_";
+    const std::string extension = original.extension().string();
+    if (name.size() <= stem.size() + extension.size() || name.compare(0, stem.size(), stem) != 0 ||
+        name.compare(name.size() - extension.size(), extension.size(), extension) != 0) {
+        return false;
+    }
+    const std::string number = name.substr(stem.size(), name.size() - stem.size() - extension.size());
+    return std::all_of(number.begin(), number.end(), [](unsigned char ch) { return std::isdigit(ch) != 0; });
+}
+
+void testEngineMatchesSequentialReferenceOnGeneratedTrees() {
+    for (std::uint64_t seed = 1; seed <= 8; ++seed) {
+        const fs::path tempDir = makeTempDir("differential");
+        const std::string label = "seed " + std::to_string(seed) + ": ";
+        std::mt19937_64 random(seed);
+
+        TreeSpec spec;
+        spec.seed = seed;
+        spec.files = 100 + random() % 500;
+        spec.cards = 1 + random() % 4;
+        spec.depth = random() % 3;
+        spec.fanOut = 1 + random() % 3;
+        spec.collisionRate = static_cast<double>(random() % 101) / 100.0;
+        spec.collisionPool = 1 + random() % 40;
+        spec.threads = 1;
+        const MediaType mediaType = seed % 2 == 0 ? MediaType::Videos : MediaType::Images;
+
+        // Both sides start from the same tree and the same pre-existing
+        // destination names.
+        const std::uint64_t existing = random() % 4;
+        for (const char* side : {"reference", "engine"}) {
+            generateTree(tempDir / side / "source", spec);
+            stampRelativePaths(tempDir / side / "source");
+            fs::create_directories(tempDir / side / "destination");
+            for (std::uint64_t i = 0; i < existing; ++i) {
+                std::ofstream(tempDir / side / "destination" / ("IMG_000" + std::to_string(1 + i) + ".JPG"))
+                    << "existing " << i;
+            }
+        }
+
+        const fs::path referenceDestination = tempDir / "reference" / "destination";
+        const fs::path engineDestination = tempDir / "engine" / "destination";
+        const RelocationSummary expected =
+            runSequentialReference(RelocationJob{mediaType, tempDir / "reference" / "source", referenceDestination});
+
+        RelocatorOptions options;
+        options.workerThreads = 1 + seed % 4;
+        Relocator relocator(options);
+        const RelocationSummary actual =
+            relocator.run(RelocationJob{mediaType, tempDir / "engine" / "source", engineDestination});
+
+        expect(actual.moved == expected.moved && actual.skipped == expected.skipped &&
+                   actual.bytesMoved == expected.bytesMoved,
+               label + "summaries should match the reference");
+        expect(listTree(tempDir / "engine" / "source") == listTree(tempDir / "reference" / "source"),
+               label + "the same files should stay behind in the source");
+
+        const std::map<std::string, std::string> expectedNames = namesByContent(referenceDestination);
+        const std::map<std::string, std::string> actualNames = namesByContent(engineDestination);
+        auto nameSet = [](const std::map<std::string, std::string>& byContent) {
+            std::vector<std::string> names;
+            for (const auto& entry : byContent) {
+                names.push_back(entry.second);
+            }
+            std::sort(names.begin(), names.end());
+            return names;
+        };
+        expect(actualNames.size() == expectedNames.size(), label + "destinations should hold the same files");
+        expect(nameSet(actualNames) == nameSet(expectedNames), label + "destinations should use the same names");
+        for (const auto& [content, name] : actualNames) {
+            const auto reference = expectedNames.find(content);
+            expect(reference != expectedNames.end(), label + "engine moved a file the reference did not: " + content);
+            // Collision numbers follow traversal order, which a parallel walk
+            // may change; the name must still belong to the file.
+            const fs::path original = content.rfind("existing ", 0) == 0 ? fs::path(reference->second)
+                                                                          : fs::path(content).filename();
+            expect(isNameFor(name, original) && isNameFor(reference->second, original),
+                   label + "engine named " + content + " as " + name + ", reference as " + reference->second);
+        }
+
+        fs::remove_all(tempDir);
+    }
+}
+
+void testRelocationMetricsRendersOpenMetrics() {
+    RelocationMetrics metrics;
+    metrics.recordScanned();
+    metrics.recordScanned();
+    metrics.recordMatched();
+    metrics.recordMoved(MoveMethod::Copy, 2048);
+    metrics.recordError(classifyError(std::make_error_code(std::errc::cross_device_link)));
+    metrics.observe(MetricOperation::Rename, std::chrono::microseconds(3));
+    metrics.setStageState(RelocationStageId::Move, RelocationStageState::Running);
+
+    const std::string text = metrics.renderOpenMetrics();
+    expect(text.find("reelocator_files_scanned_total 2\n") != std::string::npos, "scanned counter should be rendered");
+    expect(text.find("reelocator_files_moved_total{method=\"copy\"} 1\n") != std::string::npos,
+           "moved counter should be labelled by method");
+    expect(text.find("reelocator_bytes_moved_total 2048\n") != std::string::npos, "byte counter should be rendered");
+    expect(text.find("reelocator_errors_total{class=\"cross_device\"} 1\n") != std::string::npos,
+           "EXDEV should be classified as cross_device");
+    expect(text.find("reelocator_operation_duration_seconds_bucket{operation=\"rename\",le=\"+Inf\"} 1\n") !=
+               std::string::npos,
+           "histogram +Inf bucket should hold every observation");
+    expect(text.find("reelocator_stage{stage=\"move\",reelocator_stage=\"running\"} 1\n") != std::string::npos,
+           "stage stateset should mark the current state");
+    expect(text.find("# TYPE reelocator_files_scanned counter\n") != std::string::npos,
+           "OpenMetrics counter families should be named without _total");
+    expect(text.size() >= 6 && text.compare(text.size() - 6, 6, "# EOF\n") == 0,
+           "OpenMetrics exposition should end with # EOF");
+}
+
+void testMetricsTextfileUsesPrometheusTextFormat() {
+    RelocationMetrics metrics;
+    metrics.recordScanned();
+    metrics.recordMoved(MoveMethod::Rename, 10);
+    metrics.setStageState(RelocationStageId::Scan, RelocationStageState::Done);
+
+    const std::string text = metrics.renderPrometheusText();
+    expect(text.find("# TYPE reelocator_files_scanned_total counter\n") != std::string::npos &&
+               text.find("# TYPE reelocator_files_moved_total counter\n") != std::string::npos,
+           "0.0.4 counter families should be named after their _total samples");
+    expect(text.find("# TYPE reelocator_stage gauge\n") != std::string::npos &&
+               text.find("reelocator_stage{stage=\"scan\",state=\"done\"} 1\n") != std::string::npos,
+           "stages should be a gauge with a state label");
+    expect(text.find("stateset") == std::string::npos && text.find("# UNIT") == std::string::npos &&
+               text.find("# EOF") == std::string::npos,
+           "0.0.4 text must not use OpenMetrics-only syntax");
+
+    // Every TYPE line names a 0.0.4 type, and every sample belongs to the
+    // family declared before it, as the textfile collector requires.
+    std::istringstream lines(text);
+    std::string line;
+    std::string family;
+    while (std::getline(lines, line)) {
+        if (line.rfind("# TYPE ", 0) == 0) {
+            std::istringstream fields(line.substr(7));
+            std::string type;
+            fields >> family >> type;
+            expect(type == "counter" || type == "gauge" || type == "histogram", "unsupported 0.0.4 type: " + line);
+        } else if (!line.empty() && line[0] != '#') {
+            expect(line.rfind(family, 0) == 0, "sample outside its declared family: " + line);
+        }
+    }
+
+    const fs::path tempDir = makeTempDir("textfile");
+    MetricsExporterOptions options;
+    options.textfilePath = tempDir / "reelocator.prom";
+    MetricsExporter exporter(metrics, options);
+    exporter.writeTextfile();
+    expect(readFile(options.textfilePath) == text, "the textfile should hold the 0.0.4 rendering");
+    fs::remove_all(tempDir);
+}
+
+void testMetricsExporterKeepsTextfileWhenWriteFails() {
+#if defined(__linux__)
+    if (!fs::exists("/dev/full")) {
+        throw SkippedTest("/dev/full is unavailable");
+    }
+
+    const fs::path tempDir = makeTempDir("textfile-full");
+    RelocationMetrics metrics;
+    metrics.recordScanned();
+
+    MetricsExporterOptions options;
+    options.textfilePath = tempDir / "reelocator.prom";
+    std::ofstream(options.textfilePath.string()) << "previous\n";
+
+    // The sibling opens fine but every write fails with ENOSPC, as on a full
+    // disk; the previous textfile must survive instead of being truncated.
+    fs::path temporary = options.textfilePath;
+    temporary += ".tmp";
+    fs::create_symlink("/dev/full", temporary);
+
+    MetricsExporter exporter(metrics, options);
+    bool threw = false;
+    try {
+        exporter.writeTextfile();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    expect(threw, "a failed textfile write should be reported");
+    expect(readFile(options.textfilePath) == "previous\n", "a failed write must not replace the textfile");
+    expect(!fs::exists(fs::symlink_status(temporary)), "a failed write should clean up its sibling");
+
+    options.interval = std::chrono::milliseconds(0);
+    MetricsExporter spinning(metrics, options);
+    threw = false;
+    try {
+        spinning.start();
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    expect(threw, "a zero textfile interval should be rejected");
+
+    fs::remove_all(tempDir);
+#else
+    throw SkippedTest("needs /dev/full");
+#endif
+}
+
+void testMetricsExporterWritesTextfileAndServesHttp() {
+#if defined(__unix__) || defined(__APPLE__)
+    const fs::path tempDir = makeTempDir("metrics");
+
+    RelocationMetrics metrics;
+    metrics.recordScanned();
+
+    MetricsExporterOptions options;
+    options.textfilePath = tempDir / "reelocator.prom";
+    options.interval = std::chrono::milliseconds(10);
+    options.httpEnabled = true;
+
+    MetricsExporter exporter(metrics, options);
+    exporter.start();
+    expect(exporter.httpPort() != 0, "exporter should report the ephemeral port it bound");
+
+    auto scrape = [&](const std::string& headers) {
+        const int client = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(exporter.httpPort());
+        expect(::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0,
+               "metrics endpoint should accept localhost connections");
+
+        const std::string request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n";
+        ::send(client, request.data(), request.size(), 0);
+        std::string response;
+        char buffer[4096];
+        ssize_t n = 0;
+        while ((n = ::recv(client, buffer, sizeof(buffer), 0)) > 0) {
+            response.append(buffer, static_cast<std::size_t>(n));
+        }
+        ::close(client);
+        return response;
+    };
+    const std::string response = scrape("");
+    const std::string negotiated =
+        scrape("Accept: application/openmetrics-text;version=1.0.0,text/plain;version=0.0.4;q=0.5\r\n");
+
+    exporter.stop();
+
+    expect(response.rfind("HTTP/1.1 200 OK", 0) == 0, "metrics endpoint should answer 200");
+    expect(response.find("reelocator_files_scanned_total 1\n") != std::string::npos,
+           "HTTP body should carry the current counters");
+    expect(response.find("Content-Type: text/plain; version=0.0.4") != std::string::npos &&
+               response.find("# EOF") == std::string::npos,
+           "scrapers that do not ask for OpenMetrics should get 0.0.4 text");
+    expect(negotiated.find("Content-Type: application/openmetrics-text") != std::string::npos &&
+               negotiated.find("# EOF\n") != std::string::npos,
+           "an OpenMetrics Accept header should get OpenMetrics");
+    expect(readFile(options.textfilePath).find("reelocator_files_scanned_total 1\n") != std::string::npos,
+           "textfile should be written on stop");
+    expect(!fs::exists(tempDir / "reelocator.prom.tmp"), "temporary textfile should be renamed into place");
+
+    fs::remove_all(tempDir);
+#else
+    throw SkippedTest("metrics HTTP endpoint requires POSIX sockets");
+#endif
+}
+
+void testTraceRecorderWritesPerThreadChromeTrace() {
+    { TraceSpan disabled(nullptr, "scan"); }
+
+    TraceRecorder recorder;
+    { TraceSpan span(&recorder, "scan"); }
+    std::thread worker([&recorder] { TraceSpan span(&recorder, "rename"); });
+    worker.join();
+
+    expect(recorder.eventCount() == 2, "each enabled span should record exactly one event");
+
+    std::ostringstream out;
+    recorder.writeChromeTrace(out);
+    const std::string json = out.str();
+    expect(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0, "trace should be a trace-event object");
+    expect(json.find("\"name\":\"scan\",\"cat\":\"reelocator\",\"ph\":\"X\",\"pid\":1,\"tid\":1") != std::string::npos,
+           "first recording thread should get tid 1");
+    expect(json.find("\"name\":\"rename\",\"cat\":\"reelocator\",\"ph\":\"X\",\"pid\":1,\"tid\":2") != std::string::npos,
+           "second recording thread should get its own buffer");
+}
+
+void testTraceRecorderKeepsOneBufferPerThreadAcrossRecorders() {
+    // More recorders than the per-thread cache holds, so some switches have
+    // to find the thread's buffer again under the recorder lock.
+    std::array<TraceRecorder, 6> recorders;
+    for (int round = 0; round < 3; ++round) {
+        for (TraceRecorder& recorder : recorders) {
+            TraceSpan span(&recorder, "rename");
+        }
+    }
+
+    for (const TraceRecorder& recorder : recorders) {
+        expect(recorder.eventCount() == 3, "every span should land in its own recorder");
+        std::ostringstream out;
+        recorder.writeChromeTrace(out);
+        const std::string json = out.str();
+        std::size_t threads = 0;
+        for (std::size_t pos = json.find("\"thread_name\""); pos != std::string::npos;
+             pos = json.find("\"thread_name\"", pos + 1)) {
+            ++threads;
+        }
+        expect(threads == 1, "switching recorders should not give the thread a new buffer");
+    }
+}
+
+void testRelocatorRecordsOneScanSpanPerWalk() {
+    const fs::path tempDir = makeTempDir("trace-scan");
+    const fs::path source = tempDir / "source";
+    for (int i = 0; i < 3; ++i) {
+        touchFile(source / ("IMG_" + std::to_string(i) + ".JPG"));
+        touchFile(source / "card" / ("CARD_" + std::to_string(i) + ".JPG"));
+    }
+
+    TraceRecorder recorder;
+    RelocatorOptions options;
+    options.workerThreads = 1;
+    options.tracer = &recorder;
+    Relocator relocator(options);
+    relocator.discard(relocator.plan(RelocationJob{MediaType::Images, source, tempDir / "destination"}));
+
+    std::ostringstream out;
+    recorder.writeChromeTrace(out);
+    const std::string json = out.str();
+    std::size_t scans = 0;
+    for (std::size_t pos = json.find("\"name\":\"scan\""); pos != std::string::npos;
+         pos = json.find("\"name\":\"scan\"", pos + 1)) {
+        ++scans;
+    }
+    expect(scans == 1, "the default walk should record a single scan span");
+    expect(json.find("\"args\":{\"count\":7}") != std::string::npos,
+           "the scan span should count the six files and one directory it read");
+
+    fs::remove_all(tempDir);
+}
+
+using TestFunction = void (*)();
+
+struct TestCase {
+    const char* name;
+    TestFunction run;
+    // Needs the process to itself: forks a ptrace'd child, which is only
+    // safe with a single thread, or counts process-wide resources. Without
+    // --isolate the harness runs these after every other test, on the main
+    // thread.
+    bool serial = false;
+};
+
+const TestCase kTestCases[] = {
+    {"testToLowerNormalizesCase", testToLowerNormalizesCase},
+    {"testIsTargetFileMatchesCaseInsensitiveImageExtension", testIsTargetFileMatchesCaseInsensitiveImageExtension},
+    {"testIsTargetFileRejectsWrongMediaType", testIsTargetFileRejectsWrongMediaType},
+    {"testGetUniqueDestinationPathAddsNumericSuffix", testGetUniqueDestinationPathAddsNumericSuffix},
+    {"testRelocationMetricsRendersOpenMetrics", testRelocationMetricsRendersOpenMetrics},
+    {"testMetricsExporterWritesTextfileAndServesHttp", testMetricsExporterWritesTextfileAndServesHttp},
+    {"testTraceRecorderWritesPerThreadChromeTrace", testTraceRecorderWritesPerThreadChromeTrace},
+    {"testGetUniqueDestinationPathStaysWithinSyscallBudget", testGetUniqueDestinationPathStaysWithinSyscallBudget},
+    {"testParseJobManifestReadsTabSeparatedJobs", testParseJobManifestReadsTabSeparatedJobs},
+    {"testDestinationIndexMatchesUniquePathWithoutProbes", testDestinationIndexMatchesUniquePathWithoutProbes},
+    {"testRelocatorPlanChoosesNamesAndExecuteMoves", testRelocatorPlanChoosesNamesAndExecuteMoves},
+    {"testRelocatorCancellationLeavesFilesInPlace", testRelocatorCancellationLeavesFilesInPlace},
+    {"testCApiRunsJobAndReportsProgress", testCApiRunsJobAndReportsProgress},
+    {"testDaemonRunsSubmittedJobOverUnixSocket", testDaemonRunsSubmittedJobOverUnixSocket},
+    {"testThreadPoolSharesWorkersFairlyAcrossPriorities", testThreadPoolSharesWorkersFairlyAcrossPriorities},
+    {"testAsyncRelocatorRunsManyMovesOnFewThreads", testAsyncRelocatorRunsManyMovesOnFewThreads},
+    {"testTreeGeneratorIsDeterministicAndCollides", testTreeGeneratorIsDeterministicAndCollides},
+    {"testRelocatorCopiesOnCrossDeviceAndSkipsFailedCopies", testRelocatorCopiesOnCrossDeviceAndSkipsFailedCopies},
+    {"testRelocatorTraversalErrorReleasesReservedNames", testRelocatorTraversalErrorReleasesReservedNames},
+    {"testEngineMatchesSequentialReferenceOnGeneratedTrees", testEngineMatchesSequentialReferenceOnGeneratedTrees},
+    {"testClassificationAndNamingDoNotAllocatePerCollision", testClassificationAndNamingDoNotAllocatePerCollision},
+    {"testRelocationStaysWithinKernelSyscallBudget", testRelocationStaysWithinKernelSyscallBudget, true},
+    {"testPathArenaInternsDirectoriesAndRebuildsPaths", testPathArenaInternsDirectoriesAndRebuildsPaths},
+    {"testSpillVectorBoundsHeapAndSortsExternally", testSpillVectorBoundsHeapAndSortsExternally},
+    {"testRelocatorPrunesDestinationInsideSource", testRelocatorPrunesDestinationInsideSource},
+    {"testIdentitySetAdmitsEachIdentityOnceAcrossThreads", testIdentitySetAdmitsEachIdentityOnceAcrossThreads},
+    {"testRelocatorFollowsSymlinksScanningEachDirectoryOnce", testRelocatorFollowsSymlinksScanningEachDirectoryOnce},
+    {"testMetricsTextfileUsesPrometheusTextFormat", testMetricsTextfileUsesPrometheusTextFormat},
+    {"testAsyncRelocatorCancelsMidRunAndReportsMoves", testAsyncRelocatorCancelsMidRunAndReportsMoves},
+    {"testRelocatorSpillsPlanPastMemoryBudget", testRelocatorSpillsPlanPastMemoryBudget},
+    {"testFollowSymlinksPlanIsStableAcrossThreadedRuns", testFollowSymlinksPlanIsStableAcrossThreadedRuns},
+    {"testRelocatorReleasesIdleDestinationIndexes", testRelocatorReleasesIdleDestinationIndexes},
+    {"testDaemonProgressDoesNotWaitForSlowClients", testDaemonProgressDoesNotWaitForSlowClients},
+    {"testIoPriorityIsRestoredOnCallerThreads", testIoPriorityIsRestoredOnCallerThreads},
+    {"testJobProgressCallbackReceivesEachMove", testJobProgressCallbackReceivesEachMove},
+    {"testRelocatorRecordsOneScanSpanPerWalk", testRelocatorRecordsOneScanSpanPerWalk},
+    {"testDaemonClosesConnectionsDroppedMidJob", testDaemonClosesConnectionsDroppedMidJob, true},
+    {"testRelocatorKeepsWarmIndexesUntilDestinationChanges", testRelocatorKeepsWarmIndexesUntilDestinationChanges},
+    {"testPinnedDestinationIndexKeepsReservations", testPinnedDestinationIndexKeepsReservations},
+    {"testDaemonDecodesEscapedNonBmpPaths", testDaemonDecodesEscapedNonBmpPaths},
+    {"testMetricsExporterKeepsTextfileWhenWriteFails", testMetricsExporterKeepsTextfileWhenWriteFails},
+    {"testTraceRecorderKeepsOneBufferPerThreadAcrossRecorders", testTraceRecorderKeepsOneBufferPerThreadAcrossRecorders},
+};
+
+struct HarnessOptions {
+    fs::path junitOutputPath = fs::path("build") / "test-results" / "reelocator-unit.xml";
+    // 0 runs one test per CPU at a time.
+    std::size_t jobs = 1;
+    // Run every test in a forked child, so a crash or leaked state stays
+    // inside that test.
+    bool isolate = false;
+    std::string filter;
+};
+
+HarnessOptions parseHarnessOptions(int argc, char* argv[]) {
+    HarnessOptions options;
 
     for (int i = 1; i < argc; ++i) {
         const std::string arg = argv[i];
-        if (arg == "--junit-out") {
+        if (arg == "--junit-out" || arg == "--jobs" || arg == "--filter") {
             if (i + 1 >= argc) {
-                throw std::invalid_argument("--junit-out requires a path argument");
+                throw std::invalid_argument(arg + " requires an argument");
             }
-            outputPath = argv[++i];
+            const std::string value = argv[++i];
+            if (arg == "--junit-out") {
+                options.junitOutputPath = value;
+            } else if (arg == "--jobs") {
+                options.jobs = std::stoul(value);
+            } else {
+                options.filter = value;
+            }
+            continue;
+        }
+        if (arg == "--isolate") {
+#if defined(__unix__) || defined(__APPLE__)
+            options.isolate = true;
             continue;
+#else
+            throw std::invalid_argument("--isolate requires fork()");
+#endif
         }
 
         throw std::invalid_argument("Unknown argument: " + arg);
     }
 
-    return outputPath;
+    if (options.jobs == 0) {
+        const unsigned hardware = std::thread::hardware_concurrency();
+        options.jobs = hardware == 0 ? 1 : hardware;
+    }
+    return options;
+}
+
+fs::path makeRunRoot() {
+#if defined(__unix__) || defined(__APPLE__)
+    const std::string id = std::to_string(::getpid());
+#else
+    const std::string id = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    const fs::path root = fs::temp_directory_path() / ("reelocator-tests-" + id);
+    fs::create_directories(root);
+    return root;
+}
+
+// Roots are named by index rather than test name to keep Unix socket paths
+// below sun_path's limit.
+TestCaseResult runInTestRoot(const TestCase& test, const fs::path& root) {
+    fs::create_directories(root);
+    currentTestRoot = root;
+    TestCaseResult result = runTestCase(test.name, test.run);
+    currentTestRoot.clear();
+    std::error_code ignored;
+    fs::remove_all(root, ignored);
+    return result;
+}
+
+// Each worker claims the next unstarted test; results land in their
+// table slot, so the report order does not depend on scheduling. Serial
+// tests wait until the workers have joined and run on the calling thread.
+void runOnThreads(const std::vector<const TestCase*>& tests, const fs::path& runRoot, std::size_t jobs,
+                  std::vector<TestCaseResult>& results) {
+    std::vector<std::size_t> parallel;
+    std::vector<std::size_t> serial;
+    for (std::size_t i = 0; i < tests.size(); ++i) {
+        (tests[i]->serial ? serial : parallel).push_back(i);
+    }
+
+    std::atomic<std::size_t> next{0};
+    auto worker = [&] {
+        for (std::size_t n = next.fetch_add(1); n < parallel.size(); n = next.fetch_add(1)) {
+            const std::size_t i = parallel[n];
+            results[i] = runInTestRoot(*tests[i], runRoot / std::to_string(i));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    const std::size_t threadCount = std::min(jobs, parallel.size());
+    for (std::size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (const std::size_t i : serial) {
+        results[i] = runInTestRoot(*tests[i], runRoot / std::to_string(i));
+    }
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+// The child writes "<status> <seconds>\n<message>" next to its root; a child
+// that dies before writing it is reported as an error with the signal or
+// exit code.
+void writeChildResult(const fs::path& path, const TestCaseResult& result) {
+    std::ofstream out(path);
+    out << static_cast<int>(result.status) << " " << std::setprecision(17) << result.durationSeconds << "\n"
+        << result.message;
+}
+
+TestCaseResult readChildResult(const TestCase& test, const fs::path& path, int waitStatus, double elapsedSeconds) {
+    TestCaseResult result{test.name, elapsedSeconds, TestStatus::Error, ""};
+    std::ifstream in(path);
+    int status = 0;
+    double duration = 0.0;
+    if (in >> status >> duration) {
+        in.ignore(1);
+        result.status = static_cast<TestStatus>(status);
+        result.durationSeconds = duration;
+        result.message.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    } else if (WIFSIGNALED(waitStatus)) {
+        result.message = "test process killed by signal " + std::to_string(WTERMSIG(waitStatus));
+    } else {
+        result.message = "test process exited with code " + std::to_string(WEXITSTATUS(waitStatus)) +
+                         " without reporting a result";
+    }
+    return result;
+}
+
+// Forks from the single-threaded main thread only, keeping up to `jobs`
+// children alive at once.
+void runIsolated(const std::vector<const TestCase*>& tests, const fs::path& runRoot, std::size_t jobs,
+                 std::vector<TestCaseResult>& results) {
+    struct Child {
+        std::size_t index;
+        std::chrono::steady_clock::time_point start;
+    };
+    std::map<pid_t, Child> running;
+    std::size_t next = 0;
+    std::cout.flush();
+
+    while (next < tests.size() || !running.empty()) {
+        while (next < tests.size() && running.size() < jobs) {
+            const std::size_t index = next++;
+            const fs::path root = runRoot / std::to_string(index);
+            const auto start = std::chrono::steady_clock::now();
+            const pid_t pid = ::fork();
+            if (pid == 0) {
+                writeChildResult(runRoot / (std::to_string(index) + ".result"), runInTestRoot(*tests[index], root));
+                ::_exit(0);
+            }
+            if (pid < 0) {
+                results[index] = TestCaseResult{tests[index]->name, 0.0, TestStatus::Error,
+                                                std::string("fork failed: ") + std::strerror(errno)};
+                continue;
+            }
+            running.emplace(pid, Child{index, start});
+        }
+
+        int waitStatus = 0;
+        const pid_t pid = ::waitpid(-1, &waitStatus, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("waitpid failed: ") + std::strerror(errno));
+        }
+        const auto found = running.find(pid);
+        if (found == running.end()) {
+            continue;
+        }
+        const std::size_t index = found->second.index;
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - found->second.start;
+        running.erase(found);
+
+        const fs::path resultPath = runRoot / (std::to_string(index) + ".result");
+        results[index] = readChildResult(*tests[index], resultPath, waitStatus, elapsed.count());
+        std::error_code ignored;
+        fs::remove(resultPath, ignored);
+        fs::remove_all(runRoot / std::to_string(index), ignored);
+    }
 }
+#endif
 
 void writeJunitXml(const fs::path& outputPath, const std::vector<TestCaseResult>& results) {
     std::size_t failures = 0;
@@ -214,21 +2245,39 @@ void writeJunitXml(const fs::path& outputPath, const std::vector<TestCaseResult>
 }  // namespace
 
 int main(int argc, char* argv[]) {
-    fs::path junitOutputPath;
+    HarnessOptions options;
     try {
-        junitOutputPath = parseJunitOutputPath(argc, argv);
+        options = parseHarnessOptions(argc, argv);
     } catch (const std::exception& ex) {
         std::cerr << "Argument error: " << ex.what() << "\n";
         return 2;
     }
 
-    std::vector<TestCaseResult> results;
-    results.reserve(4);
+    std::vector<const TestCase*> tests;
+    for (const TestCase& test : kTestCases) {
+        if (options.filter.empty() || std::string(test.name).find(options.filter) != std::string::npos) {
+            tests.push_back(&test);
+        }
+    }
 
-    results.push_back(runTestCase("testToLowerNormalizesCase", testToLowerNormalizesCase));
-    results.push_back(runTestCase("testIsTargetFileMatchesCaseInsensitiveImageExtension", testIsTargetFileMatchesCaseInsensitiveImageExtension));
-    results.push_back(runTestCase("testIsTargetFileRejectsWrongMediaType", testIsTargetFileRejectsWrongMediaType));
-    results.push_back(runTestCase("testGetUniqueDestinationPathAddsNumericSuffix", testGetUniqueDestinationPathAddsNumericSuffix));
+    std::vector<TestCaseResult> results(tests.size());
+    const fs::path runRoot = makeRunRoot();
+    try {
+#if defined(__unix__) || defined(__APPLE__)
+        if (options.isolate) {
+            runIsolated(tests, runRoot, options.jobs, results);
+        } else {
+            runOnThreads(tests, runRoot, options.jobs, results);
+        }
+#else
+        runOnThreads(tests, runRoot, options.jobs, results);
+#endif
+    } catch (const std::exception& ex) {
+        std::cerr << "Test runner error: " << ex.what() << "\n";
+        return 2;
+    }
+    std::error_code ignored;
+    fs::remove_all(runRoot, ignored);
 
     bool ok = true;
     for (const TestCaseResult& result : results) {
@@ -244,8 +2293,8 @@ int main(int argc, char* argv[]) {
     }
 
     try {
-        writeJunitXml(junitOutputPath, results);
-        std::cout << "JUnit XML written to " << junitOutputPath.string() << "\n";
+        writeJunitXml(options.junitOutputPath, results);
+        std::cout << "JUnit XML written to " << options.junitOutputPath.string() << "\n";
     } catch (const std::exception& ex) {
         std::cerr << "Failed to write JUnit XML: " << ex.what() << "\n";
         return 2;
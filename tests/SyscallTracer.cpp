@@ -0,0 +1,230 @@
+#include "SyscallTracer.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+
+#if defined(__linux__)
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <csignal>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(PTRACE_GET_SYSCALL_INFO)
+#define REELOCATOR_HAVE_SYSCALL_INFO 1
+#endif
+
+namespace {
+
+constexpr const char* kSyscallKindNames[kSyscallKindCount] = {
+    "stat", "open", "close", "rename", "unlink", "directory", "io", "other",
+};
+
+#ifdef REELOCATOR_HAVE_SYSCALL_INFO
+
+constexpr int kScenarioThrew = 1;
+constexpr int kTraceMeFailed = 2;
+
+SyscallKind kindOf(std::uint64_t number) {
+    switch (static_cast<long>(number)) {
+#ifdef SYS_stat
+        case SYS_stat:
+        case SYS_lstat:
+#endif
+#ifdef SYS_newfstatat
+        case SYS_newfstatat:
+#endif
+#ifdef SYS_fstatat64
+        case SYS_fstatat64:
+#endif
+#ifdef SYS_statx
+        case SYS_statx:
+#endif
+#ifdef SYS_access
+        case SYS_access:
+#endif
+#ifdef SYS_faccessat2
+        case SYS_faccessat2:
+#endif
+        case SYS_fstat:
+        case SYS_faccessat:
+            return SyscallKind::Stat;
+#ifdef SYS_open
+        case SYS_open:
+        case SYS_creat:
+#endif
+#ifdef SYS_openat2
+        case SYS_openat2:
+#endif
+        case SYS_openat:
+            return SyscallKind::Open;
+        case SYS_close:
+            return SyscallKind::Close;
+#ifdef SYS_rename
+        case SYS_rename:
+#endif
+#ifdef SYS_renameat
+        case SYS_renameat:
+#endif
+        case SYS_renameat2:
+            return SyscallKind::Rename;
+#ifdef SYS_unlink
+        case SYS_unlink:
+        case SYS_rmdir:
+#endif
+        case SYS_unlinkat:
+            return SyscallKind::Unlink;
+#ifdef SYS_mkdir
+        case SYS_mkdir:
+#endif
+#ifdef SYS_getdents
+        case SYS_getdents:
+#endif
+        case SYS_mkdirat:
+        case SYS_getdents64:
+            return SyscallKind::Directory;
+        case SYS_read:
+        case SYS_write:
+        case SYS_pread64:
+        case SYS_pwrite64:
+        case SYS_sendfile:
+        case SYS_copy_file_range:
+            return SyscallKind::Io;
+        default:
+            return SyscallKind::Other;
+    }
+}
+
+#endif
+
+}  // namespace
+
+const char* syscallKindName(SyscallKind kind) {
+    return kSyscallKindNames[static_cast<std::size_t>(kind)];
+}
+
+std::uint64_t SyscallCounts::total() const noexcept {
+    std::uint64_t sum = 0;
+    for (const std::uint64_t count : byKind) {
+        sum += count;
+    }
+    return sum;
+}
+
+std::uint64_t SyscallCounts::fileSystemTotal() const noexcept {
+    return total() - count(SyscallKind::Other);
+}
+
+std::string SyscallCounts::describe() const {
+    std::string text;
+    for (std::size_t i = 0; i < kSyscallKindCount; ++i) {
+        if (byKind[i] == 0) {
+            continue;
+        }
+        if (!text.empty()) {
+            text += ' ';
+        }
+        text += kSyscallKindNames[i];
+        text += '=';
+        text += std::to_string(byKind[i]);
+    }
+    return text.empty() ? "none" : text;
+}
+
+SyscallCounts operator-(const SyscallCounts& later, const SyscallCounts& earlier) {
+    SyscallCounts difference;
+    for (std::size_t i = 0; i < kSyscallKindCount; ++i) {
+        difference.byKind[i] = later.byKind[i] > earlier.byKind[i] ? later.byKind[i] - earlier.byKind[i] : 0;
+    }
+    return difference;
+}
+
+#ifdef REELOCATOR_HAVE_SYSCALL_INFO
+
+SyscallCounts countSyscalls(const std::function<void()>& scenario) {
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+        throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+    }
+    if (pid == 0) {
+        if (::ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) != 0) {
+            ::_exit(kTraceMeFailed);
+        }
+        // Everything up to this stop is setup; counting starts when the
+        // tracer resumes us.
+        ::raise(SIGSTOP);
+        int code = 0;
+        try {
+            scenario();
+        } catch (...) {
+            code = kScenarioThrew;
+        }
+        ::_exit(code);
+    }
+
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    if (WIFEXITED(status)) {
+        throw SyscallTracingUnavailable("ptrace(PTRACE_TRACEME) is not permitted");
+    }
+    if (::ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL) != 0) {
+        const int error = errno;
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, &status, 0);
+        throw SyscallTracingUnavailable(std::string("PTRACE_SETOPTIONS failed: ") + std::strerror(error));
+    }
+
+    SyscallCounts counts;
+    bool counting = true;
+    bool infoUnavailable = false;
+    int pendingSignal = 0;
+    while (true) {
+        ::ptrace(PTRACE_SYSCALL, pid, nullptr, reinterpret_cast<void*>(static_cast<long>(pendingSignal)));
+        pendingSignal = 0;
+        if (::waitpid(pid, &status, 0) < 0 || WIFEXITED(status) || WIFSIGNALED(status)) {
+            break;
+        }
+        if (WSTOPSIG(status) != (SIGTRAP | 0x80)) {
+            // A signal-delivery stop: pass the signal on, except the
+            // SIGSTOP that started the window.
+            pendingSignal = WSTOPSIG(status) == SIGSTOP ? 0 : WSTOPSIG(status);
+            continue;
+        }
+        if (!counting) {
+            continue;
+        }
+
+        __ptrace_syscall_info info{};
+        if (::ptrace(PTRACE_GET_SYSCALL_INFO, pid, reinterpret_cast<void*>(sizeof(info)), &info) <= 0) {
+            infoUnavailable = true;
+            ::kill(pid, SIGKILL);
+            continue;
+        }
+        if (info.op != PTRACE_SYSCALL_INFO_ENTRY) {
+            continue;
+        }
+        if (static_cast<long>(info.entry.nr) == SYS_exit_group) {
+            counting = false;
+            continue;
+        }
+        ++counts.byKind[static_cast<std::size_t>(kindOf(info.entry.nr))];
+    }
+
+    if (infoUnavailable) {
+        throw SyscallTracingUnavailable("PTRACE_GET_SYSCALL_INFO requires Linux 5.3");
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error("traced scenario failed in the child process");
+    }
+    return counts;
+}
+
+#else
+
+SyscallCounts countSyscalls(const std::function<void()>&) {
+    throw SyscallTracingUnavailable("syscall tracing requires Linux ptrace");
+}
+
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+// Groups of kernel calls that budgets are written against. Every variant of
+// a call (stat, lstat, newfstatat, statx, ...) lands in the same kind.
+enum class SyscallKind {
+    Stat,
+    Open,
+    Close,
+    Rename,
+    Unlink,
+    Directory,
+    Io,
+    Other,
+};
+
+constexpr std::size_t kSyscallKindCount = 8;
+
+const char* syscallKindName(SyscallKind kind);
+
+struct SyscallCounts {
+    std::array<std::uint64_t, kSyscallKindCount> byKind{};
+
+    std::uint64_t count(SyscallKind kind) const noexcept { return byKind[static_cast<std::size_t>(kind)]; }
+    std::uint64_t total() const noexcept;
+    // Every kind except Other, which also holds allocator and signal calls.
+    std::uint64_t fileSystemTotal() const noexcept;
+    // "stat=3 rename=1", nonzero kinds only.
+    std::string describe() const;
+};
+
+SyscallCounts operator-(const SyscallCounts& later, const SyscallCounts& earlier);
+
+// Thrown when the platform or sandbox does not allow tracing a child.
+class SyscallTracingUnavailable : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Runs `scenario` in a forked child under ptrace and counts the system calls
+// it makes, stopping at the child's exit. Only the forking thread is traced,
+// so scenarios must not start threads (use one Relocator worker). Side
+// effects on the filesystem remain for the caller to check; memory changes
+// stay in the child. Throws std::runtime_error when the scenario throws.
+SyscallCounts countSyscalls(const std::function<void()>& scenario);
@@ -0,0 +1,103 @@
+#include "TreeGenerator.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+std::string requireValue(int argc, char* argv[], int& i) {
+    const std::string flag = argv[i];
+    if (i + 1 >= argc) {
+        throw std::invalid_argument(flag + " requires a value");
+    }
+    return argv[++i];
+}
+
+double parseRate(const std::string& flag, const std::string& value) {
+    const double rate = std::stod(value);
+    if (rate < 0.0 || rate > 1.0) {
+        throw std::invalid_argument(flag + " must be between 0 and 1");
+    }
+    return rate;
+}
+
+void printUsage() {
+    std::cout << "Usage: reelocator_treegen --root DIR [--files N] [--seed N] [--cards N] [--depth N]\n"
+                 "                          [--fan-out N] [--collision-rate R] [--collision-pool N]\n"
+                 "                          [--video-rate R] [--other-rate R] [--content empty|sparse|header]\n"
+                 "                          [--sparse-size BYTES] [--threads N]\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    fs::path root;
+    TreeSpec spec;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--help") {
+                printUsage();
+                return 0;
+            } else if (arg == "--root") {
+                root = requireValue(argc, argv, i);
+            } else if (arg == "--files") {
+                spec.files = std::stoull(requireValue(argc, argv, i));
+            } else if (arg == "--seed") {
+                spec.seed = std::stoull(requireValue(argc, argv, i));
+            } else if (arg == "--cards") {
+                spec.cards = std::stoul(requireValue(argc, argv, i));
+            } else if (arg == "--depth") {
+                spec.depth = std::stoul(requireValue(argc, argv, i));
+            } else if (arg == "--fan-out") {
+                spec.fanOut = std::stoul(requireValue(argc, argv, i));
+            } else if (arg == "--collision-rate") {
+                spec.collisionRate = parseRate(arg, requireValue(argc, argv, i));
+            } else if (arg == "--collision-pool") {
+                spec.collisionPool = std::stoul(requireValue(argc, argv, i));
+            } else if (arg == "--video-rate") {
+                spec.videoRate = parseRate(arg, requireValue(argc, argv, i));
+            } else if (arg == "--other-rate") {
+                spec.otherRate = parseRate(arg, requireValue(argc, argv, i));
+            } else if (arg == "--content") {
+                if (!parseGeneratedContent(requireValue(argc, argv, i), spec.content)) {
+                    throw std::invalid_argument("--content must be empty, sparse or header");
+                }
+            } else if (arg == "--sparse-size") {
+                spec.sparseSize = std::stoull(requireValue(argc, argv, i));
+            } else if (arg == "--threads") {
+                spec.threads = std::stoul(requireValue(argc, argv, i));
+            } else {
+                throw std::invalid_argument("unknown argument: " + arg);
+            }
+        }
+        if (root.empty()) {
+            throw std::invalid_argument("--root is required");
+        }
+        if (spec.videoRate + spec.otherRate > 1.0) {
+            throw std::invalid_argument("--video-rate plus --other-rate must not exceed 1");
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Argument error: " << ex.what() << "\n";
+        printUsage();
+        return 2;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    GeneratedTree tree;
+    try {
+        tree = generateTree(root, spec);
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Generated " << tree.files << " files (" << tree.images << " images, " << tree.videos << " videos, "
+              << tree.others << " other) in " << tree.directories << " directories under " << root << "\n"
+              << "Logical size: " << tree.logicalBytes << " bytes, elapsed: " << elapsed.count() << " s ("
+              << static_cast<double>(tree.files) / elapsed.count() << " files/s)\n";
+    return 0;
+}
@@ -0,0 +1,318 @@
+#include "TreeGenerator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define REELOCATOR_HAVE_OPENAT 1
+#endif
+
+namespace {
+
+enum class FileKind {
+    Image,
+    Video,
+    Other,
+};
+
+constexpr std::string_view kImageExtensions[] = {".JPG", ".jpg", ".jpeg", ".JPEG", ".png",
+                                                 ".PNG", ".heic", ".HEIC", ".gif", ".tif"};
+constexpr std::string_view kVideoExtensions[] = {".MP4", ".mp4", ".MOV", ".mov", ".M4V", ".avi"};
+constexpr std::string_view kOtherExtensions[] = {".xmp", ".THM", ".txt", ".json", ".LRV"};
+
+constexpr unsigned char kJpegHeader[] = {0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 'J',  'F',  'I',  'F',
+                                         0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00};
+constexpr unsigned char kPngHeader[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+constexpr unsigned char kMp4Header[] = {0x00, 0x00, 0x00, 0x18, 'f', 't', 'y', 'p', 'i', 's', 'o', 'm',
+                                        0x00, 0x00, 0x02, 0x00, 'i', 's', 'o', 'm', 'm', 'p', '4', '2'};
+constexpr unsigned char kQuickTimeHeader[] = {0x00, 0x00, 0x00, 0x14, 'f',  't',  'y', 'p', 'q', 't',
+                                              ' ',  ' ',  0x00, 0x00, 0x02, 0x00, 'q', 't', ' ', ' '};
+
+std::uint64_t splitmix64(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Independent stream per (file, purpose) so every property of a file depends
+// only on the seed and its index.
+std::uint64_t hashOf(std::uint64_t seed, std::uint64_t index, std::uint64_t salt) {
+    return splitmix64(seed ^ splitmix64(index * 8 + salt));
+}
+
+double unitOf(std::uint64_t hash) {
+    return static_cast<double>(hash >> 11) * (1.0 / 9007199254740992.0);
+}
+
+template <std::size_t N>
+std::string_view pick(const std::string_view (&values)[N], std::uint64_t hash) {
+    return values[hash % N];
+}
+
+std::uint64_t power(std::uint64_t base, std::size_t exponent) {
+    std::uint64_t result = 1;
+    for (std::size_t i = 0; i < exponent; ++i) {
+        result *= base;
+    }
+    return result;
+}
+
+struct GeneratedFile {
+    std::string name;
+    FileKind kind;
+};
+
+GeneratedFile describeFile(const TreeSpec& spec, std::uint64_t index, std::unordered_set<std::string>& usedNames) {
+    const double kindRoll = unitOf(hashOf(spec.seed, index, 1));
+    GeneratedFile file;
+    file.kind = kindRoll < spec.otherRate                    ? FileKind::Other
+                : kindRoll < spec.otherRate + spec.videoRate ? FileKind::Video
+                                                             : FileKind::Image;
+
+    const std::uint64_t extensionHash = hashOf(spec.seed, index, 3);
+    const std::string_view extension = file.kind == FileKind::Image ? pick(kImageExtensions, extensionHash)
+                                       : file.kind == FileKind::Video ? pick(kVideoExtensions, extensionHash)
+                                                                      : pick(kOtherExtensions, extensionHash);
+
+    if (spec.collisionPool > 0 && unitOf(hashOf(spec.seed, index, 2)) < spec.collisionRate) {
+        char stem[32];
+        const std::uint64_t number = 1 + hashOf(spec.seed, index, 4) % spec.collisionPool;
+        std::snprintf(stem, sizeof(stem), "%s_%04llu", file.kind == FileKind::Video ? "MVI" : "IMG",
+                      static_cast<unsigned long long>(number));
+        file.name = std::string(stem).append(extension);
+        if (usedNames.insert(file.name).second) {
+            return file;
+        }
+    }
+
+    file.name = "DSC_" + std::to_string(index);
+    file.name.append(extension);
+    usedNames.insert(file.name);
+    return file;
+}
+
+std::string_view headerFor(const std::string& name) {
+    std::string extension = fs::path(name).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    auto view = [](const auto& bytes) {
+        return std::string_view(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    };
+    if (extension == ".jpg" || extension == ".jpeg") {
+        return view(kJpegHeader);
+    }
+    if (extension == ".png") {
+        return view(kPngHeader);
+    }
+    if (extension == ".mp4" || extension == ".m4v") {
+        return view(kMp4Header);
+    }
+    if (extension == ".mov") {
+        return view(kQuickTimeHeader);
+    }
+    return {};
+}
+
+fs::path leafPath(const fs::path& root, const TreeSpec& spec, std::uint64_t leaf, std::uint64_t leavesPerCard) {
+    fs::path path = root / ("card_" + std::to_string(leaf / leavesPerCard)) / "DCIM";
+    std::uint64_t remainder = leaf % leavesPerCard;
+    std::uint64_t divisor = leavesPerCard;
+    for (std::size_t level = 0; level < spec.depth; ++level) {
+        divisor /= spec.fanOut;
+        const std::uint64_t folder = remainder / divisor;
+        remainder %= divisor;
+        path /= level == 0 ? std::to_string(100 + folder) + "MEDIA" : "sub_" + std::to_string(folder);
+    }
+    return path;
+}
+
+class LeafWriter {
+public:
+    explicit LeafWriter(const fs::path& directory) : directory_(directory) {
+#ifdef REELOCATOR_HAVE_OPENAT
+        directoryFd_ = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (directoryFd_ < 0) {
+            throw fs::filesystem_error("cannot open directory", directory,
+                                       std::error_code(errno, std::generic_category()));
+        }
+#endif
+    }
+
+    ~LeafWriter() {
+#ifdef REELOCATOR_HAVE_OPENAT
+        ::close(directoryFd_);
+#endif
+    }
+
+    LeafWriter(const LeafWriter&) = delete;
+    LeafWriter& operator=(const LeafWriter&) = delete;
+
+    void write(const std::string& name, std::string_view header, std::uint64_t size) {
+#ifdef REELOCATOR_HAVE_OPENAT
+        const int fd = ::openat(directoryFd_, name.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        bool ok = fd >= 0;
+        if (ok && !header.empty()) {
+            ok = ::write(fd, header.data(), header.size()) == static_cast<ssize_t>(header.size());
+        }
+        if (ok && size > header.size()) {
+            ok = ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+        }
+        const int error = errno;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        if (!ok) {
+            throw fs::filesystem_error("cannot create file", directory_ / name,
+                                       std::error_code(error, std::generic_category()));
+        }
+#else
+        const fs::path path = directory_ / name;
+        {
+            std::ofstream out(path, std::ios::binary);
+            out.write(header.data(), static_cast<std::streamsize>(header.size()));
+            if (!out) {
+                throw fs::filesystem_error("cannot create file", path, std::make_error_code(std::errc::io_error));
+            }
+        }
+        if (size > header.size()) {
+            fs::resize_file(path, size);
+        }
+#endif
+    }
+
+private:
+    fs::path directory_;
+#ifdef REELOCATOR_HAVE_OPENAT
+    int directoryFd_ = -1;
+#endif
+};
+
+}  // namespace
+
+bool parseGeneratedContent(const std::string& text, GeneratedContent& content) {
+    if (text == "empty") {
+        content = GeneratedContent::Empty;
+    } else if (text == "sparse") {
+        content = GeneratedContent::Sparse;
+    } else if (text == "header") {
+        content = GeneratedContent::Header;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+GeneratedTree generateTree(const fs::path& root, const TreeSpec& spec) {
+    if (spec.cards == 0 || spec.fanOut == 0) {
+        throw std::invalid_argument("cards and fan-out must be positive");
+    }
+
+    const std::uint64_t leavesPerCard = power(spec.fanOut, spec.depth);
+    const std::uint64_t leaves = spec.cards * leavesPerCard;
+    const std::uint64_t filesPerLeaf = spec.files / leaves;
+    const std::uint64_t extraFiles = spec.files % leaves;
+
+    std::size_t threadCount = spec.threads;
+    if (threadCount == 0) {
+        const unsigned hardware = std::thread::hardware_concurrency();
+        threadCount = hardware == 0 ? 1 : hardware;
+    }
+    threadCount = static_cast<std::size_t>(std::min<std::uint64_t>(threadCount, leaves));
+
+    fs::create_directories(root);
+
+    std::atomic<std::uint64_t> nextLeaf{0};
+    std::mutex resultMutex;
+    GeneratedTree tree;
+    std::exception_ptr error;
+
+    auto worker = [&] {
+        GeneratedTree local;
+        try {
+            std::unordered_set<std::string> usedNames;
+            for (std::uint64_t leaf = nextLeaf.fetch_add(1); leaf < leaves; leaf = nextLeaf.fetch_add(1)) {
+                const fs::path directory = leafPath(root, spec, leaf, leavesPerCard);
+                fs::create_directories(directory);
+                LeafWriter writer(directory);
+
+                // Leaves before `extraFiles` take one file more, so files are
+                // numbered contiguously across leaves.
+                const std::uint64_t first = leaf * filesPerLeaf + std::min(leaf, extraFiles);
+                const std::uint64_t count = filesPerLeaf + (leaf < extraFiles ? 1 : 0);
+                usedNames.clear();
+                for (std::uint64_t index = first; index < first + count; ++index) {
+                    const GeneratedFile file = describeFile(spec, index, usedNames);
+                    const std::string_view header =
+                        spec.content == GeneratedContent::Header ? headerFor(file.name) : std::string_view();
+                    const std::uint64_t size = spec.content == GeneratedContent::Empty
+                                                   ? header.size()
+                                                   : std::max<std::uint64_t>(spec.sparseSize, header.size());
+                    writer.write(file.name, header, size);
+
+                    ++local.files;
+                    local.logicalBytes += size;
+                    switch (file.kind) {
+                        case FileKind::Image:
+                            ++local.images;
+                            break;
+                        case FileKind::Video:
+                            ++local.videos;
+                            break;
+                        case FileKind::Other:
+                            ++local.others;
+                            break;
+                    }
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(resultMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            nextLeaf.store(leaves);
+        }
+
+        std::lock_guard<std::mutex> lock(resultMutex);
+        tree.files += local.files;
+        tree.images += local.images;
+        tree.videos += local.videos;
+        tree.others += local.others;
+        tree.logicalBytes += local.logicalBytes;
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (std::size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    // Per card: the card folder, DCIM, then fanOut^k folders on each level.
+    std::uint64_t directoriesPerCard = 2;
+    for (std::size_t level = 1; level <= spec.depth; ++level) {
+        directoriesPerCard += power(spec.fanOut, level);
+    }
+    tree.directories = spec.cards * directoriesPerCard;
+    return tree;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+enum class GeneratedContent {
+    Empty,   // zero-length files
+    Sparse,  // files truncated to sparseSize without writing data
+    Header,  // a real JPEG/PNG/MP4/QuickTime header, then sparse up to sparseSize
+};
+
+bool parseGeneratedContent(const std::string& text, GeneratedContent& content);
+
+// Shape of a synthetic card dump:
+//   root/card_<c>/DCIM/<d0>/<d1>/.../<files>
+// with `depth` directory levels of `fanOut` folders below each DCIM. The same
+// seed always produces the same names, extensions and sizes, whatever the
+// thread count.
+struct TreeSpec {
+    std::uint64_t seed = 1;
+    std::uint64_t files = 10000;
+    std::size_t cards = 8;
+    std::size_t depth = 2;
+    std::size_t fanOut = 4;
+    // Fraction of files named IMG_/MVI_NNNN from a shared pool of
+    // collisionPool numbers, so the same name appears on many cards.
+    double collisionRate = 0.5;
+    std::size_t collisionPool = 9999;
+    double videoRate = 0.2;
+    // Fraction of sidecar and other non-media files.
+    double otherRate = 0.1;
+    GeneratedContent content = GeneratedContent::Empty;
+    std::uint64_t sparseSize = 4096;
+    // 0 uses one thread per CPU.
+    std::size_t threads = 0;
+};
+
+struct GeneratedTree {
+    std::uint64_t directories = 0;
+    std::uint64_t files = 0;
+    std::uint64_t images = 0;
+    std::uint64_t videos = 0;
+    std::uint64_t others = 0;
+    std::uint64_t logicalBytes = 0;
+};
+
+// Creates the tree below root, which must not exist or be empty. Throws
+// fs::filesystem_error when a directory or file cannot be created.
+GeneratedTree generateTree(const fs::path& root, const TreeSpec& spec);